@@ -0,0 +1,6 @@
+# -*- coding: utf-8 -*-
+import os
+
+# Has to be set before nassl gets imported, as OpenSSL only accepts custom allocation functions before it allocates
+# anything; see benchmarks.utils.get_openssl_allocations_count()
+os.environ.setdefault('NASSL_COUNT_ALLOCATIONS', '1')
@@ -0,0 +1,259 @@
+# -*- coding: utf-8 -*-
+"""Handshake throughput, latency and memory benchmarks for SslClient and LegacySslClient, run against local s_server
+instances.
+
+Run with python -m benchmarks.handshake_benchmark; the results are written as JSON.
+"""
+from __future__ import absolute_import
+from __future__ import unicode_literals
+
+import logging
+import os
+import re
+import shutil
+import socket
+import subprocess
+import tempfile
+import threading
+from collections import namedtuple
+
+from nassl.legacy_ssl_client import LegacySslClient
+from nassl.ssl_client import OpenSslVersionEnum, OpenSslVerifyEnum, SslClient
+from tests.openssl_server import VulnerableOpenSslServer, ClientAuthenticationServerConfigurationEnum
+from typing import Any
+from typing import Dict
+from typing import List
+from typing import Optional
+from typing import Text
+from typing import Type
+
+from benchmarks.utils import get_argument_parser, get_openssl_allocations_count, get_per_iteration, get_percentile, \
+    get_rss_bytes, timer, write_results
+
+
+class HandshakeScenario(namedtuple('HandshakeScenario', ['name', 'ssl_version', 'key_type', 'is_resumption',
+                                                         'is_client_auth', 'is_memory_lean'])):
+    """A server configuration to benchmark handshakes against, and whether the client runs in memory-lean mode.
+    """
+
+
+SCENARIOS = [
+    HandshakeScenario('rsa_tls1_2', OpenSslVersionEnum.TLSV1_2, 'rsa', False, False, False),
+    HandshakeScenario('rsa_tls1_2_memory_lean', OpenSslVersionEnum.TLSV1_2, 'rsa', False, False, True),
+    HandshakeScenario('ecdsa_tls1_2', OpenSslVersionEnum.TLSV1_2, 'ecdsa', False, False, False),
+    HandshakeScenario('rsa_tls1_2_resumption', OpenSslVersionEnum.TLSV1_2, 'rsa', True, False, False),
+    HandshakeScenario('rsa_tls1_2_client_auth', OpenSslVersionEnum.TLSV1_2, 'rsa', False, True, False),
+    # Requires an OpenSSL 1.1.1+ binary for s_server as the one bundled with the tests only supports up to TLS 1.2
+    HandshakeScenario('rsa_tls1_3', OpenSslVersionEnum.TLSV1_3, 'rsa', False, False, False),
+]
+
+CLIENT_CLASSES = [SslClient, LegacySslClient]
+
+# Number of completed connections kept alive to measure the memory used by each of them
+_RSS_CONNECTIONS_COUNT = 50
+_WARMUP_HANDSHAKES_COUNT = 5
+
+
+class BenchmarkOpenSslServer(VulnerableOpenSslServer):
+    """A local s_server for a benchmark scenario, which keeps reading its output so that it never blocks.
+    """
+
+    def __enter__(self):
+        super(BenchmarkOpenSslServer, self).__enter__()
+        # s_server logs every connection; keep reading its output so that it never blocks on a full pipe
+        output_thread = threading.Thread(target=self._discard_output)
+        output_thread.daemon = True
+        output_thread.start()
+        return self
+
+    def __exit__(self, *args):
+        # Stop s_server first so that the output thread gets EOF and releases the pipe before it gets closed
+        if self._process and self._process.poll() is None:
+            self._process.terminate()
+            self._process.wait()
+        return super(BenchmarkOpenSslServer, self).__exit__(*args)
+
+    def _discard_output(self):
+        # type: () -> None
+        try:
+            for _ in iter(self._process.stdout.readline, b''):
+                pass
+        except (IOError, ValueError):
+            # The pipe was closed by __exit__()
+            pass
+
+
+def _generate_ecdsa_certificate(openssl_path, output_dir):
+    # type: (Text, Text) -> List[Text]
+    """Generate a self-signed P-256 certificate and return the paths to the certificate and key.
+    """
+    key_path = os.path.join(output_dir, 'ecdsa-key.pem')
+    cert_path = os.path.join(output_dir, 'ecdsa-cert.pem')
+    # The bundled OpenSSL binary has no default config file, which req requires
+    config_path = os.path.join(output_dir, 'openssl.cnf')
+    with open(config_path, 'w') as config_file:
+        config_file.write('[req]\ndistinguished_name = dn\n[dn]\n')
+
+    subprocess.check_call([openssl_path, 'ecparam', '-name', 'prime256v1', '-genkey', '-noout', '-out', key_path])
+    subprocess.check_call([openssl_path, 'req', '-new', '-x509', '-key', key_path, '-out', cert_path, '-days', '1',
+                           '-subj', '/CN=localhost', '-config', config_path])
+    return [cert_path, key_path]
+
+
+def _find_tls1_3_openssl(openssl_path=None):
+    # type: (Optional[Text]) -> Optional[Text]
+    """Return the path to an OpenSSL binary whose s_server supports TLS 1.3, if any.
+    """
+    openssl_path = openssl_path or 'openssl'
+    try:
+        version_output = subprocess.check_output([openssl_path, 'version']).decode('ascii')
+    except (IOError, OSError, subprocess.CalledProcessError):
+        return None
+
+    version_match = re.search(r'OpenSSL (\d+)\.(\d+)\.(\d+)', version_output)
+    if not version_match or tuple(int(number) for number in version_match.groups()) < (1, 1, 1):
+        return None
+    return openssl_path
+
+
+_MEMORY_LEAN_BIO_BUFFER_SIZE = 4096
+
+
+def _create_ssl_client(client_cls, scenario, underlying_socket):
+    # type: (Type[SslClient], HandshakeScenario, socket.socket) -> SslClient
+    client_kwargs = {}  # type: Dict[str, Any]
+    if scenario.is_client_auth:
+        client_kwargs['client_certchain_file'] = VulnerableOpenSslServer.get_client_certificate_path()
+        client_kwargs['client_key_file'] = VulnerableOpenSslServer.get_client_key_path()
+    if scenario.is_memory_lean:
+        client_kwargs['release_buffers_when_idle'] = True
+        client_kwargs['bio_buffer_size'] = _MEMORY_LEAN_BIO_BUFFER_SIZE
+    return client_cls(underlying_socket=underlying_socket, ssl_version=scenario.ssl_version,
+                      ssl_verify=OpenSslVerifyEnum.NONE, **client_kwargs)
+
+
+def _run_handshakes(client_cls, scenario, server, handshakes_count, session=None, enable_counters=False):
+    # type: (Type[SslClient], HandshakeScenario, VulnerableOpenSslServer, int, Any, bool) -> List[Any]
+    """Perform handshakes against the server and return (connect+handshake latencies, completed clients).
+    """
+    latencies = []
+    ssl_clients = []
+    for _ in range(handshakes_count):
+        start_time = timer()
+        sock = socket.create_connection((server.ip_address, server.port), timeout=5)
+        ssl_client = _create_ssl_client(client_cls, scenario, sock)
+        if session:
+            ssl_client.set_session(session)
+        if enable_counters:
+            ssl_client.enable_connection_counters()
+        ssl_client.do_handshake()
+        latencies.append(timer() - start_time)
+
+        ssl_client.shutdown()
+        sock.close()
+        ssl_clients.append(ssl_client)
+    return [latencies, ssl_clients]
+
+
+def run_scenario(client_cls, scenario, server, handshakes_count):
+    # type: (Type[SslClient], HandshakeScenario, VulnerableOpenSslServer, int) -> Dict[Text, Any]
+    # Warm up the server and the client, and get the session to resume
+    _, warmup_clients = _run_handshakes(client_cls, scenario, server, _WARMUP_HANDSHAKES_COUNT)
+    session = warmup_clients[-1].get_session() if scenario.is_resumption else None
+    del warmup_clients
+
+    # Handshake throughput, latency and OpenSSL allocations
+    allocations_before = get_openssl_allocations_count(client_cls._NASSL_MODULE)
+    start_time = timer()
+    latencies, _ = _run_handshakes(client_cls, scenario, server, handshakes_count, session)
+    total_duration = timer() - start_time
+    allocations_after = get_openssl_allocations_count(client_cls._NASSL_MODULE)
+    allocations_count = None
+    if allocations_before is not None and allocations_after is not None:
+        allocations_count = allocations_after - allocations_before
+
+    # Memory retained by each connection; s_server processes connections one at a time so they cannot all be kept open
+    # at the same time, but the SslClient objects (and their SSL, session and certificates) are
+    # The socket calls per handshake (including the shutdown) are counted on these connections so the counters do not
+    # skew the throughput
+    rss_before = get_rss_bytes()
+    _, ssl_clients = _run_handshakes(client_cls, scenario, server, _RSS_CONNECTIONS_COUNT, session,
+                                     enable_counters=True)
+    rss_after = get_rss_bytes()
+    rss_per_connection = None
+    if rss_before is not None and rss_after is not None:
+        rss_per_connection = (rss_after - rss_before) // len(ssl_clients)
+    counters = [ssl_client.get_connection_counters() for ssl_client in ssl_clients]
+    recv_calls_count = sum(connection_counters.socket_recv_calls for connection_counters in counters)
+    send_calls_count = sum(connection_counters.socket_send_calls for connection_counters in counters)
+    del ssl_clients
+
+    return {
+        'benchmark': 'handshake',
+        'scenario': scenario.name,
+        'client': client_cls.__name__,
+        'handshakes': handshakes_count,
+        'handshakes_per_second': round(handshakes_count / total_duration, 1),
+        'latency_p50_ms': round(get_percentile(latencies, 50) * 1000, 3),
+        'latency_p99_ms': round(get_percentile(latencies, 99) * 1000, 3),
+        'rss_per_connection_bytes': rss_per_connection,
+        'openssl_allocations_per_handshake': get_per_iteration(allocations_count, handshakes_count),
+        'socket_recv_calls_per_handshake': get_per_iteration(recv_calls_count, len(counters)),
+        'socket_send_calls_per_handshake': get_per_iteration(send_calls_count, len(counters)),
+    }
+
+
+def run_benchmarks(handshakes_count, tls1_3_openssl_path=None):
+    # type: (int, Optional[Text]) -> List[Dict[Text, Any]]
+    results = []
+    tls1_3_openssl_path = _find_tls1_3_openssl(tls1_3_openssl_path)
+    certificates_dir = tempfile.mkdtemp()
+    try:
+        ecdsa_cert_path, ecdsa_key_path = _generate_ecdsa_certificate(VulnerableOpenSslServer._OPENSSL_PATH,
+                                                                      certificates_dir)
+        for scenario in SCENARIOS:
+            openssl_path = None
+            if scenario.ssl_version == OpenSslVersionEnum.TLSV1_3:
+                if not tls1_3_openssl_path:
+                    logging.warning('No OpenSSL 1.1.1+ binary available - skipping {}'.format(scenario.name))
+                    continue
+                openssl_path = tls1_3_openssl_path
+
+            if scenario.key_type == 'ecdsa':
+                cert_path, key_path = ecdsa_cert_path, ecdsa_key_path
+            else:
+                cert_path, key_path = VulnerableOpenSslServer._SERVER_CERT_PATH, \
+                                      VulnerableOpenSslServer._SERVER_KEY_PATH
+
+            for client_cls in CLIENT_CLASSES:
+                if scenario.ssl_version == OpenSslVersionEnum.TLSV1_3 and client_cls == LegacySslClient:
+                    # OpenSSL 1.0.2 does not support TLS 1.3
+                    continue
+
+                client_auth_config = ClientAuthenticationServerConfigurationEnum.REQUIRED if scenario.is_client_auth \
+                    else ClientAuthenticationServerConfigurationEnum.DISABLED
+                extra_arguments = '-tls1_3' if scenario.ssl_version == OpenSslVersionEnum.TLSV1_3 else ''
+                with BenchmarkOpenSslServer(
+                    client_auth_config=client_auth_config,
+                    certificate_path=cert_path,
+                    key_path=key_path,
+                    openssl_path=openssl_path,
+                    extra_arguments=extra_arguments,
+                ) as server:
+                    results.append(run_scenario(client_cls, scenario, server, handshakes_count))
+    finally:
+        shutil.rmtree(certificates_dir)
+    return results
+
+
+def main():
+    # type: () -> None
+    parser = get_argument_parser('Benchmark handshakes against local s_server instances.', default_iterations=500)
+    parser.add_argument('--tls1-3-openssl', help='OpenSSL 1.1.1+ binary to run s_server with for the TLS 1.3 '
+                                                 'scenario; defaults to the openssl in the PATH')
+    args = parser.parse_args()
+    write_results(run_benchmarks(args.iterations, args.tls1_3_openssl), args.output)
+
+
+if __name__ == '__main__':
+    main()
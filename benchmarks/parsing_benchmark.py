@@ -0,0 +1,159 @@
+# -*- coding: utf-8 -*-
+"""Microbenchmarks for certificate and OCSP response parsing, over the Mozilla trust store and the OCSP fixtures of the
+tests.
+
+The corpus is made of self-signed root certificates and of synthetic test fixtures only: it does not contain real-world
+leaf or intermediate certificates, nor real-world OCSP responses, so extensions such as SANs, AIA or CRL distribution
+points are barely exercised.
+
+Run with python -m benchmarks.parsing_benchmark; the results are written as JSON.
+"""
+from __future__ import absolute_import
+from __future__ import unicode_literals
+
+import os
+from types import ModuleType
+
+from nassl import _nassl, _nassl_legacy  # type: ignore
+from nassl.ocsp_response import OcspResponse
+from typing import Any
+from typing import Callable
+from typing import Dict
+from typing import List
+from typing import Text
+
+from benchmarks.utils import get_argument_parser, get_openssl_allocations_count, get_per_iteration, timer, \
+    write_results
+
+
+_ROOT_PATH = os.path.join(os.path.dirname(__file__), '..')
+_FIXTURES_PATH = os.path.join(_ROOT_PATH, 'tests', 'fixtures')
+
+# The Mozilla roots plus the synthetic leaf and CA of the OCSP tests; no real-world leaves or intermediates are bundled
+CERTIFICATES_CORPUS_PATHS = [
+    os.path.join(_ROOT_PATH, 'mozilla.pem'),
+    os.path.join(_FIXTURES_PATH, 'ocsp-ca.pem'),
+    os.path.join(_FIXTURES_PATH, 'ocsp-leaf.pem'),
+]
+OCSP_RESPONSE_PATH = os.path.join(_FIXTURES_PATH, 'ocsp-response.der')
+OCSP_TRUST_STORE_PATH = os.path.join(_FIXTURES_PATH, 'ocsp-ca.pem')
+
+_PEM_FOOTER = '-----END CERTIFICATE-----'
+
+# X509.parse_many() is benchmarked with batches of certificates, so each of its calls parses a whole batch
+PARSE_MANY_BATCH_SIZE = 32
+PARSE_MANY_THREADS_COUNT = 4
+
+
+def load_certificates_corpus():
+    # type: () -> List[Text]
+    pem_certificates = []
+    for corpus_path in CERTIFICATES_CORPUS_PATHS:
+        with open(corpus_path) as corpus_file:
+            corpus = corpus_file.read()
+        for pem_certificate in corpus.split(_PEM_FOOTER)[:-1]:
+            pem_certificates.append(pem_certificate[pem_certificate.index('-----BEGIN'):] + _PEM_FOOTER)
+    return pem_certificates
+
+
+def _get_name_entries(certificate):
+    # type: (Any) -> List[Any]
+    return [(entry.get_object(), entry.get_data())
+            for entry in certificate.get_subject_name_entries() + certificate.get_issuer_name_entries()]
+
+
+def _print_extensions(certificate):
+    # type: (Any) -> List[Any]
+    return [(extension.get_object(), extension.get_data()) for extension in certificate.get_extensions()]
+
+
+def _decode_extensions(certificate):
+    # type: (Any) -> List[Any]
+    return [certificate.get_subject_alt_names(), certificate.get_authority_info_access(),
+            certificate.get_crl_distribution_points(), certificate.get_certificate_policies(),
+            certificate.get_basic_constraints(), certificate.get_key_usage(), certificate.get_extended_key_usage()]
+
+
+def _get_operations(nassl_module, pem_certificates, der_ocsp_response):
+    # type: (ModuleType, List[Text], bytes) -> List[Any]
+    """Return (operation name, function, inputs) tuples; each function is called once per input.
+    """
+    certificates = [nassl_module.X509(pem_certificate) for pem_certificate in pem_certificates]
+    batches = [pem_certificates[index:index + PARSE_MANY_BATCH_SIZE]
+               for index in range(0, len(pem_certificates), PARSE_MANY_BATCH_SIZE)]
+    ocsp_response = OcspResponse(nassl_module.OCSP_RESPONSE(der_ocsp_response))
+    return [
+        ('X509()', nassl_module.X509, pem_certificates),
+        ('X509.parse_many() x{}'.format(PARSE_MANY_BATCH_SIZE), nassl_module.X509.parse_many, batches),
+        ('X509.parse_many() x{}, {} threads'.format(PARSE_MANY_BATCH_SIZE, PARSE_MANY_THREADS_COUNT),
+         lambda batch: nassl_module.X509.parse_many(batch, PARSE_MANY_THREADS_COUNT), batches),
+        ('X509.get_extensions()', lambda certificate: certificate.get_extensions(), certificates),
+        ('X509.get_extension()', lambda certificate: certificate.get_extension('basicConstraints'), certificates),
+        ('X509_EXTENSION.get_data() for all extensions', _print_extensions, certificates),
+        ('X509.get_subject_alt_names(), etc.', _decode_extensions, certificates),
+        ('X509.get_*_name_entries()', _get_name_entries, certificates),
+        ('X509.get_subject() and get_issuer()',
+         lambda certificate: (certificate.get_subject(), certificate.get_issuer()), certificates),
+        ('X509.as_text()', lambda certificate: certificate.as_text(), certificates),
+        ('X509.digest()', lambda certificate: certificate.digest(), certificates),
+        ('X509.get_notAfter()', lambda certificate: certificate.get_notAfter(), certificates),
+        ('X509.get_notAfter_timestamp()', lambda certificate: certificate.get_notAfter_timestamp(), certificates),
+        ('X509.get_serialNumber_int()', lambda certificate: certificate.get_serialNumber_int(), certificates),
+        ('OcspResponse.as_dict()',
+         lambda der_response: OcspResponse(nassl_module.OCSP_RESPONSE(der_response)).as_dict(), [der_ocsp_response]),
+        ('OcspResponse.verify()', lambda trust_store_path: ocsp_response.verify(trust_store_path),
+         [OCSP_TRUST_STORE_PATH]),
+    ]
+
+
+def run_operation(nassl_module, operation_name, function, inputs, iterations_count):
+    # type: (ModuleType, Text, Callable, List[Any], int) -> Dict[Text, Any]
+    # Warm up
+    for operation_input in inputs:
+        function(operation_input)
+
+    calls_count = 0
+    allocations_before = get_openssl_allocations_count(nassl_module)
+    start_time = timer()
+    while calls_count < iterations_count:
+        for operation_input in inputs:
+            function(operation_input)
+        calls_count += len(inputs)
+    total_duration = timer() - start_time
+    allocations_after = get_openssl_allocations_count(nassl_module)
+    allocations_count = None
+    if allocations_before is not None and allocations_after is not None:
+        allocations_count = allocations_after - allocations_before
+
+    return {
+        'benchmark': 'parsing',
+        'module': nassl_module.__name__.split('.')[-1],
+        'operation': operation_name,
+        'calls': calls_count,
+        'operations_per_second': round(calls_count / total_duration, 1),
+        'openssl_allocations_per_call': get_per_iteration(allocations_count, calls_count),
+    }
+
+
+def run_benchmarks(iterations_count):
+    # type: (int) -> List[Dict[Text, Any]]
+    pem_certificates = load_certificates_corpus()
+    with open(OCSP_RESPONSE_PATH, 'rb') as ocsp_file:
+        der_ocsp_response = ocsp_file.read()
+
+    results = []
+    for nassl_module in [_nassl, _nassl_legacy]:
+        for operation_name, function, inputs in _get_operations(nassl_module, pem_certificates, der_ocsp_response):
+            results.append(run_operation(nassl_module, operation_name, function, inputs, iterations_count))
+    return results
+
+
+def main():
+    # type: () -> None
+    parser = get_argument_parser('Benchmark certificate and OCSP response parsing.', default_iterations=5000)
+    args = parser.parse_args()
+    write_results(run_benchmarks(args.iterations), args.output)
+
+
+if __name__ == '__main__':
+    main()
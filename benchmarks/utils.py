@@ -0,0 +1,83 @@
+# -*- coding: utf-8 -*-
+from __future__ import absolute_import
+from __future__ import unicode_literals
+
+import argparse
+import gc
+import json
+import os
+import platform
+import sys
+import time
+from types import ModuleType
+
+from nassl import __version__ as nassl_version
+from typing import Any
+from typing import Dict
+from typing import List
+from typing import Optional
+
+
+# time.perf_counter() is not available on Python 2
+timer = getattr(time, 'perf_counter', time.time)
+
+
+def get_percentile(values, percentile):
+    # type: (List[float], float) -> float
+    """Nearest-rank percentile of the values.
+    """
+    sorted_values = sorted(values)
+    index = int(round(percentile / 100.0 * (len(sorted_values) - 1)))
+    return sorted_values[index]
+
+
+def get_rss_bytes():
+    # type: () -> Optional[int]
+    """Current resident set size of the process, or None if it cannot be retrieved on this platform.
+    """
+    gc.collect()
+    try:
+        with open('/proc/self/statm') as statm_file:
+            return int(statm_file.read().split()[1]) * os.sysconf(str('SC_PAGE_SIZE'))
+    except (IOError, OSError, ValueError):
+        return None
+
+
+def get_openssl_allocations_count(nassl_module):
+    # type: (ModuleType) -> Optional[int]
+    """Number of allocations performed so far by the OpenSSL linked into the given nassl module, or None if allocation
+    counting could not be enabled (ie. NASSL_COUNT_ALLOCATIONS was not set when the module was loaded).
+    """
+    return nassl_module.get_allocations_count()
+
+
+def get_per_iteration(total, iterations_count):
+    # type: (Optional[float], int) -> Optional[float]
+    if total is None:
+        return None
+    return round(float(total) / iterations_count, 1)
+
+
+def get_argument_parser(description, default_iterations):
+    # type: (str, int) -> argparse.ArgumentParser
+    parser = argparse.ArgumentParser(description=description)
+    parser.add_argument('--iterations', type=int, default=default_iterations,
+                        help='number of operations to time for each benchmark')
+    parser.add_argument('--output', help='file to write the JSON results to instead of stdout')
+    return parser
+
+
+def write_results(results, output_path=None):
+    # type: (List[Dict[str, Any]], Optional[str]) -> None
+    report = {
+        'nassl_version': nassl_version,
+        'python_version': platform.python_version(),
+        'platform': platform.platform(),
+        'results': results,
+    }
+    report_json = json.dumps(report, indent=2, sort_keys=True)
+    if output_path:
+        with open(output_path, 'w') as output_file:
+            output_file.write(report_json)
+    else:
+        sys.stdout.write(report_json + '\n')
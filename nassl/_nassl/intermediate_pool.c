@@ -0,0 +1,469 @@
+#include <Python.h>
+
+// Fix symbol clashing on Windows
+// https://bugs.launchpad.net/pyopenssl/+bug/570101
+#ifdef _WIN32
+#include "winsock.h"
+#endif
+
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
+#include "pythread.h"
+
+#include "intermediate_pool.h"
+#include "nassl_X509.h"
+
+
+// Longest chain of intermediates that can be completed from the pool
+#define MAX_POOL_CHAIN_LENGTH 10
+
+// Subject key identifiers longer than this are not used for detecting duplicates
+#define MAX_KEY_ID_SIZE 64
+
+typedef struct {
+    X509 *certificate; // NULL if the slot is free
+    unsigned long subjectHash;
+    unsigned char keyId[MAX_KEY_ID_SIZE];
+    int keyIdSize;
+    int nextEntryInBucket; // -1 at the end of the bucket
+} IntermediatePoolEntry;
+
+typedef struct {
+    PyThread_type_lock lock; // Allocated once and never freed, as a disabled pool may still be used by another thread
+    int isEnabled;
+
+    // The oldest certificate gets replaced once all the slots are used
+    IntermediatePoolEntry *entries;
+    int capacity;
+    int size;
+    int nextSlot;
+
+    // Index of the first entry of each bucket, by subject name hash
+    int *buckets;
+    unsigned long bucketsMask;
+
+    unsigned long long hitsCount;
+    unsigned long long addedCount;
+} IntermediatePool;
+
+static IntermediatePool pool;
+
+// State of a verification done by intermediate_pool_verify_cert(), stored in the ex_data of its X509_STORE_CTX
+typedef struct {
+    int (*verifyCallback)(int, X509_STORE_CTX *); // The callback that was set before the verification
+    int hasErrors; // Set if an error was reported, even if the callback then ignored it
+} PoolVerifyState;
+
+static int poolVerifyStateIndex = -1;
+
+
+static int get_subject_key_id(X509 *certificate, unsigned char *keyIdOut)
+{
+    const ASN1_OCTET_STRING *keyId = NULL;
+#ifdef LEGACY_OPENSSL
+    // Populates the cached extensions
+    X509_check_purpose(certificate, -1, 0);
+    keyId = certificate->skid;
+#else
+    keyId = X509_get0_subject_key_id(certificate);
+#endif
+    if ((keyId == NULL) || (keyId->length > MAX_KEY_ID_SIZE))
+    {
+        return 0;
+    }
+    memcpy(keyIdOut, keyId->data, keyId->length);
+    return keyId->length;
+}
+
+
+// Returns the size of the key identifier in the certificate's authority key identifier extension, or 0 if there is none
+static int get_authority_key_id(X509 *certificate, unsigned char *keyIdOut)
+{
+    int keyIdSize = 0;
+    AUTHORITY_KEYID *authorityKeyId = (AUTHORITY_KEYID *) X509_get_ext_d2i(certificate, NID_authority_key_identifier,
+                                                                           NULL, NULL);
+    if (authorityKeyId == NULL)
+    {
+        return 0;
+    }
+    if ((authorityKeyId->keyid != NULL) && (authorityKeyId->keyid->length <= MAX_KEY_ID_SIZE))
+    {
+        keyIdSize = authorityKeyId->keyid->length;
+        memcpy(keyIdOut, authorityKeyId->keyid->data, keyIdSize);
+    }
+    AUTHORITY_KEYID_free(authorityKeyId);
+    return keyIdSize;
+}
+
+
+static void clear_pool_locked(void)
+{
+    int i = 0;
+    for (i = 0; i < pool.capacity; i++)
+    {
+        X509_free(pool.entries[i].certificate);
+        pool.entries[i].certificate = NULL;
+    }
+    for (i = 0; i <= (int) pool.bucketsMask; i++)
+    {
+        pool.buckets[i] = -1;
+    }
+    pool.size = 0;
+    pool.nextSlot = 0;
+}
+
+
+int intermediate_pool_enable(int maxSize)
+{
+    IntermediatePoolEntry *newEntries = NULL, *oldEntries = NULL;
+    int *newBuckets = NULL, *oldBuckets = NULL;
+    unsigned long bucketsCount = 1;
+
+    if (pool.lock == NULL)
+    {
+        pool.lock = PyThread_allocate_lock();
+        if (pool.lock == NULL)
+        {
+            return 0;
+        }
+    }
+    if (poolVerifyStateIndex < 0)
+    {
+        poolVerifyStateIndex = X509_STORE_CTX_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+        if (poolVerifyStateIndex < 0)
+        {
+            return 0;
+        }
+    }
+
+    while (bucketsCount < (unsigned long) maxSize)
+    {
+        bucketsCount *= 2;
+    }
+    newEntries = (IntermediatePoolEntry *) PyMem_Malloc(maxSize * sizeof(IntermediatePoolEntry));
+    newBuckets = (int *) PyMem_Malloc(bucketsCount * sizeof(int));
+    if ((newEntries == NULL) || (newBuckets == NULL))
+    {
+        PyMem_Free(newEntries);
+        PyMem_Free(newBuckets);
+        return 0;
+    }
+    memset(newEntries, 0, maxSize * sizeof(IntermediatePoolEntry));
+
+    PyThread_acquire_lock(pool.lock, WAIT_LOCK);
+    if (pool.entries != NULL)
+    {
+        clear_pool_locked();
+    }
+    oldEntries = pool.entries;
+    oldBuckets = pool.buckets;
+    pool.entries = newEntries;
+    pool.capacity = maxSize;
+    pool.buckets = newBuckets;
+    pool.bucketsMask = bucketsCount - 1;
+    clear_pool_locked();
+    pool.hitsCount = 0;
+    pool.addedCount = 0;
+    pool.isEnabled = 1;
+    PyThread_release_lock(pool.lock);
+
+    PyMem_Free(oldEntries);
+    PyMem_Free(oldBuckets);
+    return 1;
+}
+
+
+void intermediate_pool_disable(void)
+{
+    IntermediatePoolEntry *oldEntries = NULL;
+    int *oldBuckets = NULL;
+    if (pool.lock == NULL)
+    {
+        return;
+    }
+
+    PyThread_acquire_lock(pool.lock, WAIT_LOCK);
+    if (pool.entries != NULL)
+    {
+        clear_pool_locked();
+    }
+    oldEntries = pool.entries;
+    oldBuckets = pool.buckets;
+    pool.entries = NULL;
+    pool.buckets = NULL;
+    pool.capacity = 0;
+    pool.bucketsMask = 0;
+    pool.isEnabled = 0;
+    PyThread_release_lock(pool.lock);
+
+    PyMem_Free(oldEntries);
+    PyMem_Free(oldBuckets);
+}
+
+
+int intermediate_pool_get_stats(int *sizeOut, unsigned long long *hitsCountOut, unsigned long long *addedCountOut)
+{
+    if ((pool.lock == NULL) || (!pool.isEnabled))
+    {
+        return 0;
+    }
+    PyThread_acquire_lock(pool.lock, WAIT_LOCK);
+    *sizeOut = pool.size;
+    *hitsCountOut = pool.hitsCount;
+    *addedCountOut = pool.addedCount;
+    PyThread_release_lock(pool.lock);
+    return 1;
+}
+
+
+// Issuers are looked up by subject name hash and, as intermediates that were cross-signed or rekeyed share the same
+// subject, by subject key identifier when the certificate has an authority key identifier
+static X509* find_issuer_in_pool_locked(X509 *certificate)
+{
+    unsigned char authorityKeyId[MAX_KEY_ID_SIZE];
+    unsigned long issuerHash = X509_NAME_hash(X509_get_issuer_name(certificate));
+    int authorityKeyIdSize = get_authority_key_id(certificate, authorityKeyId);
+    int entryIndex = pool.buckets[issuerHash & pool.bucketsMask];
+    while (entryIndex != -1)
+    {
+        IntermediatePoolEntry *entry = &pool.entries[entryIndex];
+        entryIndex = entry->nextEntryInBucket;
+        if (entry->subjectHash != issuerHash)
+        {
+            continue;
+        }
+        if ((authorityKeyIdSize > 0) && (entry->keyIdSize > 0)
+            && ((entry->keyIdSize != authorityKeyIdSize) || (memcmp(entry->keyId, authorityKeyId, authorityKeyIdSize) != 0)))
+        {
+            continue;
+        }
+        if (X509_check_issued(entry->certificate, certificate) == X509_V_OK)
+        {
+            return entry->certificate;
+        }
+    }
+    return NULL;
+}
+
+
+static X509* find_issuer_in_stack(STACK_OF(X509) *certificates, X509 *certificate)
+{
+    int i = 0;
+    for (i = 0; i < sk_X509_num(certificates); i++)
+    {
+        X509 *candidate = sk_X509_value(certificates, i);
+        if (X509_check_issued(candidate, certificate) == X509_V_OK)
+        {
+            return candidate;
+        }
+    }
+    return NULL;
+}
+
+
+// Returns a new stack containing the untrusted certificates and the missing intermediates, or NULL if no intermediates
+// were found in the pool; all the certificates in the stack are referenced by it
+static STACK_OF(X509)* complete_untrusted_chain(X509 *leaf, STACK_OF(X509) *untrusted)
+{
+    STACK_OF(X509) *completedChain = NULL;
+    X509 *currentCertificate = leaf;
+    int i = 0;
+
+    PyThread_acquire_lock(pool.lock, WAIT_LOCK);
+    for (i = 0; (i < MAX_POOL_CHAIN_LENGTH) && pool.isEnabled && (pool.size > 0); i++)
+    {
+        X509 *issuer = NULL;
+        if (X509_check_issued(currentCertificate, currentCertificate) == X509_V_OK)
+        {
+            // Self-issued; the rest of the chain is up to the trust store
+            break;
+        }
+
+        issuer = find_issuer_in_stack((completedChain != NULL) ? completedChain : untrusted, currentCertificate);
+        if (issuer == NULL)
+        {
+            int j = 0;
+            issuer = find_issuer_in_pool_locked(currentCertificate);
+            if (issuer == NULL)
+            {
+                break;
+            }
+
+            if (completedChain == NULL)
+            {
+                completedChain = sk_X509_new_null();
+                if (completedChain == NULL)
+                {
+                    break;
+                }
+                for (j = 0; j < sk_X509_num(untrusted); j++)
+                {
+                    if (!sk_X509_push(completedChain, sk_X509_value(untrusted, j)))
+                    {
+                        break;
+                    }
+                    X509_up_ref(sk_X509_value(untrusted, j));
+                }
+            }
+            if (!sk_X509_push(completedChain, issuer))
+            {
+                break;
+            }
+            X509_up_ref(issuer);
+            pool.hitsCount++;
+        }
+        currentCertificate = issuer;
+    }
+    PyThread_release_lock(pool.lock);
+    return completedChain;
+}
+
+
+static void add_to_pool_locked(X509 *certificate)
+{
+    IntermediatePoolEntry *entry = NULL;
+    unsigned char keyId[MAX_KEY_ID_SIZE];
+    unsigned long subjectHash = X509_NAME_hash(X509_get_subject_name(certificate));
+    int keyIdSize = get_subject_key_id(certificate, keyId);
+    int entryIndex = pool.buckets[subjectHash & pool.bucketsMask];
+    int *previousLink = NULL;
+
+    // Skip certificates that are already in the pool, or intermediates with the same subject and key
+    while (entryIndex != -1)
+    {
+        entry = &pool.entries[entryIndex];
+        if (entry->subjectHash == subjectHash)
+        {
+            if ((keyIdSize > 0) && (entry->keyIdSize == keyIdSize) && (memcmp(entry->keyId, keyId, keyIdSize) == 0))
+            {
+                return;
+            }
+            if (X509_cmp(entry->certificate, certificate) == 0)
+            {
+                return;
+            }
+        }
+        entryIndex = entry->nextEntryInBucket;
+    }
+
+    // Replace the oldest certificate if the pool is full
+    entry = &pool.entries[pool.nextSlot];
+    if (entry->certificate != NULL)
+    {
+        previousLink = &pool.buckets[entry->subjectHash & pool.bucketsMask];
+        while (*previousLink != pool.nextSlot)
+        {
+            previousLink = &pool.entries[*previousLink].nextEntryInBucket;
+        }
+        *previousLink = entry->nextEntryInBucket;
+        X509_free(entry->certificate);
+        pool.size--;
+    }
+
+    X509_up_ref(certificate);
+    entry->certificate = certificate;
+    entry->subjectHash = subjectHash;
+    memcpy(entry->keyId, keyId, keyIdSize);
+    entry->keyIdSize = keyIdSize;
+    entry->nextEntryInBucket = pool.buckets[subjectHash & pool.bucketsMask];
+    pool.buckets[subjectHash & pool.bucketsMask] = pool.nextSlot;
+
+    pool.nextSlot = (pool.nextSlot + 1) % pool.capacity;
+    pool.size++;
+    pool.addedCount++;
+}
+
+
+static void add_verified_chain_to_pool(STACK_OF(X509) *verifiedChain)
+{
+    int i = 0;
+    PyThread_acquire_lock(pool.lock, WAIT_LOCK);
+    // Skip the leaf and the root
+    for (i = 1; (i < sk_X509_num(verifiedChain)) && pool.isEnabled; i++)
+    {
+        X509 *certificate = sk_X509_value(verifiedChain, i);
+        if ((X509_check_issued(certificate, certificate) != X509_V_OK) && (X509_check_ca(certificate) > 0))
+        {
+            add_to_pool_locked(certificate);
+        }
+    }
+    PyThread_release_lock(pool.lock);
+}
+
+
+// Records that the chain has errors and forwards them to the callback that was set before the verification, which may
+// ignore them (for example to collect every error of the chain) and make X509_verify_cert() succeed
+static int pool_verify_callback(int isOk, X509_STORE_CTX *x509StoreCtx)
+{
+    PoolVerifyState *verifyState = (PoolVerifyState *) X509_STORE_CTX_get_ex_data(x509StoreCtx, poolVerifyStateIndex);
+    if (!isOk)
+    {
+        verifyState->hasErrors = 1;
+    }
+    if (verifyState->verifyCallback == NULL)
+    {
+        return isOk;
+    }
+    return verifyState->verifyCallback(isOk, x509StoreCtx);
+}
+
+
+int intermediate_pool_verify_cert(X509_STORE_CTX *x509StoreCtx, void *arg)
+{
+    STACK_OF(X509) *untrusted = NULL, *completedChain = NULL, *verifiedChain = NULL;
+    X509 *leaf = NULL;
+    PoolVerifyState verifyState;
+    int verifyResult = 0;
+
+    if ((pool.lock == NULL) || (!pool.isEnabled))
+    {
+        return X509_verify_cert(x509StoreCtx);
+    }
+
+#ifdef LEGACY_OPENSSL
+    leaf = x509StoreCtx->cert;
+    untrusted = x509StoreCtx->untrusted;
+    verifyState.verifyCallback = x509StoreCtx->verify_cb;
+#else
+    leaf = X509_STORE_CTX_get0_cert(x509StoreCtx);
+    untrusted = X509_STORE_CTX_get0_untrusted(x509StoreCtx);
+    verifyState.verifyCallback = X509_STORE_CTX_get_verify_cb(x509StoreCtx);
+#endif
+    verifyState.hasErrors = 0;
+    if (!X509_STORE_CTX_set_ex_data(x509StoreCtx, poolVerifyStateIndex, &verifyState))
+    {
+        return X509_verify_cert(x509StoreCtx);
+    }
+    X509_STORE_CTX_set_verify_cb(x509StoreCtx, pool_verify_callback);
+
+    completedChain = complete_untrusted_chain(leaf, untrusted);
+    if (completedChain != NULL)
+    {
+        X509_STORE_CTX_set_chain(x509StoreCtx, completedChain);
+    }
+
+    verifyResult = X509_verify_cert(x509StoreCtx);
+    X509_STORE_CTX_set_verify_cb(x509StoreCtx, verifyState.verifyCallback);
+    X509_STORE_CTX_set_ex_data(x509StoreCtx, poolVerifyStateIndex, NULL);
+
+    // Only pool the intermediates of chains that are valid, as X509_verify_cert() also succeeds when the callback
+    // ignores the errors; otherwise an untrusted intermediate could shadow the real one in the pool
+    if ((verifyResult == 1) && (!verifyState.hasErrors) && (X509_STORE_CTX_get_error(x509StoreCtx) == X509_V_OK))
+    {
+        verifiedChain = X509_STORE_CTX_get1_chain(x509StoreCtx);
+        if (verifiedChain != NULL)
+        {
+            add_verified_chain_to_pool(verifiedChain);
+            sk_X509_pop_free(verifiedChain, X509_free);
+        }
+    }
+
+    // The X509_STORE_CTX does not own the untrusted chain
+    if (completedChain != NULL)
+    {
+        X509_STORE_CTX_set_chain(x509StoreCtx, untrusted);
+        sk_X509_pop_free(completedChain, X509_free);
+    }
+    return verifyResult;
+}
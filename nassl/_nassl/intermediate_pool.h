@@ -0,0 +1,24 @@
+#pragma once
+
+#include <openssl/x509.h>
+
+// Process-wide pool of intermediate certificates taken from chains that were successfully verified, used to complete
+// the chains sent by servers that omit some of their intermediates
+// The pool is indexed by subject name hash and subject key identifier, and can be used without holding the GIL, as
+// OpenSSL may verify certificates in a thread that released it
+
+// Enable the pool with room for maxSize certificates or resize it, which empties it; has to be called with the GIL held
+// Returns 0 if the memory could not be allocated
+int intermediate_pool_enable(int maxSize);
+
+// Disable the pool and release its certificates; has to be called with the GIL held
+void intermediate_pool_disable(void);
+
+// Returns 0 if the pool is disabled
+int intermediate_pool_get_stats(int *sizeOut, unsigned long long *hitsCountOut, unsigned long long *addedCountOut);
+
+// Verify the certificate in the X509_STORE_CTX with X509_verify_cert(), after adding the intermediates from the pool
+// that are missing from its untrusted chain; if the chain is valid, its intermediates are added to the pool; a chain
+// whose errors were ignored by the verify callback is not considered valid
+// Has the signature of an SSL_CTX_set_cert_verify_callback() callback
+int intermediate_pool_verify_cert(X509_STORE_CTX *x509StoreCtx, void *arg);
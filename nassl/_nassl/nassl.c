@@ -6,8 +6,16 @@
 #include "winsock.h"
 #endif
 
+#include <stdlib.h>
+#include <string.h>
+
 #include <openssl/ssl.h>
 #include <openssl/rand.h>
+#include <openssl/crypto.h>
+
+#ifdef LEGACY_OPENSSL
+#include "pythread.h"
+#endif
 
 #include "nassl_errors.h"
 #include "nassl_SSL_CTX.h"
@@ -16,12 +24,143 @@
 #include "nassl_X509.h"
 #include "nassl_X509_EXTENSION.h"
 #include "nassl_X509_NAME_ENTRY.h"
+#include "nassl_X509_STORE.h"
 #include "nassl_SSL_SESSION.h"
 #include "nassl_OCSP_RESPONSE.h"
+#include "nassl_tls_codec.h"
+#include "nassl_cipher_table.h"
+
+
+#ifdef LEGACY_OPENSSL
+// OpenSSL 1.0.2 is only thread-safe if the application provides locking callbacks, which is required as some of the
+// native methods (cipher suite enumeration, etc.) run without holding the GIL
+static PyThread_type_lock *openSslLocks = NULL;
+
+static void openssl_locking_callback(int mode, int type, const char *file, int line)
+{
+    if (mode & CRYPTO_LOCK)
+    {
+        PyThread_acquire_lock(openSslLocks[type], WAIT_LOCK);
+    }
+    else
+    {
+        PyThread_release_lock(openSslLocks[type]);
+    }
+}
+
+static void openssl_threadid_callback(CRYPTO_THREADID *threadId)
+{
+    CRYPTO_THREADID_set_numeric(threadId, PyThread_get_thread_ident());
+}
+
+static int init_openssl_locks(void)
+{
+    int i = 0;
+    int locksCount = CRYPTO_num_locks();
+
+    openSslLocks = (PyThread_type_lock *) PyMem_Malloc(sizeof(PyThread_type_lock) * locksCount);
+    if (openSslLocks == NULL)
+    {
+        return 0;
+    }
+    for (i = 0; i < locksCount; i++)
+    {
+        openSslLocks[i] = PyThread_allocate_lock();
+        if (openSslLocks[i] == NULL)
+        {
+            while (i > 0)
+            {
+                PyThread_free_lock(openSslLocks[--i]);
+            }
+            PyMem_Free(openSslLocks);
+            openSslLocks = NULL;
+            return 0;
+        }
+    }
+    CRYPTO_THREADID_set_callback(openssl_threadid_callback);
+    CRYPTO_set_locking_callback(openssl_locking_callback);
+    return 1;
+}
+#endif
+
+
+// Allocation counting for the benchmarks; OpenSSL only accepts custom memory functions before its first allocation so
+// this has to be enabled with the NASSL_COUNT_ALLOCATIONS environment variable, which is read when the module is loaded
+// The counter is incremented atomically as OpenSSL allocates from threads that released the GIL
+static int isAllocationCountingEnabled = 0;
+static volatile long long allocationsCount = 0;
+
+static void increment_allocations_count(void)
+{
+#ifdef _WIN32
+    InterlockedIncrement64(&allocationsCount);
+#else
+    __sync_fetch_and_add(&allocationsCount, 1);
+#endif
+}
+
+#ifdef LEGACY_OPENSSL
+static void* counting_malloc(size_t num)
+{
+    increment_allocations_count();
+    return malloc(num);
+}
+
+static void* counting_realloc(void *ptr, size_t num)
+{
+    increment_allocations_count();
+    return realloc(ptr, num);
+}
+
+static void counting_free(void *ptr)
+{
+    free(ptr);
+}
+#else
+static void* counting_malloc(size_t num, const char *file, int line)
+{
+    increment_allocations_count();
+    return malloc(num);
+}
+
+static void* counting_realloc(void *ptr, size_t num, const char *file, int line)
+{
+    increment_allocations_count();
+    return realloc(ptr, num);
+}
+
+static void counting_free(void *ptr, const char *file, int line)
+{
+    free(ptr);
+}
+#endif
+
+static void init_allocation_counting(void)
+{
+    const char *envValue = getenv("NASSL_COUNT_ALLOCATIONS");
+    if ((envValue == NULL) || (envValue[0] == '\0') || (strcmp(envValue, "0") == 0))
+    {
+        return;
+    }
+    isAllocationCountingEnabled = CRYPTO_set_mem_functions(counting_malloc, counting_realloc, counting_free);
+}
+
+
+static PyObject* nassl_get_allocations_count(PyObject *self, PyObject *args)
+{
+    if (!isAllocationCountingEnabled)
+    {
+        Py_RETURN_NONE;
+    }
+    return PyLong_FromLongLong(allocationsCount);
+}
 
 
 static PyMethodDef nassl_methods[] =
 {
+    {"get_allocations_count", nassl_get_allocations_count, METH_NOARGS,
+     "Return the number of allocations performed by OpenSSL since the module was loaded, or None if the module was not loaded with NASSL_COUNT_ALLOCATIONS set."
+    },
     {NULL}  /* Sentinel */
 };
 
@@ -107,10 +246,18 @@ PyMODINIT_FUNC init_nassl(void)
     PyObject* module;
     struct module_state *state;
 
+    // Has to be done before OpenSSL allocates anything
+    init_allocation_counting();
+
     // Initialize OpenSSL
 #ifdef LEGACY_OPENSSL
     SSL_library_init();
     SSL_load_error_strings();
+    if (!init_openssl_locks())
+    {
+        PyErr_NoMemory();
+        INITERROR;
+    }
 #else
     OPENSSL_init_ssl(0, NULL);
 #endif
@@ -148,8 +295,17 @@ PyMODINIT_FUNC init_nassl(void)
     module_add_X509(module);
     module_add_X509_EXTENSION(module);
     module_add_X509_NAME_ENTRY(module);
+    if (!module_add_X509_STORE(module))
+    {
+        INITERROR;
+    }
     module_add_SSL_SESSION(module);
     module_add_OCSP_RESPONSE(module);
+    module_add_tls_codec(module);
+    if (!module_add_cipher_table(module))
+    {
+        INITERROR;
+    }
 
     state = GETSTATE(module);
     state->error = PyErr_NewException("nassl._nassl.Error", NULL, NULL);
@@ -101,6 +101,13 @@ static PyObject* nassl_BIO_pending(nassl_BIO_Object *self, PyObject *args)
 }
 
 
+static PyObject* nassl_BIO_get_write_guarantee(nassl_BIO_Object *self, PyObject *args)
+{
+    size_t returnValue = BIO_ctrl_get_write_guarantee(self->bio);
+    return Py_BuildValue("I", returnValue);
+}
+
+
 static PyObject* nassl_BIO_write(nassl_BIO_Object *self, PyObject *args)
 {
     PyObject *res = NULL;
@@ -129,6 +136,24 @@ static PyObject* nassl_BIO_write(nassl_BIO_Object *self, PyObject *args)
 }
 
 
+static PyObject* nassl_BIO_set_write_buf_size(nassl_BIO_Object *self, PyObject *args)
+{
+    unsigned int bufferSize = 0;
+    if (!PyArg_ParseTuple(args, "I", &bufferSize))
+    {
+        return NULL;
+    }
+
+    // Only works before the BIO gets paired, as that is when the buffer is allocated
+    if (BIO_set_write_buf_size(self->bio, bufferSize) != 1)
+    {
+        PyErr_SetString(PyExc_ValueError, "BIO_set_write_buf_size() failed; the BIO may already be part of a pair");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+
 static PyMethodDef nassl_BIO_Object_methods[] =
 {
     {"read", (PyCFunction)nassl_BIO_read, METH_VARARGS,
@@ -137,9 +162,15 @@ static PyMethodDef nassl_BIO_Object_methods[] =
     {"pending", (PyCFunction)nassl_BIO_pending, METH_NOARGS,
      "OpenSSL's BIO_ctrl_pending()."
     },
+    {"get_write_guarantee", (PyCFunction)nassl_BIO_get_write_guarantee, METH_NOARGS,
+     "OpenSSL's BIO_ctrl_get_write_guarantee()."
+    },
     {"write", (PyCFunction)nassl_BIO_write, METH_VARARGS,
      "OpenSSL's BIO_write()."
     },
+    {"set_write_buf_size", (PyCFunction)nassl_BIO_set_write_buf_size, METH_VARARGS,
+     "OpenSSL's BIO_set_write_buf_size()."
+    },
     {"make_bio_pair", (PyCFunction)nassl_BIO_make_bio_pair, METH_VARARGS | METH_STATIC,
      "OpenSSL's BIO_make_bio_pair()."
     },
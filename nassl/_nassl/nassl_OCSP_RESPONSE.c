@@ -13,12 +13,44 @@
 #include "python_utils.h"
 #include "nassl_errors.h"
 #include "nassl_OCSP_RESPONSE.h"
+#include "nassl_X509.h"
+#include "ocsp_stapling.h"
 
 
+// nassl.OCSP_RESPONSE.new(); objects are usually returned by SSL.get_tlsext_status_ocsp_resp() but they can also be
+// created from a DER-encoded response (stored responses, benchmarks, etc.), without a peer certificate chain
 static PyObject* nassl_OCSP_RESPONSE_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
-    PyErr_SetString(PyExc_NotImplementedError, "Cannot directly create an OCSP_RESPONSE object. Get it from SSL.get_tlsext_status_ocsp_resp()");
-    return NULL;
+    nassl_OCSP_RESPONSE_Object *self;
+    const unsigned char *derResponse = NULL;
+    int derResponseSize = 0;
+
+    if (!PyArg_ParseTuple(args, "s#", &derResponse, &derResponseSize))
+    {
+        return NULL;
+    }
+
+    self = (nassl_OCSP_RESPONSE_Object *)type->tp_alloc(type, 0);
+    if (self == NULL)
+    {
+        return NULL;
+    }
+
+    self->ocspResp = d2i_OCSP_RESPONSE(NULL, &derResponse, derResponseSize);
+    if (self->ocspResp == NULL)
+    {
+        Py_DECREF(self);
+        PyErr_SetString(PyExc_ValueError, "Could not parse the supplied DER OCSP response");
+        return NULL;
+    }
+
+    self->peerCertChain = sk_X509_new_null();
+    if (self->peerCertChain == NULL)
+    {
+        Py_DECREF(self);
+        return raise_OpenSSL_error();
+    }
+    return (PyObject *)self;
 }
 
 
@@ -121,6 +153,7 @@ static PyObject* nassl_OCSP_RESPONSE_basic_verify(nassl_OCSP_RESPONSE_Object *se
 
     verifyRes = OCSP_basic_verify(basicResp, NULL, trustedCAs, 0);
     OCSP_BASICRESP_free(basicResp);
+    X509_STORE_free(trustedCAs);
     if (verifyRes <= 0)
     {
         return raise_OpenSSL_error();
@@ -136,6 +169,24 @@ static PyObject* nassl_OCSP_RESPONSE_status(nassl_OCSP_RESPONSE_Object *self)
 }
 
 
+static PyObject* nassl_OCSP_RESPONSE_get_certificate_status(nassl_OCSP_RESPONSE_Object *self, PyObject *args)
+{
+    nassl_X509_Object *leaf_Object = NULL, *issuer_Object = NULL;
+    OcspStaplingVerdict verdict;
+    if (!PyArg_ParseTuple(args, "O!O!", &nassl_X509_Type, &leaf_Object, &nassl_X509_Type, &issuer_Object))
+    {
+        return NULL;
+    }
+
+    ocsp_stapling_find_certificate_status(self->ocspResp, leaf_Object->x509, issuer_Object->x509, &verdict);
+    if (verdict.certificateStatus < 0)
+    {
+        Py_RETURN_NONE;
+    }
+    return Py_BuildValue("(iN)", verdict.certificateStatus, PyBool_FromLong(verdict.isResponseCurrent));
+}
+
+
 static PyMethodDef nassl_OCSP_RESPONSE_Object_methods[] =
 {
     {"as_text", (PyCFunction)nassl_OCSP_RESPONSE_as_text, METH_NOARGS,
@@ -144,6 +195,9 @@ static PyMethodDef nassl_OCSP_RESPONSE_Object_methods[] =
     {"basic_verify", (PyCFunction)nassl_OCSP_RESPONSE_basic_verify, METH_VARARGS,
      "OpenSSL's OCSP_basic_verify()."
     },
+    {"get_certificate_status", (PyCFunction)nassl_OCSP_RESPONSE_get_certificate_status, METH_VARARGS,
+     "Returns the status of the supplied leaf X509 object issued by the supplied issuer X509 object as a (V_OCSP_CERTSTATUS_XXX, is current) tuple, or None if the response does not contain it. The leaf's cert ID is computed with OpenSSL's OCSP_cert_to_id() using the digest of each single response, and the validity with OCSP_check_validity(). The response's signature is not verified."
+    },
     {"get_status", (PyCFunction)nassl_OCSP_RESPONSE_status, METH_VARARGS,
      "OpenSSL's OCSP_response_status() ."
     },
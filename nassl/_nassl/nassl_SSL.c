@@ -20,6 +20,7 @@
 
 #include <openssl/ssl.h>
 #include <openssl/ocsp.h>
+#include <openssl/x509v3.h>
 
 
 #include "nassl_errors.h"
@@ -28,7 +29,11 @@
 #include "nassl_X509.h"
 #include "nassl_SSL_SESSION.h"
 #include "nassl_OCSP_RESPONSE.h"
+#include "ocsp_stapling.h"
 #include "openssl_utils.h"
+#include "nassl_cipher_table.h"
+#include "time_utils.h"
+#include "socket_utils.h"
 
 
 // nassl.SSL.new()
@@ -47,6 +52,11 @@ static PyObject* nassl_SSL_new(PyTypeObject *type, PyObject *args, PyObject *kwd
     self->ssl = NULL;
     self->sslCtx_Object = NULL;
     self->networkBio_Object = NULL;
+    memset(&self->serverResponse, 0, sizeof(TlsServerResponse));
+    self->handshakeTiming = NULL;
+    self->transcript = NULL;
+    self->areCountersEnabled = 0;
+    memset(&self->counters, 0, sizeof(ConnectionCounters));
 
     // Recover and store the corresponding ssl_ctx
     if (!PyArg_ParseTuple(args, "O!", &nassl_SSL_CTX_Type, &sslCtx_Object))
@@ -103,10 +113,54 @@ static void nassl_SSL_dealloc(nassl_SSL_Object *self)
     {
         Py_DECREF(self->sslCtx_Object);
     }
+
+    PyMem_Free(self->handshakeTiming);
+    if (self->transcript != NULL)
+    {
+        PyMem_Free(self->transcript->buffer);
+        PyMem_Free(self->transcript);
+    }
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
 
+// BIO callback counting the calls to BIO_read() and BIO_write() on the network BIO and the bytes that went through
+static long network_bio_counters_callback(BIO *bio, int operation, const char *argp, int argi, long argl, long ret)
+{
+    ConnectionCounters *counters = (ConnectionCounters *) BIO_get_callback_arg(bio);
+
+    if (operation == (BIO_CB_WRITE | BIO_CB_RETURN))
+    {
+        // Data received from the server is written to the network BIO
+        counters->networkBioWriteCalls++;
+        if (ret > 0)
+        {
+            counters->bytesReceived += ret;
+        }
+    }
+    else if (operation == (BIO_CB_READ | BIO_CB_RETURN))
+    {
+        counters->networkBioReadCalls++;
+        if (ret > 0)
+        {
+            counters->bytesSent += ret;
+        }
+    }
+    return ret;
+}
+
+
+static void set_network_bio_counters_callback(nassl_SSL_Object *self)
+{
+    if ((self->networkBio_Object == NULL) || (self->networkBio_Object->bio == NULL))
+    {
+        return;
+    }
+    BIO_set_callback_arg(self->networkBio_Object->bio, (char *) &self->counters);
+    BIO_set_callback(self->networkBio_Object->bio, network_bio_counters_callback);
+}
+
+
 static PyObject* nassl_SSL_set_bio(nassl_SSL_Object *self, PyObject *args)
 {
     nassl_BIO_Object* internalBioObject;
@@ -121,8 +175,8 @@ static PyObject* nassl_SSL_set_bio(nassl_SSL_Object *self, PyObject *args)
 
 static PyObject* nassl_SSL_set_network_bio_to_free_when_dealloc(nassl_SSL_Object *self, PyObject *args)
 {
-    // The network BIO is only needed here so we properly free it when the SSL object gets freed
-    // Other than that it's never used
+    // The network BIO is needed here so we properly free it when the SSL object gets freed, and so that exchange() can
+    // move the encrypted data between it and the socket
     nassl_BIO_Object* networkBioObject;
 
     if (!PyArg_ParseTuple(args, "O!", &nassl_BIO_Type, &networkBioObject))
@@ -131,6 +185,10 @@ static PyObject* nassl_SSL_set_network_bio_to_free_when_dealloc(nassl_SSL_Object
     }
     Py_INCREF(networkBioObject);
     self->networkBio_Object = networkBioObject;
+    if (self->areCountersEnabled)
+    {
+        set_network_bio_counters_callback(self);
+    }
     Py_RETURN_NONE;
 }
 
@@ -266,6 +324,472 @@ static PyObject* nassl_SSL_get_max_early_data(nassl_SSL_Object *self, PyObject *
 }
 #endif
 
+// Send all the encrypted data in the network BIO to the peer, straight from the BIO pair's ring buffer: its content
+// is at most two contiguous chunks which are sent together. Consuming them with BIO_nread() only makes room for the
+// next SSL_write() so they remain valid while being sent; counters is NULL if the counters are disabled and
+// sentSizeOut, if not NULL, gets incremented by the number of bytes sent
+// Does not use the Python API so it can be called without holding the GIL; returns 0 if the socket failed or timed out,
+// in which case socketErrorOut, if not NULL, is set as by socket_send_chunks_all()
+static int flush_network_bio(BIO *networkBio, nassl_socket_t sock, int timeoutMs, ConnectionCounters *counters,
+                             size_t *sentSizeOut, int *socketErrorOut)
+{
+    size_t pendingSize;
+    while ((pendingSize = BIO_ctrl_pending(networkBio)) > 0)
+    {
+        const char *chunks[2];
+        size_t chunkSizes[2];
+        int chunksCount = 0, i;
+
+        for (chunksCount = 0; (chunksCount < 2) && (pendingSize > 0); chunksCount++)
+        {
+            char *chunk = NULL;
+            int chunkSize = BIO_nread(networkBio, &chunk, pendingSize < INT_MAX ? (int) pendingSize : INT_MAX);
+            if (chunkSize <= 0)
+            {
+                break;
+            }
+            chunks[chunksCount] = chunk;
+            chunkSizes[chunksCount] = (size_t) chunkSize;
+            pendingSize -= chunkSize;
+        }
+        if (chunksCount == 0)
+        {
+            return 0;
+        }
+
+        if (counters != NULL)
+        {
+            // BIO_nread() is a BIO_ctrl() call which the counters callback does not see
+            counters->networkBioReadCalls += chunksCount;
+            for (i = 0; i < chunksCount; i++)
+            {
+                counters->bytesSent += chunkSizes[i];
+            }
+        }
+        if (!socket_send_chunks_all(sock, chunks, chunkSizes, chunksCount, timeoutMs,
+                                    (counters != NULL) ? &counters->socketSendCalls : NULL, socketErrorOut))
+        {
+            return 0;
+        }
+        for (i = 0; (i < chunksCount) && (sentSizeOut != NULL); i++)
+        {
+            *sentSizeOut += chunkSizes[i];
+        }
+    }
+    return 1;
+}
+
+
+static PyObject* nassl_SSL_flush_network_bio(nassl_SSL_Object *self, PyObject *args)
+{
+    Py_ssize_t sockFd = 0;
+    double timeout = -1.0;
+    size_t sentSize = 0;
+    int isFlushed = 0, socketError = -1;
+
+    if (!PyArg_ParseTuple(args, "nd", &sockFd, &timeout))
+    {
+        return NULL;
+    }
+    if (self->networkBio_Object == NULL)
+    {
+        PyErr_SetString(PyExc_ValueError, "No network BIO was set");
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    isFlushed = flush_network_bio(self->networkBio_Object->bio, (nassl_socket_t) sockFd,
+                                  (timeout < 0) ? -1 : (int) (timeout * 1000),
+                                  self->areCountersEnabled ? &self->counters : NULL, &sentSize, &socketError);
+    Py_END_ALLOW_THREADS
+
+    if (!isFlushed)
+    {
+        // Raise the same exceptions as socket.send() so that callers can handle them the same way
+        if (socketError < 0)
+        {
+            PyErr_SetString(PyExc_IOError, "Could not send data to the peer");
+            return NULL;
+        }
+        return raise_socket_error(socketError);
+    }
+    return Py_BuildValue("n", (Py_ssize_t) sentSize);
+}
+
+
+// Size of the buffer used to receive encrypted data from the socket, and of the plaintext read from the SSL object at
+// once
+#define EXCHANGE_BUFFER_SIZE 16384
+
+typedef enum {
+    EXCHANGE_OK = 0,
+    EXCHANGE_PEER_CLOSED,
+    EXCHANGE_RESPONSE_TOO_LARGE, // No delimiter within the maximum response size
+    EXCHANGE_SSL_ERROR, // sslReturnValue contains the return value of the failed call
+    EXCHANGE_SOCKET_ERROR,
+    EXCHANGE_NO_MEMORY
+} ExchangeStatus;
+
+// Pipelined requests and their responses; all the responses are stored next to each other in the same buffer
+typedef struct {
+    const char **requests;
+    size_t *requestSizes;
+    Py_ssize_t requestsCount;
+    const char *delimiter; // NULL when reading responses of a fixed length
+    size_t delimiterSize;
+    size_t responseLength;
+    size_t maxResponseSize;
+    int timeoutMs;
+
+    char *responsesData;
+    size_t responsesDataSize;
+    size_t responsesDataCapacity;
+    size_t *responseEnds; // Offset of the end of each response in responsesData
+    Py_ssize_t responsesCount;
+    int sslReturnValue;
+
+    ConnectionCounters *counters; // NULL if the counters are disabled
+} SslExchange;
+
+
+// Move encrypted data between the network BIO and the socket so that the SSL call that returned returnValue can be
+// retried; does not use the Python API so it can be called without holding the GIL
+static ExchangeStatus service_ssl_io(SSL *ssl, BIO *networkBio, nassl_socket_t sock, SslExchange *exchange,
+                                     int returnValue)
+{
+    char buffer[EXCHANGE_BUFFER_SIZE];
+    size_t writeGuarantee;
+    int recvSize;
+
+    switch (SSL_get_error(ssl, returnValue))
+    {
+        case SSL_ERROR_WANT_WRITE:
+            return flush_network_bio(networkBio, sock, exchange->timeoutMs, exchange->counters, NULL, NULL)
+                    ? EXCHANGE_OK : EXCHANGE_SOCKET_ERROR;
+
+        case SSL_ERROR_WANT_READ:
+            // OpenSSL may have something to send first (alerts, renegotiation, etc.)
+            if (!flush_network_bio(networkBio, sock, exchange->timeoutMs, exchange->counters, NULL, NULL))
+            {
+                return EXCHANGE_SOCKET_ERROR;
+            }
+            writeGuarantee = BIO_ctrl_get_write_guarantee(networkBio);
+            if (writeGuarantee == 0)
+            {
+                return EXCHANGE_SSL_ERROR;
+            }
+            if (exchange->counters != NULL)
+            {
+                exchange->counters->socketRecvCalls++;
+            }
+            recvSize = socket_recv(sock, buffer, writeGuarantee < sizeof(buffer) ? writeGuarantee : sizeof(buffer),
+                                   exchange->timeoutMs);
+            if (recvSize < 0)
+            {
+                return EXCHANGE_SOCKET_ERROR;
+            }
+            else if (recvSize == 0)
+            {
+                return EXCHANGE_PEER_CLOSED;
+            }
+            BIO_write(networkBio, buffer, recvSize);
+            return EXCHANGE_OK;
+
+        case SSL_ERROR_ZERO_RETURN:
+            return EXCHANGE_PEER_CLOSED;
+
+        default:
+            return EXCHANGE_SSL_ERROR;
+    }
+}
+
+
+static ExchangeStatus write_requests(SSL *ssl, BIO *networkBio, nassl_socket_t sock, SslExchange *exchange)
+{
+    Py_ssize_t i;
+    for (i = 0; i < exchange->requestsCount; i++)
+    {
+        size_t writtenSize = 0;
+        while (writtenSize < exchange->requestSizes[i])
+        {
+            size_t writeSize = exchange->requestSizes[i] - writtenSize;
+            ExchangeStatus status = EXCHANGE_OK;
+            int result = SSL_write(ssl, exchange->requests[i] + writtenSize, writeSize < INT_MAX ? (int) writeSize : INT_MAX);
+            if (result > 0)
+            {
+                writtenSize += result;
+                continue;
+            }
+
+            // The network BIO is only flushed when the records do not fit in it
+            status = service_ssl_io(ssl, networkBio, sock, exchange, result);
+            if (status != EXCHANGE_OK)
+            {
+                exchange->sslReturnValue = result;
+                return (status == EXCHANGE_PEER_CLOSED) ? EXCHANGE_SOCKET_ERROR : status;
+            }
+        }
+    }
+
+    // Send all the requests at once
+    return flush_network_bio(networkBio, sock, exchange->timeoutMs, exchange->counters, NULL, NULL)
+            ? EXCHANGE_OK : EXCHANGE_SOCKET_ERROR;
+}
+
+
+// Returns the offset of the end of the first occurrence of the delimiter in data, or 0 if there is none
+static size_t find_delimiter_end(const char *data, size_t dataSize, const char *delimiter, size_t delimiterSize)
+{
+    size_t offset = 0;
+    while (offset + delimiterSize <= dataSize)
+    {
+        const char *candidate = memchr(data + offset, delimiter[0], dataSize - offset - delimiterSize + 1);
+        if (candidate == NULL)
+        {
+            return 0;
+        }
+        if (memcmp(candidate, delimiter, delimiterSize) == 0)
+        {
+            return (candidate - data) + delimiterSize;
+        }
+        offset = (candidate - data) + 1;
+    }
+    return 0;
+}
+
+
+// Read the next response into the responses buffer; when looking for a delimiter, the plaintext is peeked first so
+// that nothing past the delimiter gets consumed and lost for the next response
+static ExchangeStatus read_response(SSL *ssl, BIO *networkBio, nassl_socket_t sock, SslExchange *exchange)
+{
+    size_t responseStart = exchange->responsesDataSize;
+    size_t expectedSize = (exchange->delimiter != NULL) ? exchange->maxResponseSize : exchange->responseLength;
+
+    while (exchange->responsesDataSize - responseStart < expectedSize)
+    {
+        size_t responseSize = exchange->responsesDataSize - responseStart;
+        size_t readSize = expectedSize - responseSize;
+        char *readBuffer = NULL;
+        int result;
+
+        if (readSize > EXCHANGE_BUFFER_SIZE)
+        {
+            readSize = EXCHANGE_BUFFER_SIZE;
+        }
+        if (exchange->responsesDataSize + readSize > exchange->responsesDataCapacity)
+        {
+            size_t newCapacity = 2 * exchange->responsesDataCapacity + readSize;
+            char *newData = (char *) realloc(exchange->responsesData, newCapacity);
+            if (newData == NULL)
+            {
+                return EXCHANGE_NO_MEMORY;
+            }
+            exchange->responsesData = newData;
+            exchange->responsesDataCapacity = newCapacity;
+        }
+        readBuffer = exchange->responsesData + exchange->responsesDataSize;
+
+        if (exchange->delimiter != NULL)
+        {
+            result = SSL_peek(ssl, readBuffer, (int) readSize);
+        }
+        else
+        {
+            result = SSL_read(ssl, readBuffer, (int) readSize);
+        }
+        if (result <= 0)
+        {
+            ExchangeStatus status = service_ssl_io(ssl, networkBio, sock, exchange, result);
+            if (status != EXCHANGE_OK)
+            {
+                exchange->sslReturnValue = result;
+                return status;
+            }
+            continue;
+        }
+
+        if (exchange->delimiter != NULL)
+        {
+            // The delimiter may straddle the data that was already read and the data that was just peeked
+            size_t searchStart = exchange->responsesDataSize - responseStart >= exchange->delimiterSize
+                    ? exchange->responsesDataSize - exchange->delimiterSize + 1
+                    : responseStart;
+            size_t delimiterEnd = find_delimiter_end(exchange->responsesData + searchStart,
+                                                     exchange->responsesDataSize + result - searchStart,
+                                                     exchange->delimiter, exchange->delimiterSize);
+            int consumeSize = (delimiterEnd > 0)
+                    ? (int) (searchStart + delimiterEnd - exchange->responsesDataSize)
+                    : result;
+
+            // The peeked plaintext is already decrypted so this cannot fail or return less
+            result = SSL_read(ssl, readBuffer, consumeSize);
+            if (result != consumeSize)
+            {
+                exchange->sslReturnValue = result;
+                return EXCHANGE_SSL_ERROR;
+            }
+            exchange->responsesDataSize += result;
+            if (delimiterEnd > 0)
+            {
+                return EXCHANGE_OK;
+            }
+        }
+        else
+        {
+            exchange->responsesDataSize += result;
+        }
+    }
+
+    return (exchange->delimiter != NULL) ? EXCHANGE_RESPONSE_TOO_LARGE : EXCHANGE_OK;
+}
+
+
+// Send all the requests in one flush and read one response for each of them; stops early without an error if the peer
+// closed the connection or a response is too large, in which case the last response may be incomplete
+// Does not use the Python API so it can be called without holding the GIL
+static ExchangeStatus run_exchange(SSL *ssl, BIO *networkBio, nassl_socket_t sock, SslExchange *exchange)
+{
+    ExchangeStatus status = write_requests(ssl, networkBio, sock, exchange);
+    if (status != EXCHANGE_OK)
+    {
+        return status;
+    }
+
+    while (exchange->responsesCount < exchange->requestsCount)
+    {
+        size_t responseStart = exchange->responsesDataSize;
+        status = read_response(ssl, networkBio, sock, exchange);
+        if ((status == EXCHANGE_OK)
+                || (((status == EXCHANGE_PEER_CLOSED) || (status == EXCHANGE_RESPONSE_TOO_LARGE))
+                    && (exchange->responsesDataSize > responseStart)))
+        {
+            exchange->responseEnds[exchange->responsesCount] = exchange->responsesDataSize;
+            exchange->responsesCount++;
+        }
+
+        if ((status == EXCHANGE_PEER_CLOSED) || (status == EXCHANGE_RESPONSE_TOO_LARGE))
+        {
+            return EXCHANGE_OK;
+        }
+        else if (status != EXCHANGE_OK)
+        {
+            return status;
+        }
+    }
+    return EXCHANGE_OK;
+}
+
+
+static PyObject* nassl_SSL_exchange(nassl_SSL_Object *self, PyObject *args)
+{
+    Py_ssize_t sockFd = 0, responseLength = 0, maxResponseSize = 0, i = 0;
+    PyObject *requestsPyList = NULL, *requestsPyTuple = NULL, *responsesPyList = NULL;
+    const char *delimiter = NULL;
+    int delimiterSize = 0;
+    double timeout = -1.0;
+    SslExchange exchange;
+    ExchangeStatus status = EXCHANGE_OK;
+
+    if (!PyArg_ParseTuple(args, "nOz#nnd", &sockFd, &requestsPyList, &delimiter, &delimiterSize, &responseLength,
+                          &maxResponseSize, &timeout))
+    {
+        return NULL;
+    }
+    if (self->networkBio_Object == NULL)
+    {
+        PyErr_SetString(PyExc_ValueError, "No network BIO was set");
+        return NULL;
+    }
+    if (((delimiter != NULL) && ((delimiterSize < 1) || (maxResponseSize < 1)))
+            || ((delimiter == NULL) && (responseLength < 1)))
+    {
+        PyErr_SetString(PyExc_ValueError, "Invalid delimiter or response length");
+        return NULL;
+    }
+
+    // Work on a copy of the list so it cannot be modified while we do not hold the GIL
+    requestsPyTuple = PySequence_Tuple(requestsPyList);
+    if (requestsPyTuple == NULL)
+    {
+        return NULL;
+    }
+
+    memset(&exchange, 0, sizeof(SslExchange));
+    exchange.requestsCount = PyTuple_GET_SIZE(requestsPyTuple);
+    exchange.delimiter = delimiter;
+    exchange.delimiterSize = (size_t) delimiterSize;
+    exchange.responseLength = (size_t) responseLength;
+    exchange.maxResponseSize = (size_t) maxResponseSize;
+    exchange.timeoutMs = (timeout < 0) ? -1 : (int) (timeout * 1000);
+    exchange.counters = self->areCountersEnabled ? &self->counters : NULL;
+    exchange.requests = (const char **) PyMem_Malloc(sizeof(char *) * (exchange.requestsCount + 1));
+    exchange.requestSizes = (size_t *) PyMem_Malloc(sizeof(size_t) * (exchange.requestsCount + 1));
+    exchange.responseEnds = (size_t *) PyMem_Malloc(sizeof(size_t) * (exchange.requestsCount + 1));
+    if ((exchange.requests == NULL) || (exchange.requestSizes == NULL) || (exchange.responseEnds == NULL))
+    {
+        PyErr_NoMemory();
+        goto cleanup;
+    }
+    for (i = 0; i < exchange.requestsCount; i++)
+    {
+        PyObject *requestPyObj = PyTuple_GET_ITEM(requestsPyTuple, i);
+        if (!PyBytes_Check(requestPyObj))
+        {
+            PyErr_SetString(PyExc_TypeError, "The requests must be bytes");
+            goto cleanup;
+        }
+        exchange.requests[i] = PyBytes_AS_STRING(requestPyObj);
+        exchange.requestSizes[i] = PyBytes_GET_SIZE(requestPyObj);
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    status = run_exchange(self->ssl, self->networkBio_Object->bio, (nassl_socket_t) sockFd, &exchange);
+    Py_END_ALLOW_THREADS
+
+    if (status == EXCHANGE_SSL_ERROR)
+    {
+        raise_OpenSSL_ssl_error(self->ssl, exchange.sslReturnValue);
+        goto cleanup;
+    }
+    else if (status == EXCHANGE_SOCKET_ERROR)
+    {
+        PyErr_SetString(PyExc_IOError, "Could not exchange data with the peer: connection closed or timed out");
+        goto cleanup;
+    }
+    else if (status == EXCHANGE_NO_MEMORY)
+    {
+        PyErr_NoMemory();
+        goto cleanup;
+    }
+
+    responsesPyList = PyList_New(exchange.responsesCount);
+    if (responsesPyList == NULL)
+    {
+        goto cleanup;
+    }
+    for (i = 0; i < exchange.responsesCount; i++)
+    {
+        size_t responseStart = (i == 0) ? 0 : exchange.responseEnds[i - 1];
+        PyObject *responsePyObj = PyBytes_FromStringAndSize(exchange.responsesData + responseStart,
+                                                            exchange.responseEnds[i] - responseStart);
+        if (responsePyObj == NULL)
+        {
+            Py_CLEAR(responsesPyList);
+            break;
+        }
+        PyList_SET_ITEM(responsesPyList, i, responsePyObj);
+    }
+
+cleanup:
+    PyMem_Free(exchange.requests);
+    PyMem_Free(exchange.requestSizes);
+    PyMem_Free(exchange.responseEnds);
+    free(exchange.responsesData);
+    Py_DECREF(requestsPyTuple);
+    return responsesPyList;
+}
+
+
 static PyObject* nassl_SSL_shutdown(nassl_SSL_Object *self, PyObject *args)
 {
     int returnValue = SSL_shutdown(self->ssl);
@@ -401,6 +925,64 @@ static PyObject* nassl_SSL_set_tlsext_host_name(nassl_SSL_Object *self, PyObject
 }
 
 
+// Identity checks performed by OpenSSL when verifying the peer's certificate; SSL_set1_host() does not exist in OpenSSL
+// 1.0.2 so the SSL object's X509_VERIFY_PARAM is configured directly in both builds
+static PyObject* nassl_SSL_set1_host(nassl_SSL_Object *self, PyObject *args)
+{
+    char *hostname = NULL;
+    int hostnameLen = 0;
+    unsigned int flags = 0;
+    X509_VERIFY_PARAM *verifyParam = SSL_get0_param(self->ssl);
+    if (!PyArg_ParseTuple(args, "s#|I", &hostname, &hostnameLen, &flags))
+    {
+        return NULL;
+    }
+
+    X509_VERIFY_PARAM_set_hostflags(verifyParam, flags);
+    if (!X509_VERIFY_PARAM_set1_host(verifyParam, hostname, hostnameLen))
+    {
+        PyErr_SetString(PyExc_ValueError, "Invalid hostname");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* nassl_SSL_set1_ip_asc(nassl_SSL_Object *self, PyObject *args)
+{
+    char *ipAddress = NULL;
+    if (!PyArg_ParseTuple(args, "s", &ipAddress))
+    {
+        return NULL;
+    }
+
+    if (!X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(self->ssl), ipAddress))
+    {
+        PyErr_SetString(PyExc_ValueError, "Invalid IP address");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* nassl_SSL_set1_email(nassl_SSL_Object *self, PyObject *args)
+{
+    char *email = NULL;
+    int emailLen = 0;
+    if (!PyArg_ParseTuple(args, "s#", &email, &emailLen))
+    {
+        return NULL;
+    }
+
+    if (!X509_VERIFY_PARAM_set1_email(SSL_get0_param(self->ssl), email, emailLen))
+    {
+        PyErr_SetString(PyExc_ValueError, "Invalid email address");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+
 static PyObject* nassl_SSL_get_peer_certificate(nassl_SSL_Object *self, PyObject *args)
 {
     X509 *cert;
@@ -413,15 +995,7 @@ static PyObject* nassl_SSL_get_peer_certificate(nassl_SSL_Object *self, PyObject
     else
     {
         // Return an _nassl.X509 object
-        nassl_X509_Object *x509_Object;
-        x509_Object = (nassl_X509_Object *)nassl_X509_Type.tp_alloc(&nassl_X509_Type, 0);
-        if (x509_Object == NULL)
-        {
-            return PyErr_NoMemory();
-        }
-
-        x509_Object->x509 = cert;
-        return (PyObject *) x509_Object;
+        return nassl_X509_from_X509(cert);
     }
 }
 
@@ -509,29 +1083,21 @@ static PyObject* nassl_SSL_get_cipher_list(nassl_SSL_Object *self, PyObject *arg
 static PyObject* nassl_SSL_get_cipher_description(nassl_SSL_Object *self, PyObject *args)
 {
     char *wantedCipherName;
+    PyObject *cipherInfo = NULL, *descriptionPyString = NULL;
     if (!PyArg_ParseTuple(args, "s", &wantedCipherName))
     {
         return NULL;
     }
 
-    const SSL_CIPHER *found_cipher = NULL;
-
-    // Based on: https://github.com/openssl/openssl/blob/master/apps/ciphers.c
-    STACK_OF(SSL_CIPHER) *sk = SSL_get_ciphers(self->ssl);
-    for (int i = 0; found_cipher == NULL && i < sk_SSL_CIPHER_num(sk); i++) {
-        const SSL_CIPHER *c = sk_SSL_CIPHER_value(sk, i);
-        const char *thisCipherName = SSL_CIPHER_get_name(c);
-        if (thisCipherName && strcmp(thisCipherName, wantedCipherName) == 0) {
-            found_cipher = c;
-        }
-    }
-
-    if (found_cipher == NULL) {
+    // Descriptions are precomputed in the cipher table when the module gets imported
+    cipherInfo = get_cipher_info_by_name(wantedCipherName);
+    if (cipherInfo == NULL)
+    {
         Py_RETURN_NONE;
-    } else {
-        char cipherDesc[128];
-        return PyUnicode_FromString(SSL_CIPHER_description(found_cipher, cipherDesc, 128));
     }
+    descriptionPyString = PyStructSequence_GET_ITEM(cipherInfo, CIPHER_INFO_DESCRIPTION_INDEX);
+    Py_INCREF(descriptionPyString);
+    return descriptionPyString;
 }
 
 
@@ -758,6 +1324,45 @@ static PyObject* nassl_SSL_get_peer_signature_type(nassl_SSL_Object *self, PyObj
 #endif
 
 
+static PyObject* nassl_SSL_get_ocsp_stapling_verdict(nassl_SSL_Object *self, PyObject *args)
+{
+    OcspStaplingVerdict verdict;
+    PyObject *responseStatusPyObj = Py_None, *certificateStatusPyObj = Py_None;
+
+    if (!ocsp_stapling_get_verdict(self->ssl, &verdict))
+    {
+        PyErr_SetString(PyExc_ValueError, "The peer did not send a certificate");
+        return NULL;
+    }
+
+    if (verdict.responseStatus >= 0)
+    {
+        responseStatusPyObj = PyLong_FromLong(verdict.responseStatus);
+    }
+    else
+    {
+        Py_INCREF(Py_None);
+    }
+    if (verdict.certificateStatus >= 0)
+    {
+        certificateStatusPyObj = PyLong_FromLong(verdict.certificateStatus);
+    }
+    else
+    {
+        Py_INCREF(Py_None);
+    }
+    if ((responseStatusPyObj == NULL) || (certificateStatusPyObj == NULL))
+    {
+        Py_XDECREF(responseStatusPyObj);
+        Py_XDECREF(certificateStatusPyObj);
+        return NULL;
+    }
+    return Py_BuildValue("(NNNNNN)", PyBool_FromLong(verdict.isMustStaple), PyBool_FromLong(verdict.isResponseStapled),
+                         responseStatusPyObj, certificateStatusPyObj, PyBool_FromLong(verdict.isResponseCurrent),
+                         PyBool_FromLong(verdict.isSignatureValid));
+}
+
+
 static PyObject* nassl_SSL_get_tlsext_status_ocsp_resp(nassl_SSL_Object *self, PyObject *args)
 {
     OCSP_RESPONSE *ocspResp = NULL;
@@ -952,9 +1557,8 @@ static PyObject* nassl_SSL_get_peer_cert_chain(nassl_SSL_Object *self, PyObject
 
     for (i=0; i<certChainCount; i++)
     {
-        nassl_X509_Object *x509_Object = NULL;
-        // Copy the certificate as the cert chain is freed automatically
-        X509 *cert = X509_dup(sk_X509_value(certChain, i));
+        PyObject *x509_PyObject = NULL;
+        X509 *cert = sk_X509_value(certChain, i);
         if (cert == NULL)
         {
             Py_DECREF(certChainPyList);
@@ -962,17 +1566,17 @@ static PyObject* nassl_SSL_get_peer_cert_chain(nassl_SSL_Object *self, PyObject
             return NULL;
         }
 
-        // Store the cert in an _nassl.X509 object
-        x509_Object = (nassl_X509_Object *)nassl_X509_Type.tp_alloc(&nassl_X509_Type, 0);
-        if (x509_Object == NULL)
+        // Take a reference as the cert chain is freed automatically, and store the cert in an _nassl.X509 object
+        X509_up_ref(cert);
+        x509_PyObject = nassl_X509_from_X509(cert);
+        if (x509_PyObject == NULL)
         {
             Py_DECREF(certChainPyList);
-            return PyErr_NoMemory();
+            return NULL;
         }
-        x509_Object->x509 = cert;
 
         // Add the X509 object to the final list
-        PyList_SET_ITEM(certChainPyList, i,  (PyObject *)x509_Object);
+        PyList_SET_ITEM(certChainPyList, i, x509_PyObject);
     }
 
     return certChainPyList;
@@ -990,6 +1594,500 @@ static PyObject* nassl_SSL_version(nassl_SSL_Object *self, PyObject *args)
 }
 
 
+static void record_handshake_timing(HandshakeTiming *timing, int writeP, int contentType, const unsigned char *buf,
+                                    size_t len)
+{
+    double now = 0;
+
+    if (contentType == SSL3_RT_HEADER)
+    {
+        // Record headers are the cheapest way to count the bytes exchanged
+        if (len >= 5)
+        {
+            unsigned long recordSize = 5 + ((buf[3] << 8) | buf[4]);
+            if (writeP)
+            {
+                timing->bytesSent += recordSize;
+            }
+            else
+            {
+                timing->bytesReceived += recordSize;
+            }
+        }
+        return;
+    }
+    if ((contentType != SSL3_RT_HANDSHAKE) && (contentType != SSL3_RT_CHANGE_CIPHER_SPEC)
+            && (contentType != SSL3_RT_ALERT) && (contentType != 0))
+    {
+        // Inner content type of TLS 1.3 records, etc.
+        return;
+    }
+
+    now = get_monotonic_time();
+    if (timing->startTime == 0)
+    {
+        timing->startTime = now;
+    }
+    if (!writeP && (timing->wasLastMessageSent || (timing->messagesCount == 0)))
+    {
+        // First message of a new flight from the server
+        timing->roundTrips++;
+    }
+    timing->wasLastMessageSent = writeP;
+
+    if (timing->messagesCount < HANDSHAKE_TIMING_MAX_MESSAGES)
+    {
+        HandshakeMessageTiming *message = &timing->messages[timing->messagesCount];
+        message->timestamp = now - timing->startTime;
+        message->isSent = (unsigned char) writeP;
+        message->contentType = (unsigned char) contentType;
+        message->handshakeType = ((contentType == SSL3_RT_HANDSHAKE) && (len > 0)) ? buf[0] : 0;
+        message->size = (unsigned int) len;
+    }
+    timing->messagesCount++;
+}
+
+
+#define TRANSCRIPT_ENTRY_HEADER_SIZE 6
+
+
+static void transcript_write(TranscriptBuffer *transcript, size_t offset, const unsigned char *data, size_t size)
+{
+    size_t firstPartSize = 0;
+    offset %= transcript->capacity;
+    firstPartSize = transcript->capacity - offset < size ? transcript->capacity - offset : size;
+    memcpy(transcript->buffer + offset, data, firstPartSize);
+    memcpy(transcript->buffer, data + firstPartSize, size - firstPartSize);
+}
+
+
+static void transcript_read(TranscriptBuffer *transcript, size_t offset, unsigned char *data, size_t size)
+{
+    size_t firstPartSize = 0;
+    offset %= transcript->capacity;
+    firstPartSize = transcript->capacity - offset < size ? transcript->capacity - offset : size;
+    memcpy(data, transcript->buffer + offset, firstPartSize);
+    memcpy(data + firstPartSize, transcript->buffer, size - firstPartSize);
+}
+
+
+static size_t transcript_get_entry_size(TranscriptBuffer *transcript, size_t offset)
+{
+    unsigned char header[TRANSCRIPT_ENTRY_HEADER_SIZE];
+    transcript_read(transcript, offset, header, TRANSCRIPT_ENTRY_HEADER_SIZE);
+    return TRANSCRIPT_ENTRY_HEADER_SIZE
+            + (((size_t) header[2] << 24) | (header[3] << 16) | (header[4] << 8) | header[5]);
+}
+
+
+static void record_transcript_message(TranscriptBuffer *transcript, int writeP, int contentType,
+                                      const unsigned char *buf, size_t len)
+{
+    unsigned char header[TRANSCRIPT_ENTRY_HEADER_SIZE];
+    size_t entrySize = TRANSCRIPT_ENTRY_HEADER_SIZE + len;
+
+    if (entrySize > transcript->capacity)
+    {
+        transcript->droppedCount++;
+        return;
+    }
+
+    // Evict the oldest entries until the new one fits
+    while (transcript->capacity - transcript->used < entrySize)
+    {
+        size_t oldestEntrySize = transcript_get_entry_size(transcript, transcript->start);
+        transcript->start = (transcript->start + oldestEntrySize) % transcript->capacity;
+        transcript->used -= oldestEntrySize;
+        transcript->droppedCount++;
+    }
+
+    header[0] = (unsigned char) writeP;
+    header[1] = (unsigned char) contentType;
+    header[2] = (unsigned char) (len >> 24);
+    header[3] = (unsigned char) (len >> 16);
+    header[4] = (unsigned char) (len >> 8);
+    header[5] = (unsigned char) len;
+    transcript_write(transcript, transcript->start + transcript->used, header, TRANSCRIPT_ENTRY_HEADER_SIZE);
+    transcript_write(transcript, transcript->start + transcript->used + TRANSCRIPT_ENTRY_HEADER_SIZE, buf, len);
+    transcript->used += entrySize;
+}
+
+
+static void nassl_SSL_info_callback(const SSL *ssl, int where, int ret)
+{
+    nassl_SSL_Object *self = (nassl_SSL_Object *) SSL_get_app_data(ssl);
+    if ((self == NULL) || (self->handshakeTiming == NULL))
+    {
+        return;
+    }
+
+    // Only the first handshake is timed; later starts are renegotiations or TLS 1.3 post-handshake messages
+    if ((where & SSL_CB_HANDSHAKE_START) && (self->handshakeTiming->startTime == 0))
+    {
+        self->handshakeTiming->startTime = get_monotonic_time();
+    }
+    else if ((where & SSL_CB_HANDSHAKE_DONE) && (self->handshakeTiming->endTime == 0))
+    {
+        self->handshakeTiming->endTime = get_monotonic_time();
+    }
+}
+
+
+static void count_message(ConnectionCounters *counters, int writeP, int contentType)
+{
+    switch (contentType)
+    {
+        case SSL3_RT_HEADER:
+            // Pseudo content type for the header of each record
+            writeP ? counters->recordsSent++ : counters->recordsReceived++;
+            break;
+        case SSL3_RT_HANDSHAKE:
+            writeP ? counters->handshakeMessagesSent++ : counters->handshakeMessagesReceived++;
+            break;
+        case SSL3_RT_ALERT:
+            writeP ? counters->alertsSent++ : counters->alertsReceived++;
+            break;
+        default:
+            break;
+    }
+}
+
+
+// Message callback shared by all the features that need to inspect the handshake messages; it is only set on the SSL
+// object when at least one of them is enabled
+static void nassl_SSL_msg_callback(int writeP, int version, int contentType, const void *buf, size_t len, SSL *ssl,
+                                   void *arg)
+{
+    nassl_SSL_Object *self = (nassl_SSL_Object *) arg;
+
+    if (self->areCountersEnabled)
+    {
+        count_message(&self->counters, writeP, contentType);
+    }
+
+    if (self->handshakeTiming != NULL)
+    {
+        record_handshake_timing(self->handshakeTiming, writeP, contentType, (const unsigned char *) buf, len);
+    }
+
+    if ((self->transcript != NULL) && (contentType <= 0xFF))
+    {
+        // Content types above 0xFF are OpenSSL pseudo-types (record headers, etc.)
+        record_transcript_message(self->transcript, writeP, contentType, (const unsigned char *) buf, len);
+    }
+}
+
+
+static void update_msg_callback(nassl_SSL_Object *self)
+{
+    if ((self->handshakeTiming != NULL) || (self->transcript != NULL) || self->areCountersEnabled)
+    {
+        SSL_set_msg_callback(self->ssl, nassl_SSL_msg_callback);
+        SSL_set_msg_callback_arg(self->ssl, self);
+    }
+    else
+    {
+        SSL_set_msg_callback(self->ssl, NULL);
+        SSL_set_msg_callback_arg(self->ssl, NULL);
+    }
+}
+
+
+// The server's response is parsed without going through OpenSSL, so that none of the messages that follow the
+// ServerHello (Certificate, ServerKeyExchange, etc.) get processed
+static PyObject* nassl_SSL_parse_server_records(nassl_SSL_Object *self, PyObject *args)
+{
+    char *data = NULL;
+    int dataSize = 0, result = 0;
+    TlsServerResponse serverResponse;
+
+    if (!PyArg_ParseTuple(args, "s#", &data, &dataSize))
+    {
+        return NULL;
+    }
+
+    result = tls_parse_server_records((unsigned char *) data, dataSize, &serverResponse);
+    if (result < 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "Received data is not a ServerHello or an alert");
+        return NULL;
+    }
+    else if (result == 0)
+    {
+        // Need more data
+        Py_RETURN_FALSE;
+    }
+
+    self->serverResponse = serverResponse;
+    if (serverResponse.messageType == TLS_MESSAGE_ALERT)
+    {
+        PyErr_Format(nassl_OpenSSLError_Exception, "Nassl SSL handshake failed: the server sent a %s alert",
+                     SSL_alert_desc_string_long(serverResponse.alertDescription));
+        return NULL;
+    }
+    Py_RETURN_TRUE;
+}
+
+
+static PyObject* nassl_SSL_enable_handshake_timing(nassl_SSL_Object *self, PyObject *args)
+{
+    if (self->handshakeTiming == NULL)
+    {
+        self->handshakeTiming = (HandshakeTiming *) PyMem_Malloc(sizeof(HandshakeTiming));
+        if (self->handshakeTiming == NULL)
+        {
+            return PyErr_NoMemory();
+        }
+    }
+    memset(self->handshakeTiming, 0, sizeof(HandshakeTiming));
+
+    SSL_set_app_data(self->ssl, self);
+    SSL_set_info_callback(self->ssl, nassl_SSL_info_callback);
+    update_msg_callback(self);
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* nassl_SSL_get_handshake_timing(nassl_SSL_Object *self, PyObject *args)
+{
+    HandshakeTiming *timing = self->handshakeTiming;
+    PyObject *messagesPyList = NULL;
+    unsigned int i = 0, recordedCount = 0;
+    double duration = 0;
+
+    if (timing == NULL)
+    {
+        Py_RETURN_NONE;
+    }
+
+    recordedCount = timing->messagesCount < HANDSHAKE_TIMING_MAX_MESSAGES ?
+            timing->messagesCount : HANDSHAKE_TIMING_MAX_MESSAGES;
+    messagesPyList = PyList_New(recordedCount);
+    if (messagesPyList == NULL)
+    {
+        return NULL;
+    }
+    for (i = 0; i < recordedCount; i++)
+    {
+        HandshakeMessageTiming *message = &timing->messages[i];
+        PyObject *messagePyTuple = Py_BuildValue("(dOBBI)", message->timestamp, message->isSent ? Py_True : Py_False,
+                                                 message->contentType, message->handshakeType, message->size);
+        if (messagePyTuple == NULL)
+        {
+            Py_DECREF(messagesPyList);
+            return NULL;
+        }
+        PyList_SET_ITEM(messagesPyList, i, messagePyTuple);
+    }
+
+    if ((timing->startTime != 0) && (timing->endTime != 0))
+    {
+        duration = timing->endTime - timing->startTime;
+    }
+    return Py_BuildValue("(dkkIIN)", duration, timing->bytesSent, timing->bytesReceived, timing->roundTrips,
+                         timing->messagesCount, messagesPyList);
+}
+
+
+static PyObject* nassl_SSL_enable_transcript(nassl_SSL_Object *self, PyObject *args)
+{
+    unsigned int capacity = 65536;
+    TranscriptBuffer *transcript = NULL;
+
+    if (!PyArg_ParseTuple(args, "|I", &capacity))
+    {
+        return NULL;
+    }
+    if (capacity < TRANSCRIPT_ENTRY_HEADER_SIZE)
+    {
+        PyErr_SetString(PyExc_ValueError, "Capacity is too small");
+        return NULL;
+    }
+
+    transcript = (TranscriptBuffer *) PyMem_Malloc(sizeof(TranscriptBuffer));
+    if (transcript == NULL)
+    {
+        return PyErr_NoMemory();
+    }
+    memset(transcript, 0, sizeof(TranscriptBuffer));
+    transcript->capacity = capacity;
+    transcript->buffer = (unsigned char *) PyMem_Malloc(capacity);
+    if (transcript->buffer == NULL)
+    {
+        PyMem_Free(transcript);
+        return PyErr_NoMemory();
+    }
+
+    // Replace any previous transcript
+    if (self->transcript != NULL)
+    {
+        PyMem_Free(self->transcript->buffer);
+        PyMem_Free(self->transcript);
+    }
+    self->transcript = transcript;
+    update_msg_callback(self);
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* nassl_SSL_get_transcript(nassl_SSL_Object *self, PyObject *args)
+{
+    TranscriptBuffer *transcript = self->transcript;
+    PyObject *transcriptPyList = NULL;
+    size_t offset = 0;
+
+    if (transcript == NULL)
+    {
+        Py_RETURN_NONE;
+    }
+
+    transcriptPyList = PyList_New(0);
+    if (transcriptPyList == NULL)
+    {
+        return NULL;
+    }
+
+    while (offset < transcript->used)
+    {
+        unsigned char header[TRANSCRIPT_ENTRY_HEADER_SIZE];
+        size_t entrySize = transcript_get_entry_size(transcript, transcript->start + offset);
+        PyObject *messagePyBytes = NULL, *entryPyTuple = NULL;
+
+        transcript_read(transcript, transcript->start + offset, header, TRANSCRIPT_ENTRY_HEADER_SIZE);
+        messagePyBytes = PyBytes_FromStringAndSize(NULL, entrySize - TRANSCRIPT_ENTRY_HEADER_SIZE);
+        if (messagePyBytes == NULL)
+        {
+            Py_DECREF(transcriptPyList);
+            return NULL;
+        }
+        transcript_read(transcript, transcript->start + offset + TRANSCRIPT_ENTRY_HEADER_SIZE,
+                        (unsigned char *) PyBytes_AS_STRING(messagePyBytes), entrySize - TRANSCRIPT_ENTRY_HEADER_SIZE);
+
+        entryPyTuple = Py_BuildValue("(OBN)", header[0] ? Py_True : Py_False, header[1], messagePyBytes);
+        if ((entryPyTuple == NULL) || (PyList_Append(transcriptPyList, entryPyTuple) == -1))
+        {
+            Py_XDECREF(entryPyTuple);
+            Py_DECREF(transcriptPyList);
+            return NULL;
+        }
+        Py_DECREF(entryPyTuple);
+        offset += entrySize;
+    }
+    return transcriptPyList;
+}
+
+
+static PyObject* nassl_SSL_get_transcript_dropped_count(nassl_SSL_Object *self, PyObject *args)
+{
+    if (self->transcript == NULL)
+    {
+        return PyLong_FromLong(0);
+    }
+    return PyLong_FromUnsignedLong(self->transcript->droppedCount);
+}
+
+
+static PyObject* nassl_SSL_enable_counters(nassl_SSL_Object *self, PyObject *args)
+{
+    memset(&self->counters, 0, sizeof(ConnectionCounters));
+    self->areCountersEnabled = 1;
+    set_network_bio_counters_callback(self);
+    update_msg_callback(self);
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* nassl_SSL_get_counters(nassl_SSL_Object *self, PyObject *args)
+{
+    ConnectionCounters *counters = &self->counters;
+    if (!self->areCountersEnabled)
+    {
+        Py_RETURN_NONE;
+    }
+    return Py_BuildValue("(KKkkkkkkkkkk)", counters->bytesReceived, counters->bytesSent, counters->recordsReceived,
+                         counters->recordsSent, counters->handshakeMessagesReceived, counters->handshakeMessagesSent,
+                         counters->alertsReceived, counters->alertsSent, counters->networkBioWriteCalls,
+                         counters->networkBioReadCalls, counters->socketRecvCalls, counters->socketSendCalls);
+}
+
+
+static PyObject* nassl_SSL_get_server_hello(nassl_SSL_Object *self, PyObject *args)
+{
+    TlsServerResponse *serverResponse = &self->serverResponse;
+    PyObject *cipherNamePyObj = NULL, *extensionsPyList = NULL, *selectedGroupPyObj = NULL, *serverHelloPyTuple = NULL;
+    STACK_OF(SSL_CIPHER) *ciphers = NULL;
+    unsigned int i = 0;
+
+    if ((serverResponse->messageType != TLS_MESSAGE_SERVER_HELLO)
+            && (serverResponse->messageType != TLS_MESSAGE_HELLO_RETRY_REQUEST))
+    {
+        Py_RETURN_NONE;
+    }
+
+    // The server picked one of the ciphers we offered
+    ciphers = SSL_get_ciphers(self->ssl);
+    for (i = 0; i < (unsigned int) sk_SSL_CIPHER_num(ciphers); i++)
+    {
+        const SSL_CIPHER *cipher = sk_SSL_CIPHER_value(ciphers, i);
+        if ((SSL_CIPHER_get_id(cipher) & 0x00FFFFFF) == serverResponse->cipherId)
+        {
+            cipherNamePyObj = PyUnicode_FromString(SSL_CIPHER_get_name(cipher));
+            if (cipherNamePyObj == NULL)
+            {
+                return NULL;
+            }
+            break;
+        }
+    }
+    if (cipherNamePyObj == NULL)
+    {
+        Py_INCREF(Py_None);
+        cipherNamePyObj = Py_None;
+    }
+
+    extensionsPyList = PyList_New(serverResponse->extensionsCount);
+    if (extensionsPyList == NULL)
+    {
+        Py_DECREF(cipherNamePyObj);
+        return NULL;
+    }
+    for (i = 0; i < serverResponse->extensionsCount; i++)
+    {
+        PyObject *extensionPyInt = PyLong_FromLong(serverResponse->extensions[i]);
+        if (extensionPyInt == NULL)
+        {
+            Py_DECREF(cipherNamePyObj);
+            Py_DECREF(extensionsPyList);
+            return NULL;
+        }
+        PyList_SET_ITEM(extensionsPyList, i, extensionPyInt);
+    }
+
+    if (serverResponse->selectedGroup)
+    {
+        selectedGroupPyObj = PyLong_FromLong(serverResponse->selectedGroup);
+        if (selectedGroupPyObj == NULL)
+        {
+            Py_DECREF(cipherNamePyObj);
+            Py_DECREF(extensionsPyList);
+            return NULL;
+        }
+    }
+    else
+    {
+        Py_INCREF(Py_None);
+        selectedGroupPyObj = Py_None;
+    }
+
+    serverHelloPyTuple = Py_BuildValue("(IINBNNO)", serverResponse->version, serverResponse->cipherId,
+                                       cipherNamePyObj, serverResponse->compressionMethod, extensionsPyList,
+                                       selectedGroupPyObj,
+                                       serverResponse->messageType == TLS_MESSAGE_HELLO_RETRY_REQUEST ?
+                                       Py_True : Py_False);
+    return serverHelloPyTuple;
+}
+
+
 static PyMethodDef nassl_SSL_Object_methods[] =
 {
     {"set_bio", (PyCFunction)nassl_SSL_set_bio, METH_VARARGS,
@@ -1024,6 +2122,14 @@ static PyMethodDef nassl_SSL_Object_methods[] =
      "OpenSSL's SSL_get_max_early_data()."
     },
 #endif
+    {"flush_network_bio", (PyCFunction)nassl_SSL_flush_network_bio, METH_VARARGS,
+     "Send all the encrypted data in the network BIO on the socket without holding the GIL, in as few system calls as "
+     "possible, and return the number of bytes sent."
+    },
+    {"exchange", (PyCFunction)nassl_SSL_exchange, METH_VARARGS,
+     "Send the requests in a single flush on the socket and read one response per request until the delimiter or of "
+     "the given length, without holding the GIL; the network BIO must have been set."
+    },
     {"pending", (PyCFunction)nassl_SSL_pending, METH_NOARGS,
      "OpenSSL's SSL_pending()."
     },
@@ -1045,6 +2151,15 @@ static PyMethodDef nassl_SSL_Object_methods[] =
     {"set_tlsext_host_name", (PyCFunction)nassl_SSL_set_tlsext_host_name, METH_VARARGS,
      "OpenSSL's SSL_set_tlsext_host_name()."
     },
+    {"set1_host", (PyCFunction)nassl_SSL_set1_host, METH_VARARGS,
+     "OpenSSL's SSL_set1_host() and SSL_set_hostflags(), implemented with X509_VERIFY_PARAM_set1_host() and X509_VERIFY_PARAM_set_hostflags()."
+    },
+    {"set1_ip_asc", (PyCFunction)nassl_SSL_set1_ip_asc, METH_VARARGS,
+     "OpenSSL's X509_VERIFY_PARAM_set1_ip_asc() on the SSL object's verification parameters."
+    },
+    {"set1_email", (PyCFunction)nassl_SSL_set1_email, METH_VARARGS,
+     "OpenSSL's X509_VERIFY_PARAM_set1_email() on the SSL object's verification parameters."
+    },
 #ifndef LEGACY_OPENSSL
     {"get_peer_signature_digest", (PyCFunction)nassl_SSL_get_peer_signature_digest, METH_NOARGS,
     "Wraps OpenSSL's SSL_get_peer_signature_nid() returning the short name of the digest algorithm used by the peer to sign TLS messages."
@@ -1101,6 +2216,9 @@ static PyMethodDef nassl_SSL_Object_methods[] =
     {"set_tlsext_status_type", (PyCFunction)nassl_SSL_set_tlsext_status_type, METH_VARARGS,
      "OpenSSL's SSL_set_tlsext_status_type()."
     },
+    {"get_ocsp_stapling_verdict", (PyCFunction)nassl_SSL_get_ocsp_stapling_verdict, METH_NOARGS,
+     "Returns the outcome of OCSP stapling once the handshake is completed, as an (is must-staple, is response stapled, OCSP_RESPONSE_STATUS_XXX, V_OCSP_CERTSTATUS_XXX, is response current, is signature valid) tuple. The leaf is must-staple if it has a TLS feature extension requiring status_request. The statuses are None if no response was stapled or the response has no status matching the leaf's cert ID, which is computed with the issuer from the peer's chain. The response's signature is verified with OCSP_basic_verify() against the peer's chain and the trust store of the SSL_CTX."
+    },
     {"get_tlsext_status_ocsp_resp", (PyCFunction)nassl_SSL_get_tlsext_status_ocsp_resp, METH_NOARGS,
      "OpenSSL's SSL_get_tlsext_status_ocsp_resp(). Returns an _nassl.OCSP_RESPONSE object."
     },
@@ -1124,6 +2242,33 @@ static PyMethodDef nassl_SSL_Object_methods[] =
     {"get_ssl_version", (PyCFunction)nassl_SSL_version, METH_NOARGS,
      "OpenSSL's SSL_version()."
     },
+    {"parse_server_records", (PyCFunction)nassl_SSL_parse_server_records, METH_VARARGS,
+     "Parse the raw records received from the server so far, without passing them to OpenSSL. Returns False if more data is needed and True once the ServerHello or HelloRetryRequest was parsed, which is then returned by get_server_hello(). Raises ValueError if the data is not a valid response and OpenSSLError if the server sent an alert."
+    },
+    {"enable_handshake_timing", (PyCFunction)nassl_SSL_enable_handshake_timing, METH_NOARGS,
+     "Record a timestamp for each message exchanged during the handshake as well as the number of bytes and round trips; the results are returned by get_handshake_timing()."
+    },
+    {"get_handshake_timing", (PyCFunction)nassl_SSL_get_handshake_timing, METH_NOARGS,
+     "Return a tuple of (duration, bytes_sent, bytes_received, round_trips, messages_count, messages) when handshake timing is enabled, or None. Each message is a tuple of (timestamp, is_sent, content_type, handshake_type, size) and at most 32 messages are recorded."
+    },
+    {"enable_transcript", (PyCFunction)nassl_SSL_enable_transcript, METH_VARARGS,
+     "Capture the raw messages exchanged over the connection in a ring buffer of the supplied capacity in bytes (64KB by default), evicting the oldest messages when it is full."
+    },
+    {"get_transcript", (PyCFunction)nassl_SSL_get_transcript, METH_NOARGS,
+     "Return the captured messages as a list of (is_sent, content_type, message) tuples from oldest to newest, or None if the transcript capture is not enabled."
+    },
+    {"get_transcript_dropped_count", (PyCFunction)nassl_SSL_get_transcript_dropped_count, METH_NOARGS,
+     "Return the number of messages that were evicted from the transcript or that were too large to be captured."
+    },
+    {"enable_counters", (PyCFunction)nassl_SSL_enable_counters, METH_NOARGS,
+     "Count the encrypted bytes and the calls to BIO_write() and BIO_read() on the network BIO, as well as the records, handshake messages and alerts exchanged and the socket calls made by flush_network_bio() and exchange(); the counters are returned by get_counters()."
+    },
+    {"get_counters", (PyCFunction)nassl_SSL_get_counters, METH_NOARGS,
+     "Return a tuple of (bytes_received, bytes_sent, records_received, records_sent, handshake_messages_received, handshake_messages_sent, alerts_received, alerts_sent, network_bio_write_calls, network_bio_read_calls, socket_recv_calls, socket_send_calls) when the counters are enabled, or None."
+    },
+    {"get_server_hello", (PyCFunction)nassl_SSL_get_server_hello, METH_NOARGS,
+     "Return a tuple of (version, cipher_id, cipher_name, compression_method, extensions, selected_group, is_hello_retry_request) parsed from the server's ServerHello by parse_server_records(), or None if it was not received."
+    },
     {NULL}  // Sentinel
 };
 /*
@@ -2,6 +2,56 @@
 
 #include "nassl_SSL_CTX.h"
 #include "nassl_BIO.h"
+#include "tls_codec.h"
+
+// Maximum number of messages for which a timestamp is recorded when handshake timing is enabled
+#define HANDSHAKE_TIMING_MAX_MESSAGES 32
+
+typedef struct {
+    double timestamp; // Seconds since the start of the handshake
+    unsigned char isSent;
+    unsigned char contentType;
+    unsigned char handshakeType; // Only set for handshake messages
+    unsigned int size;
+} HandshakeMessageTiming;
+
+typedef struct {
+    double startTime;
+    double endTime;
+    unsigned long bytesSent; // Including the record headers
+    unsigned long bytesReceived;
+    unsigned int roundTrips;
+    int wasLastMessageSent;
+    unsigned int messagesCount; // Including the messages that did not fit in the messages array
+    HandshakeMessageTiming messages[HANDSHAKE_TIMING_MAX_MESSAGES];
+} HandshakeTiming;
+
+// Bounded transcript of the raw messages exchanged, stored as (isSent, contentType, 4-byte size, message) entries in a
+// ring buffer; the oldest entries get evicted when it is full
+typedef struct {
+    unsigned char *buffer;
+    size_t capacity;
+    size_t start; // Offset of the oldest entry
+    size_t used;
+    unsigned long droppedCount; // Entries evicted or too large to fit
+} TranscriptBuffer;
+
+// Connection-level counters; the bytes and BIO calls are counted on the network BIO (and when flushing it), the socket
+// calls when flushing the network BIO or by exchange() and the rest in the message callback
+typedef struct {
+    unsigned long long bytesReceived; // Encrypted bytes written to the network BIO
+    unsigned long long bytesSent; // Encrypted bytes read from the network BIO
+    unsigned long recordsReceived;
+    unsigned long recordsSent;
+    unsigned long handshakeMessagesReceived;
+    unsigned long handshakeMessagesSent;
+    unsigned long alertsReceived;
+    unsigned long alertsSent;
+    unsigned long networkBioWriteCalls;
+    unsigned long networkBioReadCalls;
+    unsigned long socketRecvCalls; // Only the socket calls made in C
+    unsigned long socketSendCalls;
+} ConnectionCounters;
 
 // nassl.SSL Python class
 typedef struct {
@@ -12,6 +62,19 @@ typedef struct {
     // We only keep a reference of the network BIO so we know when to free the BIO object
     // The internal BIO is auto-freed by SSL_free() which is called in nassl_SSL_dealloc
     nassl_BIO_Object *networkBio_Object;
+
+    // The server's ServerHello, HelloRetryRequest or alert, parsed from its raw records by parse_server_records()
+    TlsServerResponse serverResponse;
+
+    // Only allocated when handshake timing is enabled
+    HandshakeTiming *handshakeTiming;
+
+    // Only allocated when the transcript capture is enabled
+    TranscriptBuffer *transcript;
+
+    // Only maintained when the counters are enabled
+    int areCountersEnabled;
+    ConnectionCounters counters;
 } nassl_SSL_Object;
 
 
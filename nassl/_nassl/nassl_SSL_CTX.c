@@ -2,10 +2,14 @@
 #include <Python.h>
 
 #include <openssl/ssl.h>
+#include <openssl/err.h>
 
+#include "intermediate_pool.h"
 #include "nassl_errors.h"
 #include "nassl_SSL_CTX.h"
 #include "python_utils.h"
+#include "socket_utils.h"
+#include "tls_codec.h"
 
 
 typedef enum
@@ -158,6 +162,13 @@ static PyObject* nassl_SSL_CTX_set_verify(nassl_SSL_CTX_Object *self, PyObject *
 
 
 
+static PyObject* nassl_SSL_CTX_use_intermediate_pool(nassl_SSL_CTX_Object *self, PyObject *args)
+{
+    SSL_CTX_set_cert_verify_callback(self->sslCtx, intermediate_pool_verify_cert, NULL);
+    Py_RETURN_NONE;
+}
+
+
 static PyObject* nassl_SSL_CTX_load_verify_locations(nassl_SSL_CTX_Object *self, PyObject *args)
 {
     char *caFilePath = NULL;
@@ -307,11 +318,377 @@ static PyObject* nassl_SSL_CTX_set1_sigalgs_list(nassl_SSL_CTX_Object *self, PyO
 }
 
 
+// Size of the buffer used to move data between the socket and the network BIO when probing a server
+#define PROBE_BUFFER_SIZE 16384
+
+static void probe_msg_callback(int writeP, int version, int contentType, const void *buf, size_t len, SSL *ssl,
+                               void *arg)
+{
+    TlsServerResponse *serverResponse = (TlsServerResponse *) arg;
+    TlsServerResponse parsedResponse;
+
+    // Only keep the first ServerHello or alert sent by the server
+    if (writeP || (serverResponse->messageType != TLS_MESSAGE_NONE))
+    {
+        return;
+    }
+    if (tls_parse_server_message(version, contentType, (const unsigned char *) buf, len, &parsedResponse))
+    {
+        *serverResponse = parsedResponse;
+    }
+}
+
+
+// Connects to the server, sends the ClientHello generated by a new SSL object offering the ciphers in cipherList and
+// returns as soon as the server's ServerHello or alert has been received, without going any further in the handshake.
+// Does not use the Python API so it can be called without holding the GIL.
+// Returns 0 if the connection could not be established (errorBuf then contains the error) and 1 otherwise; the
+// server's response is stored in serverResponse (messageType is TLS_MESSAGE_NONE if the server did not reply)
+static int probe_server_hello(SSL_CTX *sslCtx, const char *hostname, unsigned short port, const char *serverName,
+                              const char *cipherList, int timeoutMs, TlsServerResponse *serverResponse,
+                              char *errorBuf, size_t errorBufSize)
+{
+    SSL *ssl = NULL;
+    BIO *internalBio = NULL, *networkBio = NULL;
+    nassl_socket_t sock = NASSL_INVALID_SOCKET;
+    char buffer[PROBE_BUFFER_SIZE];
+    int isConnected = 1;
+
+    memset(serverResponse, 0, sizeof(TlsServerResponse));
+    ssl = SSL_new(sslCtx);
+    if (ssl == NULL)
+    {
+        snprintf(errorBuf, errorBufSize, "SSL_new() failed");
+        return 0;
+    }
+    if (!BIO_new_bio_pair(&internalBio, 0, &networkBio, 0))
+    {
+        SSL_free(ssl);
+        snprintf(errorBuf, errorBufSize, "BIO_new_bio_pair() failed");
+        return 0;
+    }
+    SSL_set_bio(ssl, internalBio, internalBio);
+    SSL_set_connect_state(ssl);
+    SSL_set_msg_callback(ssl, probe_msg_callback);
+    SSL_set_msg_callback_arg(ssl, serverResponse);
+    if (serverName != NULL)
+    {
+        SSL_set_tlsext_host_name(ssl, serverName);
+    }
+
+    if (cipherList != NULL)
+    {
+#ifndef LEGACY_OPENSSL
+        // TLS 1.3 cipher suites are configured separately; only offer the cipher suites we are testing, which is why
+        // a list cannot mix TLS 1.3 and older cipher suites
+        if (strncmp(cipherList, "TLS_", 4) == 0)
+        {
+            SSL_set_ciphersuites(ssl, cipherList);
+        }
+        else
+        {
+            // Without any TLS 1.3 cipher suite the ClientHello cannot offer TLS 1.3
+            SSL_set_ciphersuites(ssl, "");
+            SSL_set_cipher_list(ssl, cipherList);
+            SSL_set_max_proto_version(ssl, TLS1_2_VERSION);
+        }
+#else
+        SSL_set_cipher_list(ssl, cipherList);
+#endif
+    }
+
+    sock = socket_connect(hostname, port, timeoutMs, errorBuf, errorBufSize);
+    if (sock == NASSL_INVALID_SOCKET)
+    {
+        isConnected = 0;
+    }
+
+    while (isConnected && (serverResponse->messageType == TLS_MESSAGE_NONE))
+    {
+        int result, recvSize;
+        size_t pendingSize, writeGuarantee;
+
+        result = SSL_do_handshake(ssl);
+        if (serverResponse->messageType != TLS_MESSAGE_NONE)
+        {
+            // Got what we needed; do not send anything else to the server
+            break;
+        }
+
+        // Send the ClientHello
+        while ((pendingSize = BIO_ctrl_pending(networkBio)) > 0)
+        {
+            int readSize = BIO_read(networkBio, buffer,
+                                    pendingSize < sizeof(buffer) ? (int) pendingSize : (int) sizeof(buffer));
+            if ((readSize <= 0) || !socket_send_all(sock, buffer, readSize, timeoutMs))
+            {
+                break;
+            }
+        }
+
+        if ((result == 1) || (SSL_get_error(ssl, result) != SSL_ERROR_WANT_READ))
+        {
+            // OpenSSL could not generate a ClientHello (no ciphers available, etc.)
+            break;
+        }
+
+        writeGuarantee = BIO_ctrl_get_write_guarantee(networkBio);
+        recvSize = socket_recv(sock, buffer, writeGuarantee < sizeof(buffer) ? writeGuarantee : sizeof(buffer), timeoutMs);
+        if (recvSize <= 0)
+        {
+            // The server closed the connection or timed out; most likely it did not like our ClientHello
+            break;
+        }
+        BIO_write(networkBio, buffer, recvSize);
+    }
+
+    if (sock != NASSL_INVALID_SOCKET)
+    {
+        socket_close(sock);
+    }
+    SSL_free(ssl);  // Also frees the internal BIO
+    BIO_free(networkBio);
+    ERR_clear_error();
+    return isConnected;
+}
+
+
+// Returns the identifier the server will send back if it accepts the cipher, or 0 if OpenSSL does not support it
+static unsigned int get_cipher_id_from_name(SSL_CTX *sslCtx, const char *cipherName)
+{
+    unsigned int cipherId = 0;
+    int i = 0;
+    SSL *ssl = SSL_new(sslCtx);
+    STACK_OF(SSL_CIPHER) *ciphers = NULL;
+    if (ssl == NULL)
+    {
+        return 0;
+    }
+
+    // Look the cipher up among all the ciphers supported by this build, not only the ones enabled by default
+    SSL_set_cipher_list(ssl, "ALL:COMPLEMENTOFALL");
+    ciphers = SSL_get_ciphers(ssl);
+    for (i = 0; i < sk_SSL_CIPHER_num(ciphers); i++)
+    {
+        const SSL_CIPHER *cipher = sk_SSL_CIPHER_value(ciphers, i);
+        if (strcmp(SSL_CIPHER_get_name(cipher), cipherName) == 0)
+        {
+            // Two bytes for SSL 3.0 and TLS cipher suites, three bytes for SSL 2.0 cipher specs
+            cipherId = SSL_CIPHER_get_id(cipher) & 0x00FFFFFF;
+            break;
+        }
+    }
+    SSL_free(ssl);
+    return cipherId;
+}
+
+
+static PyObject* nassl_SSL_CTX_enumerate_ciphers(nassl_SSL_CTX_Object *self, PyObject *args)
+{
+    char *hostname = NULL, *serverName = NULL;
+    unsigned short port = 0;
+    double timeout = 5.0;
+    PyObject *candidatesPyList = NULL, *candidatesPyTuple = NULL, *acceptedPyList = NULL;
+    const char **cipherNames = NULL;
+    unsigned int *cipherIds = NULL;
+    int *isCipherAccepted = NULL;
+    Py_ssize_t i = 0, candidatesCount = 0;
+    int isConnected = 1;
+    char errorBuf[256];
+
+    if (!PyArg_ParseTuple(args, "sHO|zd", &hostname, &port, &candidatesPyList, &serverName, &timeout))
+    {
+        return NULL;
+    }
+
+    // Work on a copy of the list so it cannot be modified while we do not hold the GIL
+    candidatesPyTuple = PySequence_Tuple(candidatesPyList);
+    if (candidatesPyTuple == NULL)
+    {
+        return NULL;
+    }
+    candidatesCount = PyTuple_GET_SIZE(candidatesPyTuple);
+
+    cipherNames = (const char **) PyMem_Malloc(sizeof(char *) * (candidatesCount + 1));
+    cipherIds = (unsigned int *) PyMem_Malloc(sizeof(unsigned int) * (candidatesCount + 1));
+    isCipherAccepted = (int *) PyMem_Malloc(sizeof(int) * (candidatesCount + 1));
+    if ((cipherNames == NULL) || (cipherIds == NULL) || (isCipherAccepted == NULL))
+    {
+        PyErr_NoMemory();
+        goto cleanup;
+    }
+
+    for (i = 0; i < candidatesCount; i++)
+    {
+        char *cipherName = NULL;
+        if (!PyArg_Parse(PyTuple_GET_ITEM(candidatesPyTuple, i), "s", &cipherName))
+        {
+            goto cleanup;
+        }
+        cipherNames[i] = cipherName;
+        isCipherAccepted[i] = 0;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    for (i = 0; i < candidatesCount; i++)
+    {
+        TlsServerResponse serverResponse;
+        cipherIds[i] = get_cipher_id_from_name(self->sslCtx, cipherNames[i]);
+        if (cipherIds[i] == 0)
+        {
+            // Not supported by this OpenSSL build; there is no way we can negotiate it
+            continue;
+        }
+
+        isConnected = probe_server_hello(self->sslCtx, hostname, port, serverName, cipherNames[i],
+                                         (int) (timeout * 1000), &serverResponse, errorBuf, sizeof(errorBuf));
+        if (!isConnected)
+        {
+            break;
+        }
+        isCipherAccepted[i] = (serverResponse.messageType == TLS_MESSAGE_SERVER_HELLO)
+                && (serverResponse.cipherId == cipherIds[i]);
+    }
+    Py_END_ALLOW_THREADS
+
+    if (!isConnected)
+    {
+        PyErr_SetString(PyExc_IOError, errorBuf);
+        goto cleanup;
+    }
+
+    acceptedPyList = PyList_New(0);
+    if (acceptedPyList == NULL)
+    {
+        goto cleanup;
+    }
+    for (i = 0; i < candidatesCount; i++)
+    {
+        if (isCipherAccepted[i] && (PyList_Append(acceptedPyList, PyTuple_GET_ITEM(candidatesPyTuple, i)) == -1))
+        {
+            Py_CLEAR(acceptedPyList);
+            break;
+        }
+    }
+
+cleanup:
+    PyMem_Free(cipherNames);
+    PyMem_Free(cipherIds);
+    PyMem_Free(isCipherAccepted);
+    Py_DECREF(candidatesPyTuple);
+    return acceptedPyList;
+}
+
+
+static PyObject* nassl_SSL_CTX_get_preferred_cipher(nassl_SSL_CTX_Object *self, PyObject *args)
+{
+    char *hostname = NULL, *serverName = NULL;
+    unsigned short port = 0;
+    double timeout = 5.0;
+    PyObject *candidatesPyList = NULL, *candidatesPyTuple = NULL, *preferredPyObj = NULL;
+    const char **cipherNames = NULL;
+    char *cipherList = NULL;
+    size_t cipherListSize = 1;
+    Py_ssize_t i = 0, candidatesCount = 0, preferredIndex = -1;
+    int isConnected = 1;
+    char errorBuf[256];
+    TlsServerResponse serverResponse;
+
+    if (!PyArg_ParseTuple(args, "sHO|zd", &hostname, &port, &candidatesPyList, &serverName, &timeout))
+    {
+        return NULL;
+    }
+
+    candidatesPyTuple = PySequence_Tuple(candidatesPyList);
+    if (candidatesPyTuple == NULL)
+    {
+        return NULL;
+    }
+    candidatesCount = PyTuple_GET_SIZE(candidatesPyTuple);
+
+    cipherNames = (const char **) PyMem_Malloc(sizeof(char *) * (candidatesCount + 1));
+    if (cipherNames == NULL)
+    {
+        PyErr_NoMemory();
+        goto cleanup;
+    }
+    for (i = 0; i < candidatesCount; i++)
+    {
+        char *cipherName = NULL;
+        if (!PyArg_Parse(PyTuple_GET_ITEM(candidatesPyTuple, i), "s", &cipherName))
+        {
+            goto cleanup;
+        }
+        cipherNames[i] = cipherName;
+        cipherListSize += strlen(cipherName) + 1;
+    }
+
+    // Offer all the candidates, in the supplied order
+    cipherList = (char *) PyMem_Malloc(cipherListSize);
+    if (cipherList == NULL)
+    {
+        PyErr_NoMemory();
+        goto cleanup;
+    }
+    cipherList[0] = '\0';
+    for (i = 0; i < candidatesCount; i++)
+    {
+        if (i > 0)
+        {
+            strcat(cipherList, ":");
+        }
+        strcat(cipherList, cipherNames[i]);
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    isConnected = probe_server_hello(self->sslCtx, hostname, port, serverName, cipherList, (int) (timeout * 1000),
+                                     &serverResponse, errorBuf, sizeof(errorBuf));
+    if (isConnected && (serverResponse.messageType == TLS_MESSAGE_SERVER_HELLO))
+    {
+        for (i = 0; i < candidatesCount; i++)
+        {
+            if (get_cipher_id_from_name(self->sslCtx, cipherNames[i]) == serverResponse.cipherId)
+            {
+                preferredIndex = i;
+                break;
+            }
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    if (!isConnected)
+    {
+        PyErr_SetString(PyExc_IOError, errorBuf);
+        goto cleanup;
+    }
+
+    if (preferredIndex >= 0)
+    {
+        preferredPyObj = PyTuple_GET_ITEM(candidatesPyTuple, preferredIndex);
+    }
+    else
+    {
+        // The server did not accept any of the candidates
+        preferredPyObj = Py_None;
+    }
+    Py_INCREF(preferredPyObj);
+
+cleanup:
+    PyMem_Free(cipherList);
+    PyMem_Free(cipherNames);
+    Py_DECREF(candidatesPyTuple);
+    return preferredPyObj;
+}
+
+
 static PyMethodDef nassl_SSL_CTX_Object_methods[] =
 {
     {"set_verify", (PyCFunction)nassl_SSL_CTX_set_verify, METH_VARARGS,
      "OpenSSL's SSL_CTX_set_verify() with a NULL verify_callback."
     },
+    {"use_intermediate_pool", (PyCFunction)nassl_SSL_CTX_use_intermediate_pool, METH_NOARGS,
+     "OpenSSL's SSL_CTX_set_cert_verify_callback() with a callback that completes the peer's chain with the intermediate pool and adds the intermediates of the chains that were successfully verified to it. See X509_STORE.enable_intermediate_pool()."
+    },
     {"load_verify_locations", (PyCFunction)nassl_SSL_CTX_load_verify_locations, METH_VARARGS,
      "OpenSSL's SSL_CTX_load_verify_locations() with a NULL CAPath."
     },
@@ -333,6 +710,12 @@ static PyMethodDef nassl_SSL_CTX_Object_methods[] =
     {"set1_sigalgs_list", (PyCFunction)nassl_SSL_CTX_set1_sigalgs_list, METH_VARARGS,
      "OpenSSL's SSL_CTX_set1_sigalgs_list()."
     },
+    {"enumerate_ciphers", (PyCFunction)nassl_SSL_CTX_enumerate_ciphers, METH_VARARGS,
+     "Connects to the server once per candidate cipher and returns the list of ciphers the server accepted. Each connection uses an SSL object created from this SSL_CTX and is closed as soon as the ServerHello or an alert is received. Runs without holding the GIL."
+    },
+    {"get_preferred_cipher", (PyCFunction)nassl_SSL_CTX_get_preferred_cipher, METH_VARARGS,
+     "Connects to the server offering all the candidate ciphers in the supplied order and returns the one selected by the server, or None. The connection is closed as soon as the ServerHello or an alert is received. Runs without holding the GIL."
+    },
     {NULL}  // Sentinel
 };
 /*
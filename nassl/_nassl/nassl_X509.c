@@ -9,28 +9,109 @@
 
 #include <openssl/ssl.h>
 #include <openssl/evp.h>
+#include <openssl/err.h>
+#include <openssl/x509v3.h>
 
+#include "pythread.h"
 
 #include "nassl_errors.h"
 #include "nassl_X509.h"
 #include "nassl_X509_EXTENSION.h"
 #include "nassl_X509_NAME_ENTRY.h"
+#include "object_freelist.h"
+#include "ocsp_stapling.h"
 #include "openssl_utils.h"
+#include "time_utils.h"
+
+
+#ifdef LEGACY_OPENSSL
+#define ASN1_STRING_get0_data(asn1String) ASN1_STRING_data((ASN1_STRING *) (asn1String))
+#endif
+
+
+// One object per certificate gets created each time SSL.get_peer_cert_chain() is called
+DEFINE_OBJECT_FREELIST(x509FreeList, nassl_X509_Type);
+
+
+// Optional process-wide intern table, mapping the SHA-256 fingerprint of each certificate to the X509 object that was
+// first created for it; NULL when interning is disabled
+// Once the table is full, new certificates are not interned anymore
+static PyObject *internTable = NULL;
+static Py_ssize_t internTableMaxSize = 0;
+static unsigned long long internHitsCount = 0;
+static unsigned long long internMissesCount = 0;
+
+
+static PyObject* compute_sha256_fingerprint(X509 *x509)
+{
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digestLen = 0;
+    if (X509_digest(x509, EVP_sha256(), digest, &digestLen) != 1)
+    {
+        PyErr_SetString(nassl_OpenSSLError_Exception, "X509_digest() failed.");
+        return NULL;
+    }
+    return PyBytes_FromStringAndSize((char *)digest, digestLen);
+}
+
+
+PyObject* nassl_X509_from_X509(X509 *x509)
+{
+    nassl_X509_Object *x509_Object = NULL;
+    PyObject *fingerprintPyBytes = NULL;
+
+    if (internTable != NULL)
+    {
+        PyObject *internedPyObj = NULL;
+        fingerprintPyBytes = compute_sha256_fingerprint(x509);
+        if (fingerprintPyBytes == NULL)
+        {
+            X509_free(x509);
+            return NULL;
+        }
+
+        internedPyObj = PyDict_GetItem(internTable, fingerprintPyBytes);
+        if (internedPyObj != NULL)
+        {
+            internHitsCount++;
+            Py_DECREF(fingerprintPyBytes);
+            X509_free(x509);
+            Py_INCREF(internedPyObj);
+            return internedPyObj;
+        }
+        internMissesCount++;
+    }
+
+    x509_Object = nassl_X509_alloc();
+    if (x509_Object == NULL)
+    {
+        Py_XDECREF(fingerprintPyBytes);
+        X509_free(x509);
+        return NULL;
+    }
+    x509_Object->x509 = x509;
+    x509_Object->sha256Fingerprint = fingerprintPyBytes;
+
+    if ((fingerprintPyBytes != NULL) && (PyDict_Size(internTable) < internTableMaxSize))
+    {
+        if (PyDict_SetItem(internTable, fingerprintPyBytes, (PyObject *) x509_Object) < 0)
+        {
+            Py_DECREF(x509_Object);
+            return NULL;
+        }
+    }
+    return (PyObject *) x509_Object;
+}
 
 
 // nassl.X509.new()
 static PyObject* nassl_X509_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
     nassl_X509_Object *self;
+    X509 *x509;
     char *pemCertificate;
 	BIO *bio;
 	
-    self = (nassl_X509_Object *)type->tp_alloc(type, 0);
-    if (self == NULL)
-    {
-    	return NULL;
-    }
-
     // Read the certificate as PEM and create an X509 object
     if (!PyArg_ParseTuple(args, "s", &pemCertificate))
     {
@@ -40,14 +121,28 @@ static PyObject* nassl_X509_new(PyTypeObject *type, PyObject *args, PyObject *kw
     bio = BIO_new(BIO_s_mem());
     BIO_puts(bio, pemCertificate);
 
-    self->x509 = PEM_read_bio_X509(bio, NULL, NULL, NULL);
+    x509 = PEM_read_bio_X509(bio, NULL, NULL, NULL);
     BIO_vfree(bio);
 
-    if (self->x509 == NULL)
+    if (x509 == NULL)
     {
         PyErr_SetString(PyExc_ValueError, "Could not parse the supplied PEM certificate");
         return NULL;
     }
+
+    // Instances of subclasses are never interned
+    if (type == &nassl_X509_Type)
+    {
+        return nassl_X509_from_X509(x509);
+    }
+
+    self = (nassl_X509_Object *)type->tp_alloc(type, 0);
+    if (self == NULL)
+    {
+        X509_free(x509);
+    	return NULL;
+    }
+    self->x509 = x509;
     return (PyObject *)self;
 }
 
@@ -60,7 +155,93 @@ static void nassl_X509_dealloc(nassl_X509_Object *self)
   		X509_free(self->x509);
   		self->x509 = NULL;
   	}
-    Py_TYPE(self)->tp_free((PyObject*)self);
+    Py_CLEAR(self->sha256Fingerprint);
+    Py_CLEAR(self->cache);
+    Py_CLEAR(self->extensionIndexes);
+    object_freelist_free(&x509FreeList, (PyObject*)self);
+}
+
+
+nassl_X509_Object* nassl_X509_alloc(void)
+{
+    return (nassl_X509_Object *) object_freelist_alloc(&x509FreeList);
+}
+
+
+static PyObject* nassl_X509_enable_interning(PyObject *nullPtr, PyObject *args)
+{
+    Py_ssize_t maxSize = 10000;
+    if (!PyArg_ParseTuple(args, "|n", &maxSize))
+    {
+        return NULL;
+    }
+    if (maxSize < 1)
+    {
+        PyErr_SetString(PyExc_ValueError, "The maximum size of the intern table must be at least 1");
+        return NULL;
+    }
+
+    if (internTable == NULL)
+    {
+        internTable = PyDict_New();
+        if (internTable == NULL)
+        {
+            return NULL;
+        }
+    }
+    internTableMaxSize = maxSize;
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* nassl_X509_disable_interning(PyObject *nullPtr, PyObject *args)
+{
+    // The objects that were already returned stay valid; they are just not shared anymore
+    Py_CLEAR(internTable);
+    internTableMaxSize = 0;
+    internHitsCount = 0;
+    internMissesCount = 0;
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* nassl_X509_get_interning_stats(PyObject *nullPtr, PyObject *args)
+{
+    if (internTable == NULL)
+    {
+        Py_RETURN_NONE;
+    }
+    return Py_BuildValue("(nKK)", PyDict_Size(internTable), internHitsCount, internMissesCount);
+}
+
+
+static PyObject* nassl_X509_get_sha256_fingerprint(nassl_X509_Object *self, PyObject *args)
+{
+    if (self->sha256Fingerprint == NULL)
+    {
+        self->sha256Fingerprint = compute_sha256_fingerprint(self->x509);
+        if (self->sha256Fingerprint == NULL)
+        {
+            return NULL;
+        }
+    }
+    Py_INCREF(self->sha256Fingerprint);
+    return self->sha256Fingerprint;
+}
+
+
+static PyObject* nassl_X509_get_cache(nassl_X509_Object *self, PyObject *args)
+{
+    if (self->cache == NULL)
+    {
+        self->cache = PyDict_New();
+        if (self->cache == NULL)
+        {
+            return NULL;
+        }
+    }
+    Py_INCREF(self->cache);
+    return self->cache;
 }
 
 
@@ -84,6 +265,30 @@ static PyObject* nassl_X509_get_notAfter(nassl_X509_Object *self, PyObject *args
 }
 
 
+static PyObject* generic_get_timestamp(const ASN1_TIME *asn1Time)
+{
+    long long timestamp = 0;
+    if (!asn1_time_to_timestamp(asn1Time, &timestamp))
+    {
+        PyErr_SetString(PyExc_ValueError, "Could not parse the certificate's validity time");
+        return NULL;
+    }
+    return PyLong_FromLongLong(timestamp);
+}
+
+
+static PyObject* nassl_X509_get_notBefore_timestamp(nassl_X509_Object *self, PyObject *args)
+{
+    return generic_get_timestamp(X509_get_notBefore(self->x509));
+}
+
+
+static PyObject* nassl_X509_get_notAfter_timestamp(nassl_X509_Object *self, PyObject *args)
+{
+    return generic_get_timestamp(X509_get_notAfter(self->x509));
+}
+
+
 static PyObject* nassl_X509_get_version(nassl_X509_Object *self, PyObject *args)
 {
     long version = X509_get_version(self->x509);
@@ -98,6 +303,37 @@ static PyObject* nassl_X509_get_serialNumber(nassl_X509_Object *self, PyObject *
 }
 
 
+static PyObject* nassl_X509_get_serialNumber_bytes(nassl_X509_Object *self, PyObject *args)
+{
+    // The magnitude of the serial number as big-endian bytes
+    ASN1_INTEGER *serialNum = X509_get_serialNumber(self->x509);
+    return PyBytes_FromStringAndSize((const char *) ASN1_STRING_get0_data(serialNum), ASN1_STRING_length(serialNum));
+}
+
+
+static PyObject* nassl_X509_get_serialNumber_int(nassl_X509_Object *self, PyObject *args)
+{
+    // Negative serial numbers are invalid but do exist; BN_bn2hex() keeps their sign
+    BIGNUM *serialBn = ASN1_INTEGER_to_BN(X509_get_serialNumber(self->x509), NULL);
+    char *serialHex = NULL;
+    PyObject *serialPyLong = NULL;
+
+    if (serialBn == NULL)
+    {
+        return raise_OpenSSL_error();
+    }
+    serialHex = BN_bn2hex(serialBn);
+    BN_free(serialBn);
+    if (serialHex == NULL)
+    {
+        return raise_OpenSSL_error();
+    }
+    serialPyLong = PyLong_FromString(serialHex, NULL, 16);
+    OPENSSL_free(serialHex);
+    return serialPyLong;
+}
+
+
 static PyObject* nassl_X509_digest(nassl_X509_Object *self, PyObject *args)
 {
     unsigned char *readBuffer;
@@ -158,7 +394,7 @@ static PyObject* nassl_X509_get_extensions(nassl_X509_Object *self, PyObject *ar
             return NULL;
         }
 
-        x509ext_Object = (nassl_X509_EXTENSION_Object *)nassl_X509_EXTENSION_Type.tp_alloc(&nassl_X509_EXTENSION_Type, 0);
+        x509ext_Object = nassl_X509_EXTENSION_alloc();
         if (x509ext_Object == NULL)
         {
             Py_DECREF(extensionsPyList);
@@ -177,6 +413,141 @@ static PyObject* nassl_X509_get_extensions(nassl_X509_Object *self, PyObject *ar
 }
 
 
+static PyObject* get_oid_string(const ASN1_OBJECT *object);
+
+// Returns a borrowed reference to the map of the dotted OID of each extension to its index in the certificate
+static PyObject* get_extension_indexes(nassl_X509_Object *self)
+{
+    int i = 0;
+    if (self->extensionIndexes != NULL)
+    {
+        return self->extensionIndexes;
+    }
+
+    self->extensionIndexes = PyDict_New();
+    if (self->extensionIndexes == NULL)
+    {
+        return NULL;
+    }
+    // Iterate backwards so that the first extension wins if there are duplicates, like with X509_get_ext_by_OBJ()
+    for (i = X509_get_ext_count(self->x509) - 1; i >= 0; i--)
+    {
+        PyObject *oidPyString = NULL, *indexPyInt = NULL;
+        int setResult = 0;
+
+        oidPyString = get_oid_string(X509_EXTENSION_get_object(X509_get_ext(self->x509, i)));
+        if (oidPyString == NULL)
+        {
+            Py_CLEAR(self->extensionIndexes);
+            return NULL;
+        }
+        indexPyInt = PyLong_FromLong(i);
+        if (indexPyInt == NULL)
+        {
+            Py_DECREF(oidPyString);
+            Py_CLEAR(self->extensionIndexes);
+            return NULL;
+        }
+        setResult = PyDict_SetItem(self->extensionIndexes, oidPyString, indexPyInt);
+        Py_DECREF(oidPyString);
+        Py_DECREF(indexPyInt);
+        if (setResult < 0)
+        {
+            Py_CLEAR(self->extensionIndexes);
+            return NULL;
+        }
+    }
+    return self->extensionIndexes;
+}
+
+
+// Returns a borrowed reference to the extension's index or None, for an OID that is not in the map yet
+static PyObject* add_extension_index_alias(PyObject *extensionIndexes, PyObject *oidPyObj)
+{
+    PyObject *dottedOidPyString = NULL, *indexPyObj = NULL;
+    ASN1_OBJECT *object = NULL;
+    char *oidTxt = NULL;
+
+    if (!PyArg_Parse(oidPyObj, "s", &oidTxt))
+    {
+        return NULL;
+    }
+    // Accepts short names, long names and dotted OIDs
+    object = OBJ_txt2obj(oidTxt, 0);
+    if (object == NULL)
+    {
+        ERR_clear_error();
+        PyErr_Format(PyExc_ValueError, "Unknown OID: %s", oidTxt);
+        return NULL;
+    }
+    dottedOidPyString = get_oid_string(object);
+    ASN1_OBJECT_free(object);
+    if (dottedOidPyString == NULL)
+    {
+        return NULL;
+    }
+
+    indexPyObj = PyDict_GetItem(extensionIndexes, dottedOidPyString);
+    Py_DECREF(dottedOidPyString);
+    if (indexPyObj == NULL)
+    {
+        indexPyObj = Py_None;
+    }
+
+    // Later lookups with the same name do not have to go through OBJ_txt2obj()
+    if (PyDict_SetItem(extensionIndexes, oidPyObj, indexPyObj) < 0)
+    {
+        return NULL;
+    }
+    return indexPyObj;
+}
+
+
+static PyObject* nassl_X509_get_extension(nassl_X509_Object *self, PyObject *args)
+{
+    PyObject *oidPyObj = NULL, *extensionIndexes = NULL, *indexPyObj = NULL;
+    nassl_X509_EXTENSION_Object *x509ext_Object = NULL;
+
+    if (!PyArg_ParseTuple(args, "O", &oidPyObj))
+    {
+        return NULL;
+    }
+    extensionIndexes = get_extension_indexes(self);
+    if (extensionIndexes == NULL)
+    {
+        return NULL;
+    }
+
+    indexPyObj = PyDict_GetItem(extensionIndexes, oidPyObj);
+    if (indexPyObj == NULL)
+    {
+        indexPyObj = add_extension_index_alias(extensionIndexes, oidPyObj);
+        if (indexPyObj == NULL)
+        {
+            return NULL;
+        }
+    }
+    if (indexPyObj == Py_None)
+    {
+        Py_RETURN_NONE;
+    }
+
+    x509ext_Object = nassl_X509_EXTENSION_alloc();
+    if (x509ext_Object == NULL)
+    {
+        return PyErr_NoMemory();
+    }
+    // Same as get_extensions(), the X509_EXTENSION Python object must not depend on the X509 Python object
+    x509ext_Object->x509ext = X509_EXTENSION_dup(X509_get_ext(self->x509, PyLong_AsLong(indexPyObj)));
+    if (x509ext_Object->x509ext == NULL)
+    {
+        Py_DECREF(x509ext_Object);
+        return raise_OpenSSL_error();
+    }
+    return (PyObject *) x509ext_Object;
+}
+
+
 // Generic function to extract the list of X509_NAME_ENTRY from an X509_NAME.
 // Used to get the subject name entries and the issuer name entries. Returns a Python list
 static PyObject* generic_get_name_entries(X509_NAME * (*X509GetNameFunc)(const X509 *a), nassl_X509_Object *self)
@@ -213,7 +584,7 @@ static PyObject* generic_get_name_entries(X509_NAME * (*X509GetNameFunc)(const X
             return NULL;
         }
 
-        nameEntry_Object = (nassl_X509_NAME_ENTRY_Object *)nassl_X509_NAME_ENTRY_Type.tp_alloc(&nassl_X509_NAME_ENTRY_Type, 0);
+        nameEntry_Object = nassl_X509_NAME_ENTRY_alloc();
         if (nameEntry_Object == NULL)
         {
             return PyErr_NoMemory();
@@ -239,62 +610,1028 @@ static PyObject* nassl_X509_get_subject_name_entries(nassl_X509_Object *self, Py
 }
 
 
-static PyObject* nassl_X509_verify_cert_error_string(PyObject *nullPtr, PyObject *args)
+// The (short name, dotted OID) tuples of the name entry types are created once per NID and shared by all the
+// certificates, so that their strings are interned
+#define NAME_ENTRY_TYPES_CACHE_SIZE 2048
+static PyObject *nameEntryTypesByNid[NAME_ENTRY_TYPES_CACHE_SIZE];
+
+// Returns the dotted OID of the object as an interned string
+static PyObject* get_oid_string(const ASN1_OBJECT *object)
 {
-    const char *errorString = NULL;
-    long verifyError = 0;
-    if (!PyArg_ParseTuple(args, "l", &verifyError))
+    char oidTxtBuffer[128];
+    char *oidTxt = oidTxtBuffer;
+    int oidTxtLen = 0;
+    PyObject *oidPyString = NULL;
+
+    oidTxtLen = OBJ_obj2txt(oidTxtBuffer, sizeof(oidTxtBuffer), object, 1);
+    if (oidTxtLen < 0)
     {
-        return NULL;
+        return raise_OpenSSL_error();
     }
-
-    errorString = X509_verify_cert_error_string(verifyError);
-    return PyUnicode_FromString(errorString);
+    if (oidTxtLen >= (int) sizeof(oidTxtBuffer))
+    {
+        oidTxt = (char *) PyMem_Malloc(oidTxtLen + 1);
+        if (oidTxt == NULL)
+        {
+            return PyErr_NoMemory();
+        }
+        OBJ_obj2txt(oidTxt, oidTxtLen + 1, object, 1);
+    }
+    oidPyString = PyUnicode_InternFromString(oidTxt);
+    if (oidTxt != oidTxtBuffer)
+    {
+        PyMem_Free(oidTxt);
+    }
+    return oidPyString;
 }
 
-static PyObject* nassl_X509_get_spki_bytes(nassl_X509_Object *self, PyObject *args)
+
+static PyObject* create_name_entry_type(const ASN1_OBJECT *object, int nid)
 {
-    int spkiLen = 0;
-    unsigned char *spkiBufferEnd = NULL;
-    unsigned char *spkiBufferStart = NULL;
-    PyObject* spkiBytes = NULL;
+    PyObject *oidPyString = NULL, *shortNamePyString = NULL;
 
-    X509_PUBKEY *spki = X509_get_X509_PUBKEY(self->x509);
-    spkiLen = i2d_X509_PUBKEY(spki, NULL);
-    if (spkiLen < 0)
+    oidPyString = get_oid_string(object);
+    if (oidPyString == NULL)
     {
-        PyErr_SetString(PyExc_ValueError, "Could not extract SPKI bytes");
         return NULL;
     }
 
-    spkiBufferStart = PyMem_Malloc(spkiLen);
-    spkiBufferEnd = spkiBufferStart;
-    if (spkiBufferStart == NULL)
+    // Unknown types are only identified by their OID
+    if (nid == NID_undef)
     {
-        return PyErr_NoMemory();
+        Py_INCREF(oidPyString);
+        shortNamePyString = oidPyString;
+    }
+    else
+    {
+        shortNamePyString = PyUnicode_InternFromString(OBJ_nid2sn(nid));
+        if (shortNamePyString == NULL)
+        {
+            Py_DECREF(oidPyString);
+            return NULL;
+        }
     }
+    return Py_BuildValue("(NN)", shortNamePyString, oidPyString);
+}
 
-    i2d_X509_PUBKEY(spki, &spkiBufferEnd);
-    if (spkiBufferEnd - spkiBufferStart != spkiLen)
+
+// Returns a new reference to the (short name, dotted OID) tuple of the name entry's type
+static PyObject* get_name_entry_type(const ASN1_OBJECT *object)
+{
+    int nid = OBJ_obj2nid(object);
+    if ((nid == NID_undef) || (nid >= NAME_ENTRY_TYPES_CACHE_SIZE))
     {
-        // Should never happen
-        PyErr_SetString(PyExc_ValueError, "Could not extract SPKI bytes");
+        return create_name_entry_type(object, nid);
     }
-    else
+
+    if (nameEntryTypesByNid[nid] == NULL)
     {
-        spkiBytes = PyBytes_FromStringAndSize((char *)spkiBufferStart, spkiLen);
+        nameEntryTypesByNid[nid] = create_name_entry_type(object, nid);
+        if (nameEntryTypesByNid[nid] == NULL)
+        {
+            return NULL;
+        }
     }
-    PyMem_Free(spkiBufferStart);
-    return spkiBytes;
+    Py_INCREF(nameEntryTypesByNid[nid]);
+    return nameEntryTypesByNid[nid];
 }
 
 
-static PyMethodDef nassl_X509_Object_methods[] =
+static PyObject* generic_get_name(X509_NAME *x509Name)
 {
-    {"as_text", (PyCFunction)nassl_X509_as_text, METH_NOARGS,
-     "Returns a string containing the result of OpenSSL's X509_print()."
-    },
-    {"get_version", (PyCFunction)nassl_X509_get_version, METH_NOARGS,
+    int i = 0, nameEntryCount = 0;
+    PyObject *namePyTuple = NULL;
+
+    if (x509Name == NULL)
+    {
+        PyErr_SetString(PyExc_ValueError, "Could not extract a X509_NAME from the certificate. Exotic certificate ?");
+        return NULL;
+    }
+    nameEntryCount = X509_NAME_entry_count(x509Name);
+    namePyTuple = PyTuple_New(nameEntryCount);
+    if (namePyTuple == NULL)
+    {
+        return NULL;
+    }
+
+    // Return a (short name, dotted OID, value) tuple for each name entry
+    for (i = 0; i < nameEntryCount; i++)
+    {
+        X509_NAME_ENTRY *nameEntry = X509_NAME_get_entry(x509Name, i);
+        PyObject *typePyTuple = NULL, *valuePyString = NULL, *entryPyTuple = NULL;
+        unsigned char *valueUtf8 = NULL;
+        int valueUtf8Size = 0;
+
+        typePyTuple = get_name_entry_type(X509_NAME_ENTRY_get_object(nameEntry));
+        if (typePyTuple == NULL)
+        {
+            Py_DECREF(namePyTuple);
+            return NULL;
+        }
+
+        valueUtf8Size = ASN1_STRING_to_UTF8(&valueUtf8, X509_NAME_ENTRY_get_data(nameEntry));
+        if (valueUtf8Size < 0)
+        {
+            Py_DECREF(typePyTuple);
+            Py_DECREF(namePyTuple);
+            return raise_OpenSSL_error();
+        }
+        valuePyString = PyUnicode_FromStringAndSize((const char *) valueUtf8, valueUtf8Size);
+        OPENSSL_free(valueUtf8);
+        if (valuePyString == NULL)
+        {
+            Py_DECREF(typePyTuple);
+            Py_DECREF(namePyTuple);
+            return NULL;
+        }
+
+        entryPyTuple = Py_BuildValue("(OON)", PyTuple_GET_ITEM(typePyTuple, 0), PyTuple_GET_ITEM(typePyTuple, 1),
+                                     valuePyString);
+        Py_DECREF(typePyTuple);
+        if (entryPyTuple == NULL)
+        {
+            Py_DECREF(namePyTuple);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(namePyTuple, i, entryPyTuple);
+    }
+    return namePyTuple;
+}
+
+
+static PyObject* nassl_X509_get_issuer(nassl_X509_Object *self, PyObject *args)
+{
+    return generic_get_name(X509_get_issuer_name(self->x509));
+}
+
+
+static PyObject* nassl_X509_get_subject(nassl_X509_Object *self, PyObject *args)
+{
+    return generic_get_name(X509_get_subject_name(self->x509));
+}
+
+
+static PyObject* generic_get_name_rfc4514_string(X509_NAME *x509Name)
+{
+    PyObject *namePyString = NULL;
+    BIO *memBio = BIO_new(BIO_s_mem());
+    if (memBio == NULL)
+    {
+        return raise_OpenSSL_error();
+    }
+
+    // RFC 2253 and RFC 4514 use the same format; non-ASCII characters are kept as UTF-8 instead of being escaped
+    if (X509_NAME_print_ex(memBio, x509Name, 0, XN_FLAG_RFC2253 & ~ASN1_STRFLGS_ESC_MSB) < 0)
+    {
+        BIO_vfree(memBio);
+        return raise_OpenSSL_error();
+    }
+    namePyString = bioToPyString(memBio);
+    BIO_vfree(memBio);
+    return namePyString;
+}
+
+
+static PyObject* nassl_X509_get_issuer_rfc4514_string(nassl_X509_Object *self, PyObject *args)
+{
+    return generic_get_name_rfc4514_string(X509_get_issuer_name(self->x509));
+}
+
+
+static PyObject* nassl_X509_get_subject_rfc4514_string(nassl_X509_Object *self, PyObject *args)
+{
+    return generic_get_name_rfc4514_string(X509_get_subject_name(self->x509));
+}
+
+
+static PyObject* nassl_X509_get_issuer_name_hash(nassl_X509_Object *self, PyObject *args)
+{
+    return PyLong_FromUnsignedLong(X509_issuer_name_hash(self->x509));
+}
+
+
+static PyObject* nassl_X509_get_subject_name_hash(nassl_X509_Object *self, PyObject *args)
+{
+    return PyLong_FromUnsignedLong(X509_subject_name_hash(self->x509));
+}
+
+
+// Typed decoding of the most common extensions with X509_get_ext_d2i(), instead of parsing the text returned by
+// X509_EXTENSION.get_data()
+// Returns NULL and sets isMissingOut if the certificate does not have the extension, or raises ValueError if it could not
+// be decoded
+static void* get_decoded_extension(X509 *x509, int nid, int *isMissingOut)
+{
+    int critical = 0;
+    void *decodedExtension = X509_get_ext_d2i(x509, nid, &critical, NULL);
+    *isMissingOut = 0;
+    if (decodedExtension == NULL)
+    {
+        ERR_clear_error();
+        if (critical == -1)
+        {
+            *isMissingOut = 1;
+        }
+        else if (critical == -2)
+        {
+            PyErr_SetString(PyExc_ValueError, "The certificate contains the extension more than once");
+        }
+        else
+        {
+            PyErr_SetString(PyExc_ValueError, "Could not decode the extension");
+        }
+    }
+    return decodedExtension;
+}
+
+
+// IA5 strings should only contain ASCII characters but the bytes of malformed certificates are kept as is
+static PyObject* ia5_string_to_string(const ASN1_STRING *ia5String)
+{
+    return PyUnicode_DecodeLatin1((const char *) ASN1_STRING_get0_data(ia5String), ASN1_STRING_length(ia5String), NULL);
+}
+
+
+// Same format as OpenSSL's GENERAL_NAME_print()
+static PyObject* ip_address_to_string(const ASN1_OCTET_STRING *ipAddress)
+{
+    char ipAddressTxt[40];
+    const unsigned char *ipBytes = ASN1_STRING_get0_data(ipAddress);
+    int i = 0, ipAddressTxtLen = 0;
+
+    if (ASN1_STRING_length(ipAddress) == 4)
+    {
+        ipAddressTxtLen = sprintf(ipAddressTxt, "%d.%d.%d.%d", ipBytes[0], ipBytes[1], ipBytes[2], ipBytes[3]);
+    }
+    else if (ASN1_STRING_length(ipAddress) == 16)
+    {
+        for (i = 0; i < 8; i++)
+        {
+            ipAddressTxtLen += sprintf(ipAddressTxt + ipAddressTxtLen, (i == 0) ? "%X" : ":%X",
+                                       (ipBytes[2 * i] << 8) | ipBytes[2 * i + 1]);
+        }
+    }
+    else
+    {
+        ipAddressTxtLen = sprintf(ipAddressTxt, "<invalid>");
+    }
+    return PyUnicode_FromStringAndSize(ipAddressTxt, ipAddressTxtLen);
+}
+
+
+// Returns a (type, value) tuple using the same type names as OpenSSL's GENERAL_NAME_print()
+static PyObject* general_name_to_tuple(GENERAL_NAME *generalName)
+{
+    switch (generalName->type)
+    {
+        case GEN_DNS:
+            return Py_BuildValue("(sN)", "DNS", ia5_string_to_string(generalName->d.dNSName));
+        case GEN_EMAIL:
+            return Py_BuildValue("(sN)", "email", ia5_string_to_string(generalName->d.rfc822Name));
+        case GEN_URI:
+            return Py_BuildValue("(sN)", "URI", ia5_string_to_string(generalName->d.uniformResourceIdentifier));
+        case GEN_IPADD:
+            return Py_BuildValue("(sN)", "IP Address", ip_address_to_string(generalName->d.iPAddress));
+        case GEN_DIRNAME:
+            return Py_BuildValue("(sN)", "DirName", generic_get_name_rfc4514_string(generalName->d.directoryName));
+        case GEN_RID:
+            return Py_BuildValue("(sN)", "Registered ID", get_oid_string(generalName->d.registeredID));
+        case GEN_OTHERNAME:
+            // Only the type of the name is returned
+            return Py_BuildValue("(sN)", "othername", get_oid_string(generalName->d.otherName->type_id));
+        case GEN_X400:
+            return Py_BuildValue("(sO)", "X400Name", Py_None);
+        case GEN_EDIPARTY:
+            return Py_BuildValue("(sO)", "EdiPartyName", Py_None);
+        default:
+            PyErr_SetString(PyExc_ValueError, "Unknown GENERAL_NAME type");
+            return NULL;
+    }
+}
+
+
+static PyObject* nassl_X509_get_subject_alt_names(nassl_X509_Object *self, PyObject *args)
+{
+    PyObject *namesPyList = NULL;
+    int isMissing = 0, i = 0;
+    GENERAL_NAMES *names = get_decoded_extension(self->x509, NID_subject_alt_name, &isMissing);
+    if (names == NULL)
+    {
+        if (isMissing)
+        {
+            Py_RETURN_NONE;
+        }
+        return NULL;
+    }
+
+    namesPyList = PyList_New(sk_GENERAL_NAME_num(names));
+    if (namesPyList == NULL)
+    {
+        GENERAL_NAMES_free(names);
+        return NULL;
+    }
+    for (i = 0; i < sk_GENERAL_NAME_num(names); i++)
+    {
+        PyObject *namePyTuple = general_name_to_tuple(sk_GENERAL_NAME_value(names, i));
+        if (namePyTuple == NULL)
+        {
+            Py_DECREF(namesPyList);
+            GENERAL_NAMES_free(names);
+            return NULL;
+        }
+        PyList_SET_ITEM(namesPyList, i, namePyTuple);
+    }
+    GENERAL_NAMES_free(names);
+    return namesPyList;
+}
+
+
+static PyObject* nassl_X509_get_authority_info_access(nassl_X509_Object *self, PyObject *args)
+{
+    PyObject *accessPyList = NULL;
+    int isMissing = 0, i = 0;
+    AUTHORITY_INFO_ACCESS *accessDescriptions = get_decoded_extension(self->x509, NID_info_access, &isMissing);
+    if (accessDescriptions == NULL)
+    {
+        if (isMissing)
+        {
+            Py_RETURN_NONE;
+        }
+        return NULL;
+    }
+
+    accessPyList = PyList_New(0);
+    if (accessPyList == NULL)
+    {
+        AUTHORITY_INFO_ACCESS_free(accessDescriptions);
+        return NULL;
+    }
+    for (i = 0; i < sk_ACCESS_DESCRIPTION_num(accessDescriptions); i++)
+    {
+        ACCESS_DESCRIPTION *accessDescription = sk_ACCESS_DESCRIPTION_value(accessDescriptions, i);
+        PyObject *accessPyTuple = NULL, *methodPyString = NULL, *locationPyString = NULL;
+        int methodNid = OBJ_obj2nid(accessDescription->method);
+
+        // Only URI locations are used in practice
+        if (accessDescription->location->type != GEN_URI)
+        {
+            continue;
+        }
+        if (methodNid == NID_undef)
+        {
+            methodPyString = get_oid_string(accessDescription->method);
+        }
+        else
+        {
+            methodPyString = PyUnicode_FromString(OBJ_nid2sn(methodNid));
+        }
+        locationPyString = ia5_string_to_string(accessDescription->location->d.uniformResourceIdentifier);
+        if ((methodPyString != NULL) && (locationPyString != NULL))
+        {
+            // The tuple steals both references
+            accessPyTuple = Py_BuildValue("(NN)", methodPyString, locationPyString);
+        }
+        else
+        {
+            Py_XDECREF(methodPyString);
+            Py_XDECREF(locationPyString);
+        }
+        if ((accessPyTuple == NULL) || (PyList_Append(accessPyList, accessPyTuple) < 0))
+        {
+            Py_XDECREF(accessPyTuple);
+            Py_DECREF(accessPyList);
+            AUTHORITY_INFO_ACCESS_free(accessDescriptions);
+            return NULL;
+        }
+        Py_DECREF(accessPyTuple);
+    }
+    AUTHORITY_INFO_ACCESS_free(accessDescriptions);
+    return accessPyList;
+}
+
+
+static PyObject* nassl_X509_get_crl_distribution_points(nassl_X509_Object *self, PyObject *args)
+{
+    PyObject *urisPyList = NULL;
+    int isMissing = 0, i = 0, j = 0;
+    CRL_DIST_POINTS *distributionPoints = get_decoded_extension(self->x509, NID_crl_distribution_points, &isMissing);
+    if (distributionPoints == NULL)
+    {
+        if (isMissing)
+        {
+            Py_RETURN_NONE;
+        }
+        return NULL;
+    }
+
+    urisPyList = PyList_New(0);
+    if (urisPyList == NULL)
+    {
+        CRL_DIST_POINTS_free(distributionPoints);
+        return NULL;
+    }
+    for (i = 0; i < sk_DIST_POINT_num(distributionPoints); i++)
+    {
+        DIST_POINT *distributionPoint = sk_DIST_POINT_value(distributionPoints, i);
+        GENERAL_NAMES *fullNames = NULL;
+
+        // Relative names are not supported
+        if ((distributionPoint->distpoint == NULL) || (distributionPoint->distpoint->type != 0))
+        {
+            continue;
+        }
+        fullNames = distributionPoint->distpoint->name.fullname;
+        for (j = 0; j < sk_GENERAL_NAME_num(fullNames); j++)
+        {
+            GENERAL_NAME *fullName = sk_GENERAL_NAME_value(fullNames, j);
+            PyObject *uriPyString = NULL;
+            if (fullName->type != GEN_URI)
+            {
+                continue;
+            }
+            uriPyString = ia5_string_to_string(fullName->d.uniformResourceIdentifier);
+            if ((uriPyString == NULL) || (PyList_Append(urisPyList, uriPyString) < 0))
+            {
+                Py_XDECREF(uriPyString);
+                Py_DECREF(urisPyList);
+                CRL_DIST_POINTS_free(distributionPoints);
+                return NULL;
+            }
+            Py_DECREF(uriPyString);
+        }
+    }
+    CRL_DIST_POINTS_free(distributionPoints);
+    return urisPyList;
+}
+
+
+static PyObject* nassl_X509_get_certificate_policies(nassl_X509_Object *self, PyObject *args)
+{
+    PyObject *policiesPyList = NULL;
+    int isMissing = 0, i = 0;
+    CERTIFICATEPOLICIES *policies = get_decoded_extension(self->x509, NID_certificate_policies, &isMissing);
+    if (policies == NULL)
+    {
+        if (isMissing)
+        {
+            Py_RETURN_NONE;
+        }
+        return NULL;
+    }
+
+    policiesPyList = PyList_New(sk_POLICYINFO_num(policies));
+    if (policiesPyList == NULL)
+    {
+        CERTIFICATEPOLICIES_free(policies);
+        return NULL;
+    }
+    for (i = 0; i < sk_POLICYINFO_num(policies); i++)
+    {
+        PyObject *oidPyString = get_oid_string(sk_POLICYINFO_value(policies, i)->policyid);
+        if (oidPyString == NULL)
+        {
+            Py_DECREF(policiesPyList);
+            CERTIFICATEPOLICIES_free(policies);
+            return NULL;
+        }
+        PyList_SET_ITEM(policiesPyList, i, oidPyString);
+    }
+    CERTIFICATEPOLICIES_free(policies);
+    return policiesPyList;
+}
+
+
+static PyObject* nassl_X509_get_basic_constraints(nassl_X509_Object *self, PyObject *args)
+{
+    PyObject *pathLenPyObj = Py_None, *basicConstraintsPyTuple = NULL;
+    int isMissing = 0;
+    BASIC_CONSTRAINTS *basicConstraints = get_decoded_extension(self->x509, NID_basic_constraints, &isMissing);
+    if (basicConstraints == NULL)
+    {
+        if (isMissing)
+        {
+            Py_RETURN_NONE;
+        }
+        return NULL;
+    }
+
+    if (basicConstraints->pathlen != NULL)
+    {
+        pathLenPyObj = PyLong_FromLong(ASN1_INTEGER_get(basicConstraints->pathlen));
+        if (pathLenPyObj == NULL)
+        {
+            BASIC_CONSTRAINTS_free(basicConstraints);
+            return NULL;
+        }
+    }
+    else
+    {
+        Py_INCREF(Py_None);
+    }
+    basicConstraintsPyTuple = Py_BuildValue("(NN)", PyBool_FromLong(basicConstraints->ca), pathLenPyObj);
+    BASIC_CONSTRAINTS_free(basicConstraints);
+    return basicConstraintsPyTuple;
+}
+
+
+// The KU_XXX or XKU_XXX bits cached by OpenSSL when the certificate's extensions were processed
+static PyObject* generic_get_key_usage(X509 *x509, int isExtendedKeyUsage)
+{
+    unsigned long extensionFlag = isExtendedKeyUsage ? EXFLAG_XKUSAGE : EXFLAG_KUSAGE;
+#ifdef LEGACY_OPENSSL
+    // Populates the cached extensions
+    X509_check_purpose(x509, -1, 0);
+    if (!(x509->ex_flags & extensionFlag))
+    {
+        Py_RETURN_NONE;
+    }
+    return PyLong_FromUnsignedLong(isExtendedKeyUsage ? x509->ex_xkusage : x509->ex_kusage);
+#else
+    if (!(X509_get_extension_flags(x509) & extensionFlag))
+    {
+        Py_RETURN_NONE;
+    }
+    return PyLong_FromUnsignedLong(isExtendedKeyUsage ? X509_get_extended_key_usage(x509) : X509_get_key_usage(x509));
+#endif
+}
+
+
+static PyObject* nassl_X509_get_key_usage(nassl_X509_Object *self, PyObject *args)
+{
+    return generic_get_key_usage(self->x509, 0);
+}
+
+
+static PyObject* nassl_X509_get_extended_key_usage(nassl_X509_Object *self, PyObject *args)
+{
+    return generic_get_key_usage(self->x509, 1);
+}
+
+
+static PyObject* nassl_X509_is_ocsp_must_staple(nassl_X509_Object *self, PyObject *args)
+{
+    return PyBool_FromLong(ocsp_stapling_is_must_staple(self->x509));
+}
+
+
+static PyObject* nassl_X509_verify_cert_error_string(PyObject *nullPtr, PyObject *args)
+{
+    const char *errorString = NULL;
+    long verifyError = 0;
+    if (!PyArg_ParseTuple(args, "l", &verifyError))
+    {
+        return NULL;
+    }
+
+    errorString = X509_verify_cert_error_string(verifyError);
+    return PyUnicode_FromString(errorString);
+}
+
+// Matching of the certificate against an identity; X509_check_xxx() return 1 on a match, 0 on a mismatch and a negative
+// value on an internal error or for a malformed identity
+static PyObject* generic_check_result(int checkResult)
+{
+    if (checkResult < 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "Could not check the certificate: malformed name or internal error");
+        return NULL;
+    }
+    return PyBool_FromLong(checkResult);
+}
+
+
+static PyObject* nassl_X509_check_host(nassl_X509_Object *self, PyObject *args)
+{
+    char *hostname = NULL;
+    int hostnameLen = 0;
+    unsigned int flags = 0;
+    if (!PyArg_ParseTuple(args, "s#|I", &hostname, &hostnameLen, &flags))
+    {
+        return NULL;
+    }
+    return generic_check_result(X509_check_host(self->x509, hostname, hostnameLen, flags, NULL));
+}
+
+
+static PyObject* nassl_X509_check_ip_asc(nassl_X509_Object *self, PyObject *args)
+{
+    char *ipAddress = NULL;
+    unsigned int flags = 0;
+    if (!PyArg_ParseTuple(args, "s|I", &ipAddress, &flags))
+    {
+        return NULL;
+    }
+    return generic_check_result(X509_check_ip_asc(self->x509, ipAddress, flags));
+}
+
+
+static PyObject* nassl_X509_check_email(nassl_X509_Object *self, PyObject *args)
+{
+    char *email = NULL;
+    int emailLen = 0;
+    unsigned int flags = 0;
+    if (!PyArg_ParseTuple(args, "s#|I", &email, &emailLen, &flags))
+    {
+        return NULL;
+    }
+    return generic_check_result(X509_check_email(self->x509, email, emailLen, flags));
+}
+
+
+static PyObject* nassl_X509_get_spki_bytes(nassl_X509_Object *self, PyObject *args)
+{
+    int spkiLen = 0;
+    unsigned char *spkiBufferEnd = NULL;
+    unsigned char *spkiBufferStart = NULL;
+    PyObject* spkiBytes = NULL;
+
+    X509_PUBKEY *spki = X509_get_X509_PUBKEY(self->x509);
+    spkiLen = i2d_X509_PUBKEY(spki, NULL);
+    if (spkiLen < 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "Could not extract SPKI bytes");
+        return NULL;
+    }
+
+    spkiBufferStart = PyMem_Malloc(spkiLen);
+    spkiBufferEnd = spkiBufferStart;
+    if (spkiBufferStart == NULL)
+    {
+        return PyErr_NoMemory();
+    }
+
+    i2d_X509_PUBKEY(spki, &spkiBufferEnd);
+    if (spkiBufferEnd - spkiBufferStart != spkiLen)
+    {
+        // Should never happen
+        PyErr_SetString(PyExc_ValueError, "Could not extract SPKI bytes");
+    }
+    else
+    {
+        spkiBytes = PyBytes_FromStringAndSize((char *)spkiBufferStart, spkiLen);
+    }
+    PyMem_Free(spkiBufferStart);
+    return spkiBytes;
+}
+
+
+// Batch parsing: the certificates are parsed without holding the GIL, optionally split across the threads of a small
+// process-wide pool; the threads are started on first use and then wait for work, so that each call does not pay for
+// starting and joining threads
+#define PARSE_MANY_MAX_THREADS 16
+
+typedef struct {
+    const unsigned char **inputs;
+    Py_ssize_t *inputSizes;
+    X509 **certificates;
+    unsigned long *errorCodes;
+    Py_ssize_t inputsCount;
+} ParseManyJob;
+
+typedef struct {
+    ParseManyJob *job;
+    Py_ssize_t firstIndex; // Each worker parses every threadsCount-th input starting at firstIndex
+    Py_ssize_t step;
+} ParseManyWorker;
+
+typedef struct {
+    ParseManyWorker *worker; // Set before startLock gets released
+    PyThread_type_lock startLock; // Held while the thread waits for a worker to run
+    PyThread_type_lock doneLock; // Held while the thread runs its worker
+    int isBusy; // The thread was handed to a parse_many() call; protected by the pool's lock
+} ParseManyPoolThread;
+
+typedef struct {
+    PyThread_type_lock lock; // Allocated once and never freed, like the threads
+    ParseManyPoolThread threads[PARSE_MANY_MAX_THREADS - 1]; // The calling thread always does its share of the work
+    int threadsCount;
+} ParseManyPool;
+
+static ParseManyPool parseManyPool;
+
+
+static X509* parse_pem_or_der_certificate(const unsigned char *input, Py_ssize_t inputSize)
+{
+    if ((inputSize > 0) && (input[0] == 0x30))
+    {
+        // DER certificates start with a SEQUENCE
+        return d2i_X509(NULL, &input, (long) inputSize);
+    }
+    else
+    {
+        X509 *certificate = NULL;
+        BIO *bio = BIO_new_mem_buf((void *) input, (int) inputSize);
+        if (bio == NULL)
+        {
+            return NULL;
+        }
+        certificate = PEM_read_bio_X509(bio, NULL, NULL, NULL);
+        BIO_free(bio);
+        return certificate;
+    }
+}
+
+
+static void parse_many_worker_run(ParseManyWorker *worker)
+{
+    ParseManyJob *job = worker->job;
+    Py_ssize_t i = 0;
+
+    for (i = worker->firstIndex; i < job->inputsCount; i += worker->step)
+    {
+        job->certificates[i] = parse_pem_or_der_certificate(job->inputs[i], job->inputSizes[i]);
+        if (job->certificates[i] == NULL)
+        {
+            job->errorCodes[i] = ERR_peek_last_error();
+        }
+        ERR_clear_error();
+    }
+}
+
+
+static void parse_many_pool_thread(void *arg)
+{
+    ParseManyPoolThread *poolThread = (ParseManyPoolThread *) arg;
+    while (1)
+    {
+        PyThread_acquire_lock(poolThread->startLock, WAIT_LOCK);
+        parse_many_worker_run(poolThread->worker);
+        PyThread_release_lock(poolThread->doneLock);
+    }
+}
+
+
+static int start_pool_thread(ParseManyPoolThread *poolThread)
+{
+    poolThread->startLock = PyThread_allocate_lock();
+    poolThread->doneLock = PyThread_allocate_lock();
+    if ((poolThread->startLock != NULL) && (poolThread->doneLock != NULL))
+    {
+        // The thread waits for its first worker
+        PyThread_acquire_lock(poolThread->startLock, WAIT_LOCK);
+        if (PyThread_start_new_thread(parse_many_pool_thread, poolThread) != (unsigned long) -1)
+        {
+            return 1;
+        }
+        PyThread_release_lock(poolThread->startLock);
+    }
+    if (poolThread->startLock != NULL)
+    {
+        PyThread_free_lock(poolThread->startLock);
+        poolThread->startLock = NULL;
+    }
+    if (poolThread->doneLock != NULL)
+    {
+        PyThread_free_lock(poolThread->doneLock);
+        poolThread->doneLock = NULL;
+    }
+    return 0;
+}
+
+
+// Marks up to threadsCount threads of the pool as busy, starting new ones if needed, and returns how many were found
+static int acquire_pool_threads(ParseManyPoolThread **poolThreadsOut, int threadsCount)
+{
+    int i = 0, acquiredCount = 0;
+
+    PyThread_acquire_lock(parseManyPool.lock, WAIT_LOCK);
+    for (i = 0; (i < parseManyPool.threadsCount) && (acquiredCount < threadsCount); i++)
+    {
+        if (!parseManyPool.threads[i].isBusy)
+        {
+            parseManyPool.threads[i].isBusy = 1;
+            poolThreadsOut[acquiredCount++] = &parseManyPool.threads[i];
+        }
+    }
+    while ((acquiredCount < threadsCount) && (parseManyPool.threadsCount < PARSE_MANY_MAX_THREADS - 1))
+    {
+        ParseManyPoolThread *poolThread = &parseManyPool.threads[parseManyPool.threadsCount];
+        if (!start_pool_thread(poolThread))
+        {
+            break;
+        }
+        poolThread->isBusy = 1;
+        poolThreadsOut[acquiredCount++] = poolThread;
+        parseManyPool.threadsCount++;
+    }
+    PyThread_release_lock(parseManyPool.lock);
+    return acquiredCount;
+}
+
+
+static void release_pool_threads(ParseManyPoolThread **poolThreads, int threadsCount)
+{
+    int i = 0;
+    PyThread_acquire_lock(parseManyPool.lock, WAIT_LOCK);
+    for (i = 0; i < threadsCount; i++)
+    {
+        poolThreads[i]->isBusy = 0;
+    }
+    PyThread_release_lock(parseManyPool.lock);
+}
+
+
+// Returns the number of threads that were actually used; the calling thread always does its share of the work, and the
+// shares of the workers for which no thread of the pool was available
+static int run_parse_many_job(ParseManyJob *job, int threadsCount)
+{
+    ParseManyWorker workers[PARSE_MANY_MAX_THREADS];
+    ParseManyPoolThread *poolThreads[PARSE_MANY_MAX_THREADS - 1];
+    int i = 0, poolThreadsCount = 0;
+
+    for (i = 0; i < threadsCount; i++)
+    {
+        workers[i].job = job;
+        workers[i].firstIndex = i;
+        workers[i].step = threadsCount;
+    }
+
+    if ((threadsCount > 1) && (parseManyPool.lock != NULL))
+    {
+        poolThreadsCount = acquire_pool_threads(poolThreads, threadsCount - 1);
+    }
+    for (i = 0; i < poolThreadsCount; i++)
+    {
+        PyThread_acquire_lock(poolThreads[i]->doneLock, WAIT_LOCK);
+        poolThreads[i]->worker = &workers[i + 1];
+        PyThread_release_lock(poolThreads[i]->startLock);
+    }
+
+    parse_many_worker_run(&workers[0]);
+    for (i = poolThreadsCount + 1; i < threadsCount; i++)
+    {
+        parse_many_worker_run(&workers[i]);
+    }
+
+    // Wait for the threads of the pool
+    for (i = 0; i < poolThreadsCount; i++)
+    {
+        PyThread_acquire_lock(poolThreads[i]->doneLock, WAIT_LOCK);
+        PyThread_release_lock(poolThreads[i]->doneLock);
+    }
+    if (poolThreadsCount > 0)
+    {
+        release_pool_threads(poolThreads, poolThreadsCount);
+    }
+    return poolThreadsCount + 1;
+}
+
+
+static PyObject* nassl_X509_parse_many(PyObject *nullPtr, PyObject *args)
+{
+    PyObject *inputsPyObj = NULL, *inputsPyList = NULL, *certificatesPyList = NULL, *errorsPyList = NULL;
+    ParseManyJob job;
+    int threadsCount = 1;
+    Py_ssize_t i = 0;
+
+    if (!PyArg_ParseTuple(args, "O|i", &inputsPyObj, &threadsCount))
+    {
+        return NULL;
+    }
+    if ((threadsCount < 1) || (threadsCount > PARSE_MANY_MAX_THREADS))
+    {
+        PyErr_Format(PyExc_ValueError, "threads_count must be between 1 and %d", PARSE_MANY_MAX_THREADS);
+        return NULL;
+    }
+
+    // Keep a reference to each input as bytes, so that the buffers stay valid while the GIL is released; the list is a
+    // new one even if the inputs are already a list, so the encoded strings never replace the caller's items
+    inputsPyList = PySequence_List(inputsPyObj);
+    if (inputsPyList == NULL)
+    {
+        return NULL;
+    }
+    memset(&job, 0, sizeof(ParseManyJob));
+    job.inputsCount = PyList_GET_SIZE(inputsPyList);
+    for (i = 0; i < job.inputsCount; i++)
+    {
+        PyObject *inputPyObj = PyList_GET_ITEM(inputsPyList, i);
+        if (PyUnicode_Check(inputPyObj))
+        {
+            PyObject *encodedPyObj = PyUnicode_AsUTF8String(inputPyObj);
+            if (encodedPyObj == NULL)
+            {
+                Py_DECREF(inputsPyList);
+                return NULL;
+            }
+            PyList_SET_ITEM(inputsPyList, i, encodedPyObj);
+            Py_DECREF(inputPyObj);
+        }
+        else if (!PyBytes_Check(inputPyObj))
+        {
+            Py_DECREF(inputsPyList);
+            PyErr_SetString(PyExc_TypeError, "Certificates must be supplied as PEM or DER bytes, or as PEM strings");
+            return NULL;
+        }
+    }
+
+    if (job.inputsCount > 0)
+    {
+        job.inputs = (const unsigned char **) PyMem_Malloc(job.inputsCount * sizeof(unsigned char *));
+        job.inputSizes = (Py_ssize_t *) PyMem_Malloc(job.inputsCount * sizeof(Py_ssize_t));
+        job.certificates = (X509 **) PyMem_Malloc(job.inputsCount * sizeof(X509 *));
+        job.errorCodes = (unsigned long *) PyMem_Malloc(job.inputsCount * sizeof(unsigned long));
+        if ((job.inputs == NULL) || (job.inputSizes == NULL) || (job.certificates == NULL) || (job.errorCodes == NULL))
+        {
+            PyErr_NoMemory();
+            goto end;
+        }
+        for (i = 0; i < job.inputsCount; i++)
+        {
+            PyObject *inputPyObj = PyList_GET_ITEM(inputsPyList, i);
+            job.inputs[i] = (const unsigned char *) PyBytes_AS_STRING(inputPyObj);
+            job.inputSizes[i] = PyBytes_GET_SIZE(inputPyObj);
+            job.certificates[i] = NULL;
+            job.errorCodes[i] = 0;
+        }
+
+        if (threadsCount > job.inputsCount)
+        {
+            threadsCount = (int) job.inputsCount;
+        }
+        if ((threadsCount > 1) && (parseManyPool.lock == NULL))
+        {
+            // Without the pool, all the work is done by the calling thread
+            parseManyPool.lock = PyThread_allocate_lock();
+        }
+        Py_BEGIN_ALLOW_THREADS
+        run_parse_many_job(&job, threadsCount);
+        Py_END_ALLOW_THREADS
+    }
+
+    // Build the results: an X509 object or None for each input, and None or an error message for each input
+    certificatesPyList = PyList_New(job.inputsCount);
+    errorsPyList = PyList_New(job.inputsCount);
+    if ((certificatesPyList == NULL) || (errorsPyList == NULL))
+    {
+        goto end;
+    }
+    for (i = 0; i < job.inputsCount; i++)
+    {
+        PyObject *certificatePyObj = Py_None, *errorPyObj = Py_None;
+        if (job.certificates[i] != NULL)
+        {
+            // The object now owns the certificate
+            certificatePyObj = nassl_X509_from_X509(job.certificates[i]);
+            job.certificates[i] = NULL;
+            if (certificatePyObj == NULL)
+            {
+                goto end;
+            }
+        }
+        else
+        {
+            char errorString[256];
+            if (job.errorCodes[i] != 0)
+            {
+                ERR_error_string_n(job.errorCodes[i], errorString, sizeof(errorString));
+            }
+            else
+            {
+                strcpy(errorString, "Could not parse the supplied certificate");
+            }
+            errorPyObj = PyUnicode_FromString(errorString);
+            if (errorPyObj == NULL)
+            {
+                goto end;
+            }
+        }
+        Py_INCREF(Py_None);
+        PyList_SET_ITEM(certificatesPyList, i, certificatePyObj);
+        PyList_SET_ITEM(errorsPyList, i, errorPyObj);
+    }
+
+end:
+    if (job.certificates != NULL)
+    {
+        // Certificates that were not handed to an X509 object because of an error
+        for (i = 0; i < job.inputsCount; i++)
+        {
+            X509_free(job.certificates[i]);
+        }
+    }
+    PyMem_Free(job.inputs);
+    PyMem_Free(job.inputSizes);
+    PyMem_Free(job.certificates);
+    PyMem_Free(job.errorCodes);
+    Py_DECREF(inputsPyList);
+
+    if (PyErr_Occurred())
+    {
+        Py_XDECREF(certificatesPyList);
+        Py_XDECREF(errorsPyList);
+        return NULL;
+    }
+    return Py_BuildValue("(NN)", certificatesPyList, errorsPyList);
+}
+
+
+static PyMethodDef nassl_X509_Object_methods[] =
+{
+    {"as_text", (PyCFunction)nassl_X509_as_text, METH_NOARGS,
+     "Returns a string containing the result of OpenSSL's X509_print()."
+    },
+    {"get_version", (PyCFunction)nassl_X509_get_version, METH_NOARGS,
      "OpenSSL's X509_get_version()."
     },
     {"get_notBefore", (PyCFunction)nassl_X509_get_notBefore, METH_NOARGS,
@@ -303,9 +1640,21 @@ static PyMethodDef nassl_X509_Object_methods[] =
     {"get_notAfter", (PyCFunction)nassl_X509_get_notAfter, METH_NOARGS,
      "OpenSSL's X509_get_notAfter()."
     },
+    {"get_notBefore_timestamp", (PyCFunction)nassl_X509_get_notBefore_timestamp, METH_NOARGS,
+     "OpenSSL's X509_get_notBefore() converted to seconds since the epoch with ASN1_TIME_diff()."
+    },
+    {"get_notAfter_timestamp", (PyCFunction)nassl_X509_get_notAfter_timestamp, METH_NOARGS,
+     "OpenSSL's X509_get_notAfter() converted to seconds since the epoch with ASN1_TIME_diff()."
+    },
     {"get_serialNumber", (PyCFunction)nassl_X509_get_serialNumber, METH_NOARGS,
      "OpenSSL's x509_get_serialNumber()."
     },
+    {"get_serialNumber_int", (PyCFunction)nassl_X509_get_serialNumber_int, METH_NOARGS,
+     "OpenSSL's x509_get_serialNumber() returned as an integer."
+    },
+    {"get_serialNumber_bytes", (PyCFunction)nassl_X509_get_serialNumber_bytes, METH_NOARGS,
+     "OpenSSL's x509_get_serialNumber() returned as the big-endian bytes of its absolute value."
+    },
     {"digest", (PyCFunction)nassl_X509_digest, METH_NOARGS,
      "OpenSSL's X509_digest() with SHA1 hardcoded."
     },
@@ -315,6 +1664,9 @@ static PyMethodDef nassl_X509_Object_methods[] =
     {"get_extensions", (PyCFunction)nassl_X509_get_extensions, METH_NOARGS,
      "Returns a list of X509_EXTENSION objects using OpenSSL's X509_get_ext()."
     },
+    {"get_extension", (PyCFunction)nassl_X509_get_extension, METH_VARARGS,
+     "Returns the X509_EXTENSION object for the supplied dotted OID or OpenSSL short or long name (such as 'subjectAltName'), or None if the certificate does not have the extension. The map of the certificate's extensions is built on first use, so that later lookups do not have to go through all the extensions."
+    },
     {"get_issuer_name_entries", (PyCFunction)nassl_X509_get_issuer_name_entries, METH_NOARGS,
      "Returns a list of X509_NAME_ENTRY objects extracted from the issuer name using OpenSSL's X509_get_issuer_name() and X509_NAME_get_entry()."
     },
@@ -327,6 +1679,75 @@ static PyMethodDef nassl_X509_Object_methods[] =
     {"get_spki_bytes", (PyCFunction)nassl_X509_get_spki_bytes, METH_NOARGS,
      "Returns the Subject Public Key Info bytes using OpenSSL's X509_get_X509_PUBKEY() and i2d_X509_PUBKEY()."
     },
+    {"get_sha256_fingerprint", (PyCFunction)nassl_X509_get_sha256_fingerprint, METH_NOARGS,
+     "Returns the SHA-256 digest of the certificate using OpenSSL's X509_digest(); the result is cached."
+    },
+    {"get_cache", (PyCFunction)nassl_X509_get_cache, METH_NOARGS,
+     "Returns a dictionary for storing data derived from the certificate (parsed extensions, verification results, etc.). It is shared by all the users of an interned certificate and must not reference the certificate itself."
+    },
+    {"enable_interning", (PyCFunction)nassl_X509_enable_interning, METH_VARARGS | METH_STATIC,
+     "Enable the process-wide intern table, so that X509 objects created from identical certificates by X509(), X509.parse_many(), SSL.get_peer_certificate(), SSL.get_peer_cert_chain() and X509_STORE.verify() are one shared object. The table holds up to max_size certificates (10000 by default)."
+    },
+    {"disable_interning", (PyCFunction)nassl_X509_disable_interning, METH_NOARGS | METH_STATIC,
+     "Disable the intern table and release the certificates it holds."
+    },
+    {"get_interning_stats", (PyCFunction)nassl_X509_get_interning_stats, METH_NOARGS | METH_STATIC,
+     "Returns the (size, hits, misses) of the intern table, or None if interning is disabled."
+    },
+    {"get_issuer", (PyCFunction)nassl_X509_get_issuer, METH_NOARGS,
+     "Returns the issuer's name entries as a tuple of (short name, dotted OID, value) tuples, using OpenSSL's X509_get_issuer_name() and ASN1_STRING_to_UTF8()."
+    },
+    {"get_subject", (PyCFunction)nassl_X509_get_subject, METH_NOARGS,
+     "Returns the subject's name entries as a tuple of (short name, dotted OID, value) tuples, using OpenSSL's X509_get_subject_name() and ASN1_STRING_to_UTF8()."
+    },
+    {"get_issuer_rfc4514_string", (PyCFunction)nassl_X509_get_issuer_rfc4514_string, METH_NOARGS,
+     "Returns the issuer's name as an RFC 4514 string, using OpenSSL's X509_NAME_print_ex() with XN_FLAG_RFC2253."
+    },
+    {"get_subject_rfc4514_string", (PyCFunction)nassl_X509_get_subject_rfc4514_string, METH_NOARGS,
+     "Returns the subject's name as an RFC 4514 string, using OpenSSL's X509_NAME_print_ex() with XN_FLAG_RFC2253."
+    },
+    {"get_issuer_name_hash", (PyCFunction)nassl_X509_get_issuer_name_hash, METH_NOARGS,
+     "OpenSSL's X509_issuer_name_hash()."
+    },
+    {"get_subject_name_hash", (PyCFunction)nassl_X509_get_subject_name_hash, METH_NOARGS,
+     "OpenSSL's X509_subject_name_hash()."
+    },
+    {"get_subject_alt_names", (PyCFunction)nassl_X509_get_subject_alt_names, METH_NOARGS,
+     "Returns the subject alternative names as a list of (type, value) tuples using OpenSSL's X509_get_ext_d2i(), with the same type names as X509_EXTENSION.get_data() ('DNS', 'IP Address', 'email', 'URI', 'DirName' with an RFC 4514 string, etc.), or None if the certificate does not have the extension."
+    },
+    {"get_authority_info_access", (PyCFunction)nassl_X509_get_authority_info_access, METH_NOARGS,
+     "Returns the URIs of the authority information access extension as a list of (method, URI) tuples using OpenSSL's X509_get_ext_d2i(), where the method is 'OCSP', 'caIssuers' or a dotted OID, or None if the certificate does not have the extension."
+    },
+    {"get_crl_distribution_points", (PyCFunction)nassl_X509_get_crl_distribution_points, METH_NOARGS,
+     "Returns the URIs of the CRL distribution points extension as a list using OpenSSL's X509_get_ext_d2i(), or None if the certificate does not have the extension."
+    },
+    {"get_certificate_policies", (PyCFunction)nassl_X509_get_certificate_policies, METH_NOARGS,
+     "Returns the dotted OIDs of the certificate policies extension as a list using OpenSSL's X509_get_ext_d2i(), or None if the certificate does not have the extension."
+    },
+    {"get_basic_constraints", (PyCFunction)nassl_X509_get_basic_constraints, METH_NOARGS,
+     "Returns the basic constraints extension as a (ca, path length) tuple using OpenSSL's X509_get_ext_d2i(), where the path length may be None, or None if the certificate does not have the extension."
+    },
+    {"get_key_usage", (PyCFunction)nassl_X509_get_key_usage, METH_NOARGS,
+     "OpenSSL's X509_get_key_usage(). Returns the KU_XXX bits of the key usage extension, or None if the certificate does not have the extension."
+    },
+    {"get_extended_key_usage", (PyCFunction)nassl_X509_get_extended_key_usage, METH_NOARGS,
+     "OpenSSL's X509_get_extended_key_usage(). Returns the XKU_XXX bits of the extended key usage extension, or None if the certificate does not have the extension."
+    },
+    {"is_ocsp_must_staple", (PyCFunction)nassl_X509_is_ocsp_must_staple, METH_NOARGS,
+     "Returns True if the certificate has a TLS feature extension requiring status_request (OCSP must-staple, RFC 7633). A malformed extension is treated as requiring it."
+    },
+    {"check_host", (PyCFunction)nassl_X509_check_host, METH_VARARGS,
+     "OpenSSL's X509_check_host(). Returns True if the certificate matches the supplied DNS name."
+    },
+    {"check_ip_asc", (PyCFunction)nassl_X509_check_ip_asc, METH_VARARGS,
+     "OpenSSL's X509_check_ip_asc(). Returns True if the certificate matches the supplied IPv4 or IPv6 address."
+    },
+    {"check_email", (PyCFunction)nassl_X509_check_email, METH_VARARGS,
+     "OpenSSL's X509_check_email(). Returns True if the certificate matches the supplied email address."
+    },
+    {"parse_many", (PyCFunction)nassl_X509_parse_many, METH_VARARGS | METH_STATIC,
+     "Parse a list of PEM or DER certificates without holding the GIL, using up to threads_count threads (1 by default), which are taken from a process-wide pool that is reused across calls. Returns a tuple of two lists with one item per input: the X509 objects (None if parsing failed) and the errors (None if parsing succeeded)."
+    },
 
     {NULL}  // Sentinel
 };
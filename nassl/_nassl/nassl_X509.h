@@ -1,12 +1,26 @@
 #pragma once
 
+#ifdef LEGACY_OPENSSL
+#define X509_up_ref(x509) CRYPTO_add(&(x509)->references, 1, CRYPTO_LOCK_X509)
+#endif
+
 // nassl.X509 Python class
 typedef struct {
     PyObject_HEAD
     X509 *x509; // OpenSSL X509 C struct
+    PyObject *sha256Fingerprint; // Computed on first use; also the key in the intern table
+    PyObject *cache; // Dictionary for data derived from the certificate, created on first use
+    PyObject *extensionIndexes; // Dotted OID (or name) to extension index or None, built on first use by get_extension()
 } nassl_X509_Object;
 
 // Type needs to be accessible to nassl_SSL.c
 extern PyTypeObject nassl_X509_Type;
 
+// Returns a new object, recycled from the type's free list when possible
+nassl_X509_Object* nassl_X509_alloc(void);
+
+// Returns an X509 object for the certificate and takes ownership of x509, which is freed on error; when interning is
+// enabled, the object of an identical certificate that was already seen is returned instead
+PyObject* nassl_X509_from_X509(X509 *x509);
+
 void module_add_X509(PyObject* m);
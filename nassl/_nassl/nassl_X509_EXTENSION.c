@@ -6,11 +6,15 @@
 
 #include "nassl_errors.h"
 #include "nassl_X509_EXTENSION.h"
+#include "object_freelist.h"
 #include "openssl_utils.h"
 
 
 // For simplicity, this class does not properly mirror OpenSSL's X509_EXTENSION_() functions
 
+// One object per extension gets created each time X509.get_extensions() is called
+DEFINE_OBJECT_FREELIST(x509ExtensionFreeList, nassl_X509_EXTENSION_Type);
+
 static PyObject* nassl_X509_EXTENSION_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
     PyErr_SetString(PyExc_NotImplementedError, "Cannot directly create an X509_EXTENSION object. Get it from X509.get_extensions()");
@@ -25,7 +29,13 @@ static void nassl_X509_EXTENSION_dealloc(nassl_X509_EXTENSION_Object *self)
         X509_EXTENSION_free(self->x509ext);
         self->x509ext = NULL;
     }
-    Py_TYPE(self)->tp_free((PyObject*)self);
+    object_freelist_free(&x509ExtensionFreeList, (PyObject*)self);
+}
+
+
+nassl_X509_EXTENSION_Object* nassl_X509_EXTENSION_alloc(void)
+{
+    return (nassl_X509_EXTENSION_Object *) object_freelist_alloc(&x509ExtensionFreeList);
 }
 
 
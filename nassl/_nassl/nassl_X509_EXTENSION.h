@@ -8,4 +8,7 @@ typedef struct {
 // Type needs to be accessible to nassl_X509.c
 extern PyTypeObject nassl_X509_EXTENSION_Type;
 
+// Returns a new object, recycled from the type's free list when possible
+nassl_X509_EXTENSION_Object* nassl_X509_EXTENSION_alloc(void);
+
 void module_add_X509_EXTENSION(PyObject* m);
@@ -5,8 +5,12 @@
 
 #include "nassl_errors.h"
 #include "nassl_X509_NAME_ENTRY.h"
+#include "object_freelist.h"
 
 
+// One object per name entry gets created each time X509.get_subject_name_entries() or get_issuer_name_entries() is called
+DEFINE_OBJECT_FREELIST(x509NameEntryFreeList, nassl_X509_NAME_ENTRY_Type);
+
 static PyObject* nassl_X509_NAME_ENTRY_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
     PyErr_SetString(PyExc_NotImplementedError, "Cannot directly create an X509_NAME_ENTRY object. Get it from X509.get_issuer_name_entries()");
@@ -21,51 +25,43 @@ static void nassl_X509_NAME_ENTRY_dealloc(nassl_X509_NAME_ENTRY_Object *self)
         X509_NAME_ENTRY_free(self->x509NameEntry);
         self->x509NameEntry = NULL;
     }
-    Py_TYPE(self)->tp_free((PyObject*)self);
+    object_freelist_free(&x509NameEntryFreeList, (PyObject*)self);
+}
+
+
+nassl_X509_NAME_ENTRY_Object* nassl_X509_NAME_ENTRY_alloc(void)
+{
+    return (nassl_X509_NAME_ENTRY_Object *) object_freelist_alloc(&x509NameEntryFreeList);
 }
 
 
 static PyObject* nassl_X509_NAME_ENTRY_get_data(nassl_X509_NAME_ENTRY_Object *self)
 {
-    unsigned int nameDataSize = 0, objectDataSize = 0, nameUtf8Size = 0;
+    int nameUtf8Size = 0;
     ASN1_STRING *nameData = NULL;
-    ASN1_OBJECT *objectData = NULL;
     unsigned char *nameDataTxt = NULL;
-    unsigned char *objectDataTxt = NULL;
     PyObject* res = NULL;
 
     nameData = X509_NAME_ENTRY_get_data(self->x509NameEntry);
-    nameDataSize = ASN1_STRING_length(nameData);
-
-
-    // Extract the text representation of the field's name
-    objectData = X509_NAME_ENTRY_get_object(self->x509NameEntry);
-    objectDataSize = OBJ_obj2txt(NULL, 0, objectData, 0) + 1;
-
-    objectDataTxt = PyMem_Malloc(objectDataSize);
-    if (objectDataTxt == NULL)
+    nameUtf8Size = ASN1_STRING_to_UTF8(&nameDataTxt, nameData);
+    if (nameUtf8Size < 0)
     {
-        return PyErr_NoMemory();
+        return raise_OpenSSL_error();
     }
 
-    OBJ_obj2txt((char *)objectDataTxt, objectDataSize, objectData, 0);
-    nameUtf8Size = ASN1_STRING_to_UTF8(&nameDataTxt, nameData);
-
-
     // Are we extracting the Common Name ?
-    if (strncmp((char *)objectDataTxt, "commonName", strlen("commonName")) == 0)
+    if (OBJ_obj2nid(X509_NAME_ENTRY_get_object(self->x509NameEntry)) == NID_commonName)
     {
-        if (nameDataSize != nameUtf8Size)
+        if (strlen((char *)nameDataTxt) != (size_t) nameUtf8Size)
         {
-            // TODO: Unit test for that
             // Embedded null character in the Common Name ? Get out
-            PyMem_Free(objectDataTxt);
+            OPENSSL_free(nameDataTxt);
             PyErr_SetString(PyExc_NotImplementedError, "ASN1 string length does not match C string length. Embedded null character ?");
             return NULL;
         }
     }
-    PyMem_Free(objectDataTxt);
-    res = PyUnicode_FromStringAndSize((const char*) nameDataTxt, nameDataSize);
+    res = PyUnicode_FromStringAndSize((const char*) nameDataTxt, nameUtf8Size);
+    OPENSSL_free(nameDataTxt);
     return res;
 }
 
@@ -8,4 +8,7 @@ typedef struct {
 // Type needs to be accessible to nassl_X509.c
 extern PyTypeObject nassl_X509_NAME_ENTRY_Type;
 
+// Returns a new object, recycled from the type's free list when possible
+nassl_X509_NAME_ENTRY_Object* nassl_X509_NAME_ENTRY_alloc(void);
+
 void module_add_X509_NAME_ENTRY(PyObject* m);
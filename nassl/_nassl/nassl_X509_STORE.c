@@ -0,0 +1,401 @@
+#include <Python.h>
+
+// Fix symbol clashing on Windows
+// https://bugs.launchpad.net/pyopenssl/+bug/570101
+#ifdef _WIN32
+#include "winsock.h"
+#endif
+
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <openssl/x509_vfy.h>
+#include <openssl/err.h>
+
+#include "intermediate_pool.h"
+#include "nassl_errors.h"
+#include "nassl_X509.h"
+#include "nassl_X509_STORE.h"
+#include "python_utils.h"
+
+
+// Errors beyond this number are not reported by verify()
+#define VERIFY_MAX_ERRORS 64
+
+typedef struct {
+    int depth;
+    int error;
+} VerifyError;
+
+typedef struct {
+    int errorsCount;
+    VerifyError errors[VERIFY_MAX_ERRORS];
+} VerifyErrors;
+
+// Index of the VerifyErrors in the X509_STORE_CTX's ex data
+static int verifyErrorsIndex = -1;
+
+
+static PyObject* nassl_X509_STORE_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    nassl_X509_STORE_Object *self;
+    if (!PyArg_ParseTuple(args, ""))
+    {
+        return NULL;
+    }
+
+    self = (nassl_X509_STORE_Object *)type->tp_alloc(type, 0);
+    if (self == NULL)
+    {
+        return NULL;
+    }
+
+    self->x509Store = X509_STORE_new();
+    if (self->x509Store == NULL)
+    {
+        Py_DECREF(self);
+        return raise_OpenSSL_error();
+    }
+    return (PyObject *)self;
+}
+
+
+static void nassl_X509_STORE_dealloc(nassl_X509_STORE_Object *self)
+{
+    if (self->x509Store != NULL)
+    {
+        X509_STORE_free(self->x509Store);
+        self->x509Store = NULL;
+    }
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+
+static PyObject* nassl_X509_STORE_load_locations(nassl_X509_STORE_Object *self, PyObject *args)
+{
+    char *caFilePath = NULL;
+    if (PyArg_ParseFilePath(args, &caFilePath) == NULL)
+    {
+        return NULL;
+    }
+
+    if (!X509_STORE_load_locations(self->x509Store, caFilePath, NULL))
+    {
+        return raise_OpenSSL_error();
+    }
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* nassl_X509_STORE_add_cert(nassl_X509_STORE_Object *self, PyObject *args)
+{
+    nassl_X509_Object *x509_Object = NULL;
+    if (!PyArg_ParseTuple(args, "O!", &nassl_X509_Type, &x509_Object))
+    {
+        return NULL;
+    }
+
+    if (!X509_STORE_add_cert(self->x509Store, x509_Object->x509))
+    {
+        return raise_OpenSSL_error();
+    }
+    Py_RETURN_NONE;
+}
+
+
+// Records every error instead of stopping at the first one; runs without the GIL
+static int verify_callback(int isOk, X509_STORE_CTX *x509StoreCtx)
+{
+    VerifyErrors *verifyErrors = NULL;
+    if (isOk)
+    {
+        return 1;
+    }
+
+    verifyErrors = (VerifyErrors *) X509_STORE_CTX_get_ex_data(x509StoreCtx, verifyErrorsIndex);
+    if ((verifyErrors != NULL) && (verifyErrors->errorsCount < VERIFY_MAX_ERRORS))
+    {
+        verifyErrors->errors[verifyErrors->errorsCount].depth = X509_STORE_CTX_get_error_depth(x509StoreCtx);
+        verifyErrors->errors[verifyErrors->errorsCount].error = X509_STORE_CTX_get_error(x509StoreCtx);
+        verifyErrors->errorsCount++;
+    }
+    return 1;
+}
+
+
+static PyObject* convert_chain_to_list(STACK_OF(X509) *chain)
+{
+    PyObject *chainPyList = NULL;
+    int i = 0, certsCount = 0;
+
+    certsCount = (chain == NULL) ? 0 : sk_X509_num(chain);
+    chainPyList = PyList_New(certsCount);
+    if (chainPyList == NULL)
+    {
+        return NULL;
+    }
+    for (i = 0; i < certsCount; i++)
+    {
+        PyObject *x509_PyObject = NULL;
+        X509_up_ref(sk_X509_value(chain, i));
+        x509_PyObject = nassl_X509_from_X509(sk_X509_value(chain, i));
+        if (x509_PyObject == NULL)
+        {
+            Py_DECREF(chainPyList);
+            return NULL;
+        }
+        PyList_SET_ITEM(chainPyList, i, x509_PyObject);
+    }
+    return chainPyList;
+}
+
+
+static PyObject* nassl_X509_STORE_verify(nassl_X509_STORE_Object *self, PyObject *args)
+{
+    nassl_X509_Object *leaf_Object = NULL;
+    PyObject *untrustedPyObj = Py_None, *timePyObj = Py_None, *untrustedPyTuple = NULL;
+    PyObject *chainPyList = NULL, *errorsPyList = NULL;
+    STACK_OF(X509) *untrustedCerts = NULL, *chain = NULL;
+    X509_STORE_CTX *x509StoreCtx = NULL;
+    VerifyErrors verifyErrors;
+    long long verificationTime = 0;
+    int purpose = 0, i = 0;
+
+    if (!PyArg_ParseTuple(args, "O!|OOi", &nassl_X509_Type, &leaf_Object, &untrustedPyObj, &timePyObj, &purpose))
+    {
+        return NULL;
+    }
+    if (timePyObj != Py_None)
+    {
+        verificationTime = PyLong_AsLongLong(timePyObj);
+        if (PyErr_Occurred())
+        {
+            return NULL;
+        }
+    }
+
+    // The untrusted certificates are referenced by the stack so that they stay valid while the GIL is released
+    untrustedCerts = sk_X509_new_null();
+    if (untrustedCerts == NULL)
+    {
+        return raise_OpenSSL_error();
+    }
+    if (untrustedPyObj != Py_None)
+    {
+        untrustedPyTuple = PySequence_Tuple(untrustedPyObj);
+        if (untrustedPyTuple == NULL)
+        {
+            goto end;
+        }
+        for (i = 0; i < PyTuple_GET_SIZE(untrustedPyTuple); i++)
+        {
+            PyObject *certPyObj = PyTuple_GET_ITEM(untrustedPyTuple, i);
+            if (!PyObject_TypeCheck(certPyObj, &nassl_X509_Type))
+            {
+                PyErr_SetString(PyExc_TypeError, "The untrusted chain must only contain X509 objects");
+                goto end;
+            }
+            if (!sk_X509_push(untrustedCerts, ((nassl_X509_Object *) certPyObj)->x509))
+            {
+                raise_OpenSSL_error();
+                goto end;
+            }
+            X509_up_ref(((nassl_X509_Object *) certPyObj)->x509);
+        }
+    }
+
+    x509StoreCtx = X509_STORE_CTX_new();
+    if (x509StoreCtx == NULL)
+    {
+        raise_OpenSSL_error();
+        goto end;
+    }
+    if (!X509_STORE_CTX_init(x509StoreCtx, self->x509Store, leaf_Object->x509, untrustedCerts))
+    {
+        raise_OpenSSL_error();
+        goto end;
+    }
+    if ((purpose != 0) && (!X509_STORE_CTX_set_purpose(x509StoreCtx, purpose)))
+    {
+        PyErr_SetString(PyExc_ValueError, "Invalid purpose");
+        goto end;
+    }
+    if (timePyObj != Py_None)
+    {
+        X509_STORE_CTX_set_time(x509StoreCtx, 0, (time_t) verificationTime);
+    }
+
+    memset(&verifyErrors, 0, sizeof(VerifyErrors));
+    X509_STORE_CTX_set_ex_data(x509StoreCtx, verifyErrorsIndex, &verifyErrors);
+    X509_STORE_CTX_set_verify_cb(x509StoreCtx, verify_callback);
+
+    Py_BEGIN_ALLOW_THREADS
+    // Same as X509_verify_cert() when the intermediate pool is disabled
+    intermediate_pool_verify_cert(x509StoreCtx, NULL);
+    chain = X509_STORE_CTX_get1_chain(x509StoreCtx);
+    ERR_clear_error();
+    Py_END_ALLOW_THREADS
+
+    // Return the chain that was built and the errors as (depth, error code, error string) tuples
+    chainPyList = convert_chain_to_list(chain);
+    if (chainPyList == NULL)
+    {
+        goto end;
+    }
+    errorsPyList = PyList_New(verifyErrors.errorsCount);
+    if (errorsPyList == NULL)
+    {
+        goto end;
+    }
+    for (i = 0; i < verifyErrors.errorsCount; i++)
+    {
+        PyObject *errorPyTuple = Py_BuildValue("(iis)", verifyErrors.errors[i].depth, verifyErrors.errors[i].error,
+                                               X509_verify_cert_error_string(verifyErrors.errors[i].error));
+        if (errorPyTuple == NULL)
+        {
+            goto end;
+        }
+        PyList_SET_ITEM(errorsPyList, i, errorPyTuple);
+    }
+
+end:
+    sk_X509_pop_free(chain, X509_free);
+    X509_STORE_CTX_free(x509StoreCtx);
+    sk_X509_pop_free(untrustedCerts, X509_free);
+    Py_XDECREF(untrustedPyTuple);
+
+    if (PyErr_Occurred())
+    {
+        Py_XDECREF(chainPyList);
+        Py_XDECREF(errorsPyList);
+        return NULL;
+    }
+    return Py_BuildValue("(NN)", chainPyList, errorsPyList);
+}
+
+
+static PyObject* nassl_X509_STORE_enable_intermediate_pool(PyObject *nullPtr, PyObject *args)
+{
+    int maxSize = 1000;
+    if (!PyArg_ParseTuple(args, "|i", &maxSize))
+    {
+        return NULL;
+    }
+    if (maxSize < 1)
+    {
+        PyErr_SetString(PyExc_ValueError, "The maximum size of the intermediate pool must be at least 1");
+        return NULL;
+    }
+    if (!intermediate_pool_enable(maxSize))
+    {
+        return PyErr_NoMemory();
+    }
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* nassl_X509_STORE_disable_intermediate_pool(PyObject *nullPtr, PyObject *args)
+{
+    intermediate_pool_disable();
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* nassl_X509_STORE_get_intermediate_pool_stats(PyObject *nullPtr, PyObject *args)
+{
+    unsigned long long hitsCount = 0, addedCount = 0;
+    int size = 0;
+    if (!intermediate_pool_get_stats(&size, &hitsCount, &addedCount))
+    {
+        Py_RETURN_NONE;
+    }
+    return Py_BuildValue("(iKK)", size, hitsCount, addedCount);
+}
+
+
+static PyMethodDef nassl_X509_STORE_Object_methods[] =
+{
+    {"load_locations", (PyCFunction)nassl_X509_STORE_load_locations, METH_VARARGS,
+     "OpenSSL's X509_STORE_load_locations() with a NULL CAPath."
+    },
+    {"add_cert", (PyCFunction)nassl_X509_STORE_add_cert, METH_VARARGS,
+     "OpenSSL's X509_STORE_add_cert()."
+    },
+    {"verify", (PyCFunction)nassl_X509_STORE_verify, METH_VARARGS,
+     "Verify a certificate with OpenSSL's X509_verify_cert() without holding the GIL. Takes the leaf X509 object, an optional list of untrusted X509 objects, an optional verification time in seconds since the epoch and an optional X509_PURPOSE_XXX value. Returns the chain that was built and the list of all the errors that were found as (depth, error code, error string) tuples; the list is empty if the certificate is valid. Intermediates missing from the untrusted list are taken from the intermediate pool if it is enabled."
+    },
+    {"enable_intermediate_pool", (PyCFunction)nassl_X509_STORE_enable_intermediate_pool, METH_VARARGS | METH_STATIC,
+     "Enable the process-wide pool of intermediate certificates, which holds up to max_size (default: 1000) intermediates taken from the chains that were successfully verified; the oldest intermediates are evicted first. The pool is used to complete the chains of later verifications that are missing some intermediates, with verify() or with an SSL_CTX that called use_intermediate_pool(). Calling it again empties the pool."
+    },
+    {"disable_intermediate_pool", (PyCFunction)nassl_X509_STORE_disable_intermediate_pool, METH_NOARGS | METH_STATIC,
+     "Disable the intermediate pool and release its certificates."
+    },
+    {"get_intermediate_pool_stats", (PyCFunction)nassl_X509_STORE_get_intermediate_pool_stats, METH_NOARGS | METH_STATIC,
+     "Return the number of certificates in the intermediate pool, the number of intermediates that were taken from it and the number of intermediates that were added to it as a tuple, or None if it is disabled."
+    },
+    {NULL}  // Sentinel
+};
+
+
+PyTypeObject nassl_X509_STORE_Type =
+{
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_nassl.X509_STORE",             /*tp_name*/
+    sizeof(nassl_X509_STORE_Object),             /*tp_basicsize*/
+    0,                         /*tp_itemsize*/
+    (destructor)nassl_X509_STORE_dealloc, /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    0,                         /*tp_repr*/
+    0,                         /*tp_as_number*/
+    0,                         /*tp_as_sequence*/
+    0,                         /*tp_as_mapping*/
+    0,                         /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    0,                         /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /*tp_flags*/
+    "X509_STORE objects",           /* tp_doc */
+    0,                     /* tp_traverse */
+    0,                     /* tp_clear */
+    0,                     /* tp_richcompare */
+    0,                     /* tp_weaklistoffset */
+    0,                     /* tp_iter */
+    0,                     /* tp_iternext */
+    nassl_X509_STORE_Object_methods,             /* tp_methods */
+    0,             /* tp_members */
+    0,                         /* tp_getset */
+    0,                         /* tp_base */
+    0,                         /* tp_dict */
+    0,                         /* tp_descr_get */
+    0,                         /* tp_descr_set */
+    0,                         /* tp_dictoffset */
+    0,      /* tp_init */
+    0,                         /* tp_alloc */
+    nassl_X509_STORE_new,                 /* tp_new */
+};
+
+
+
+int module_add_X509_STORE(PyObject* m)
+{
+    verifyErrorsIndex = X509_STORE_CTX_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+    if (verifyErrorsIndex < 0)
+    {
+        PyErr_SetString(PyExc_ImportError, "Could not allocate the X509_STORE_CTX ex data index");
+        return 0;
+    }
+
+    nassl_X509_STORE_Type.tp_new = nassl_X509_STORE_new;
+    if (PyType_Ready(&nassl_X509_STORE_Type) < 0)
+    {
+        return 0;
+    }
+
+    Py_INCREF(&nassl_X509_STORE_Type);
+    PyModule_AddObject(m, "X509_STORE", (PyObject *)&nassl_X509_STORE_Type);
+    return 1;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// nassl.X509_STORE Python class
+typedef struct {
+    PyObject_HEAD
+    X509_STORE *x509Store; // OpenSSL X509_STORE C struct
+} nassl_X509_STORE_Object;
+
+extern PyTypeObject nassl_X509_STORE_Type;
+
+int module_add_X509_STORE(PyObject* m);
@@ -0,0 +1,371 @@
+#include <Python.h>
+
+#include <openssl/ssl.h>
+
+#include "nassl_errors.h"
+#include "nassl_cipher_table.h"
+
+
+static PyTypeObject nassl_CipherInfo_Type;
+
+static PyStructSequence_Field nassl_CipherInfo_fields[] =
+{
+    {"name", "OpenSSL name of the cipher suite."},
+    {"protocol_id", "Identifier sent on the wire: 2 bytes for SSL 3.0 and TLS, 3 bytes for SSL 2.0."},
+    {"min_version", "Protocol version (0x0002 for SSL 2.0, 0x0300 for SSL 3.0, 0x0301 for TLS 1.0, etc.) the cipher suite was introduced in."},
+    {"kx", "Key exchange algorithm."},
+    {"auth", "Authentication algorithm."},
+    {"enc", "Symmetric encryption algorithm."},
+    {"bits", "Number of secret bits of the symmetric encryption algorithm."},
+    {"mac", "Message authentication algorithm."},
+    {"is_export", "True if the cipher suite is an export cipher suite."},
+    {"description", "Description returned by OpenSSL's SSL_CIPHER_description()."},
+    {NULL}
+};
+
+static PyStructSequence_Desc nassl_CipherInfo_desc =
+{
+    "_nassl.CipherInfo",
+    "Details about a cipher suite supported by OpenSSL.",
+    nassl_CipherInfo_fields,
+    10
+};
+
+// Built when the module gets imported and never modified afterwards
+static PyObject *ciphersByName = NULL;
+static PyObject *ciphersById = NULL;
+
+
+// Returns the protocol version number corresponding to the SSL_CIPHER_get_version() string
+static unsigned int get_min_version_from_string(const char *version)
+{
+    if (strcmp(version, "SSLv2") == 0)
+    {
+        return 0x0002;
+    }
+    else if ((strcmp(version, "SSLv3") == 0) || (strcmp(version, "TLSv1/SSLv3") == 0))
+    {
+        return 0x0300;
+    }
+    else if ((strcmp(version, "TLSv1") == 0) || (strcmp(version, "TLSv1.0") == 0))
+    {
+        return 0x0301;
+    }
+    else if (strcmp(version, "TLSv1.1") == 0)
+    {
+        return 0x0302;
+    }
+    else if (strcmp(version, "TLSv1.2") == 0)
+    {
+        return 0x0303;
+    }
+    else if (strcmp(version, "TLSv1.3") == 0)
+    {
+        return 0x0304;
+    }
+    return 0;
+}
+
+
+#ifdef LEGACY_OPENSSL
+// Extracts the value of a "Key=Value" field from the output of SSL_CIPHER_description(); the value's parenthesized
+// number of bits (such as in "Enc=AESGCM(128)") is stripped and returned in bits if not NULL
+static void get_description_field(const char *description, const char *key, char *value, size_t valueSize, int *bits)
+{
+    const char *fieldStart = strstr(description, key);
+    size_t valueLen = 0;
+
+    value[0] = '\0';
+    if (bits != NULL)
+    {
+        *bits = 0;
+    }
+    if (fieldStart == NULL)
+    {
+        return;
+    }
+
+    fieldStart += strlen(key);
+    while ((fieldStart[valueLen] != '\0') && (fieldStart[valueLen] != ' ') && (fieldStart[valueLen] != '\n')
+            && (fieldStart[valueLen] != '('))
+    {
+        valueLen++;
+    }
+    if (valueLen >= valueSize)
+    {
+        valueLen = valueSize - 1;
+    }
+    memcpy(value, fieldStart, valueLen);
+    value[valueLen] = '\0';
+
+    if ((bits != NULL) && (fieldStart[valueLen] == '('))
+    {
+        *bits = atoi(fieldStart + valueLen + 1);
+    }
+}
+#else
+// The algorithm names used by SSL_CIPHER_description(), so that both builds return the same values
+typedef struct
+{
+    int nid;
+    const char *name;
+} NidName;
+
+static const NidName kxNames[] =
+{
+    {NID_kx_rsa, "RSA"},
+    {NID_kx_dhe, "DH"},
+    {NID_kx_ecdhe, "ECDH"},
+    {NID_kx_psk, "PSK"},
+    {NID_kx_rsa_psk, "RSAPSK"},
+    {NID_kx_ecdhe_psk, "ECDHEPSK"},
+    {NID_kx_dhe_psk, "DHEPSK"},
+    {NID_kx_srp, "SRP"},
+    {NID_kx_gost, "GOST"},
+    {NID_kx_any, "any"},
+    {NID_undef, NULL}
+};
+
+static const NidName authNames[] =
+{
+    {NID_auth_rsa, "RSA"},
+    {NID_auth_dss, "DSS"},
+    {NID_auth_null, "None"},
+    {NID_auth_ecdsa, "ECDSA"},
+    {NID_auth_psk, "PSK"},
+    {NID_auth_srp, "SRP"},
+    {NID_auth_gost01, "GOST01"},
+    {NID_auth_gost12, "GOST01"},
+    {NID_auth_any, "any"},
+    {NID_undef, NULL}
+};
+
+// CCM8 cipher suites have the same NID as CCM ones and are told apart by their name
+static const NidName encNames[] =
+{
+    {NID_des_cbc, "DES"},
+    {NID_des_ede3_cbc, "3DES"},
+    {NID_rc4, "RC4"},
+    {NID_rc2_cbc, "RC2"},
+    {NID_idea_cbc, "IDEA"},
+    {NID_undef, "None"},
+    {NID_aes_128_cbc, "AES"},
+    {NID_aes_256_cbc, "AES"},
+    {NID_aes_128_gcm, "AESGCM"},
+    {NID_aes_256_gcm, "AESGCM"},
+    {NID_aes_128_ccm, "AESCCM"},
+    {NID_aes_256_ccm, "AESCCM"},
+    {NID_camellia_128_cbc, "Camellia"},
+    {NID_camellia_256_cbc, "Camellia"},
+    {NID_gost89_cnt, "GOST89"},
+    {NID_gost89_cnt_12, "GOST89"},
+    {NID_seed_cbc, "SEED"},
+    {NID_aria_128_gcm, "ARIAGCM"},
+    {NID_aria_256_gcm, "ARIAGCM"},
+    {NID_chacha20_poly1305, "CHACHA20/POLY1305"},
+    {NID_undef, NULL}
+};
+
+// AEAD cipher suites have no digest NID
+static const NidName macNames[] =
+{
+    {NID_md5, "MD5"},
+    {NID_sha1, "SHA1"},
+    {NID_sha256, "SHA256"},
+    {NID_sha384, "SHA384"},
+    {NID_id_Gost28147_89_MAC, "GOST89"},
+    {NID_id_GostR3411_94, "GOST94"},
+    {NID_gost_mac_12, "GOST89"},
+    {NID_id_GostR3411_2012_256, "GOST2012"},
+    {NID_undef, NULL}
+};
+
+
+// Returns the name of the algorithm with the given NID, or its OpenSSL short name if it is not in the table
+static const char* get_nid_name(const NidName *nidNames, int nid)
+{
+    const char *shortName = NULL;
+    int i = 0;
+
+    for (i = 0; nidNames[i].name != NULL; i++)
+    {
+        if (nidNames[i].nid == nid)
+        {
+            return nidNames[i].name;
+        }
+    }
+    shortName = OBJ_nid2sn(nid);
+    return (shortName != NULL) ? shortName : "unknown";
+}
+#endif
+
+
+static PyObject* create_cipher_info(const SSL_CIPHER *cipher)
+{
+    PyObject *cipherInfo = NULL;
+    char description[128];
+    const char *kx = NULL, *auth = NULL, *enc = NULL, *mac = NULL;
+    int encBits = 0, isExport = 0;
+    unsigned long cipherId = SSL_CIPHER_get_id(cipher);
+#ifdef LEGACY_OPENSSL
+    char kxBuffer[32], authBuffer[32], encBuffer[32], macBuffer[32];
+#endif
+
+    SSL_CIPHER_description(cipher, description, sizeof(description));
+#ifdef LEGACY_OPENSSL
+    // The legacy API has no accessors for the algorithms of a cipher suite
+    get_description_field(description, "Kx=", kxBuffer, sizeof(kxBuffer), NULL);
+    get_description_field(description, "Au=", authBuffer, sizeof(authBuffer), NULL);
+    get_description_field(description, "Enc=", encBuffer, sizeof(encBuffer), &encBits);
+    get_description_field(description, "Mac=", macBuffer, sizeof(macBuffer), NULL);
+    kx = kxBuffer;
+    auth = authBuffer;
+    enc = encBuffer;
+    mac = macBuffer;
+    isExport = (strstr(description, " export") != NULL);
+#else
+    kx = get_nid_name(kxNames, SSL_CIPHER_get_kx_nid(cipher));
+    auth = get_nid_name(authNames, SSL_CIPHER_get_auth_nid(cipher));
+    enc = get_nid_name(encNames, SSL_CIPHER_get_cipher_nid(cipher));
+    if ((strstr(SSL_CIPHER_get_name(cipher), "CCM8") != NULL)
+            || (strstr(SSL_CIPHER_get_name(cipher), "CCM_8") != NULL))
+    {
+        enc = "AESCCM8";
+    }
+    mac = SSL_CIPHER_is_aead(cipher) ? "AEAD" : get_nid_name(macNames, SSL_CIPHER_get_digest_nid(cipher));
+    SSL_CIPHER_get_bits(cipher, &encBits);
+    // Export cipher suites were removed from OpenSSL 1.1.0
+    isExport = 0;
+#endif
+
+    cipherInfo = PyStructSequence_New(&nassl_CipherInfo_Type);
+    if (cipherInfo == NULL)
+    {
+        return NULL;
+    }
+
+    // SSL 2.0 cipher specs have 3-byte identifiers (0x02XXXXXX), SSL 3.0 and TLS cipher suites have 2-byte
+    // identifiers (0x0300XXXX)
+    PyStructSequence_SET_ITEM(cipherInfo, 0, PyUnicode_FromString(SSL_CIPHER_get_name(cipher)));
+    PyStructSequence_SET_ITEM(cipherInfo, 1, PyLong_FromUnsignedLong(
+            ((cipherId & 0xFF000000) == 0x02000000) ? cipherId & 0x00FFFFFF : cipherId & 0x0000FFFF));
+    PyStructSequence_SET_ITEM(cipherInfo, 2, PyLong_FromUnsignedLong(
+            get_min_version_from_string(SSL_CIPHER_get_version(cipher))));
+    PyStructSequence_SET_ITEM(cipherInfo, 3, PyUnicode_FromString(kx));
+    PyStructSequence_SET_ITEM(cipherInfo, 4, PyUnicode_FromString(auth));
+    PyStructSequence_SET_ITEM(cipherInfo, 5, PyUnicode_FromString(enc));
+    PyStructSequence_SET_ITEM(cipherInfo, 6, PyLong_FromLong(encBits));
+    PyStructSequence_SET_ITEM(cipherInfo, 7, PyUnicode_FromString(mac));
+    PyStructSequence_SET_ITEM(cipherInfo, 8, PyBool_FromLong(isExport));
+    PyStructSequence_SET_ITEM(cipherInfo, CIPHER_INFO_DESCRIPTION_INDEX, PyUnicode_FromString(description));
+    if (PyErr_Occurred())
+    {
+        Py_DECREF(cipherInfo);
+        return NULL;
+    }
+    return cipherInfo;
+}
+
+
+// Fills the two dictionaries with all the ciphers supported by OpenSSL
+static int build_cipher_table(void)
+{
+    SSL_CTX *sslCtx = NULL;
+    SSL *ssl = NULL;
+    STACK_OF(SSL_CIPHER) *ciphers = NULL;
+    int i = 0, isSuccessful = 0;
+
+    sslCtx = SSL_CTX_new(SSLv23_method());
+    if (sslCtx == NULL)
+    {
+        raise_OpenSSL_error();
+        return 0;
+    }
+    ssl = SSL_new(sslCtx);
+    if (ssl == NULL)
+    {
+        raise_OpenSSL_error();
+        SSL_CTX_free(sslCtx);
+        return 0;
+    }
+    SSL_set_cipher_list(ssl, "ALL:COMPLEMENTOFALL");
+
+    ciphersByName = PyDict_New();
+    ciphersById = PyDict_New();
+    if ((ciphersByName == NULL) || (ciphersById == NULL))
+    {
+        goto cleanup;
+    }
+
+    ciphers = SSL_get_ciphers(ssl);
+    for (i = 0; i < sk_SSL_CIPHER_num(ciphers); i++)
+    {
+        PyObject *cipherInfo = create_cipher_info(sk_SSL_CIPHER_value(ciphers, i));
+        if (cipherInfo == NULL)
+        {
+            goto cleanup;
+        }
+        if ((PyDict_SetItem(ciphersByName, PyStructSequence_GET_ITEM(cipherInfo, 0), cipherInfo) == -1)
+                || (PyDict_SetItem(ciphersById, PyStructSequence_GET_ITEM(cipherInfo, 1), cipherInfo) == -1))
+        {
+            Py_DECREF(cipherInfo);
+            goto cleanup;
+        }
+        Py_DECREF(cipherInfo);
+    }
+    isSuccessful = 1;
+
+cleanup:
+    if (!isSuccessful)
+    {
+        Py_CLEAR(ciphersByName);
+        Py_CLEAR(ciphersById);
+    }
+    SSL_free(ssl);
+    SSL_CTX_free(sslCtx);
+    return isSuccessful;
+}
+
+
+PyObject* get_cipher_info_by_name(const char *cipherName)
+{
+    if (ciphersByName == NULL)
+    {
+        return NULL;
+    }
+    return PyDict_GetItemString(ciphersByName, cipherName);
+}
+
+
+int module_add_cipher_table(PyObject* m)
+{
+    PyObject *ciphersByNameProxy = NULL, *ciphersByIdProxy = NULL;
+
+#if PY_MAJOR_VERSION >= 3
+    if (PyStructSequence_InitType2(&nassl_CipherInfo_Type, &nassl_CipherInfo_desc) == -1)
+    {
+        return 0;
+    }
+#else
+    PyStructSequence_InitType(&nassl_CipherInfo_Type, &nassl_CipherInfo_desc);
+#endif
+    if (!build_cipher_table())
+    {
+        return 0;
+    }
+
+    ciphersByNameProxy = PyDictProxy_New(ciphersByName);
+    ciphersByIdProxy = PyDictProxy_New(ciphersById);
+    if ((ciphersByNameProxy == NULL) || (ciphersByIdProxy == NULL))
+    {
+        Py_XDECREF(ciphersByNameProxy);
+        Py_XDECREF(ciphersByIdProxy);
+        return 0;
+    }
+
+    Py_INCREF(&nassl_CipherInfo_Type);
+    PyModule_AddObject(m, "CipherInfo", (PyObject *)&nassl_CipherInfo_Type);
+    PyModule_AddObject(m, "CIPHERS_BY_NAME", ciphersByNameProxy);
+    PyModule_AddObject(m, "CIPHERS_BY_ID", ciphersByIdProxy);
+    return 1;
+}
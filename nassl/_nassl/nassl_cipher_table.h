@@ -0,0 +1,14 @@
+#pragma once
+
+#include <Python.h>
+
+// Table of all the cipher suites compiled into OpenSSL, built once when the module gets imported and exposed as the
+// CIPHERS_BY_NAME and CIPHERS_BY_ID read-only dictionaries of CipherInfo objects
+
+// Returns a borrowed reference to the CipherInfo for the given OpenSSL cipher name, or NULL if there is none
+PyObject* get_cipher_info_by_name(const char *cipherName);
+
+// Index of the SSL_CIPHER_description() output within a CipherInfo
+#define CIPHER_INFO_DESCRIPTION_INDEX 9
+
+int module_add_cipher_table(PyObject* m);
@@ -142,6 +142,36 @@ PyObject* raise_OpenSSL_ssl_error(SSL *ssl, int returnValue)
 }
 
 
+PyObject* raise_socket_error(int socketError)
+{
+    if (socketError == 0)
+    {
+        PyObject *socketModule = NULL, *timeoutException = NULL;
+        socketModule = PyImport_ImportModule("socket");
+        if (socketModule == NULL)
+        {
+            return NULL;
+        }
+        timeoutException = PyObject_GetAttrString(socketModule, "timeout");
+        Py_DECREF(socketModule);
+        if (timeoutException == NULL)
+        {
+            return NULL;
+        }
+        PyErr_SetString(timeoutException, "timed out");
+        Py_DECREF(timeoutException);
+        return NULL;
+    }
+
+#ifdef _WIN32
+    return PyErr_SetExcFromWindowsErr(PyExc_IOError, socketError);
+#else
+    errno = socketError;
+    return PyErr_SetFromErrno(PyExc_IOError);
+#endif
+}
+
+
 int module_add_errors(PyObject* m)
 {
 // We want both the modern and legacy nassl to use the same exceptions
@@ -7,4 +7,7 @@ extern PyObject *nassl_OpenSSLError_Exception; // Needed by nassl_X509.c
 
 PyObject* raise_OpenSSL_error(void);
 PyObject* raise_OpenSSL_ssl_error(SSL *ssl, int returnValue);
+
+// Raises socket.timeout if socketError is 0, or the OSError for the socket error code (errno or WSAGetLastError())
+PyObject* raise_socket_error(int socketError);
 int module_add_errors(PyObject* m);
@@ -0,0 +1,362 @@
+#include <Python.h>
+
+#include <openssl/rand.h>
+
+#include "nassl_errors.h"
+#include "nassl_tls_codec.h"
+#include "socket_utils.h"
+#include "tls_codec.h"
+
+
+// Enough for a ServerHello spread over a couple of records
+#define SERVER_RESPONSE_BUFFER_SIZE (2 * (TLS_RECORD_HEADER_SIZE + TLS_MAX_RECORD_PAYLOAD_SIZE))
+
+
+// Converts a sequence of integers to an array of values; the array must be freed with PyMem_Free()
+static int parse_integer_list(PyObject *pyList, unsigned int maxValue, unsigned int **values, size_t *valuesCount)
+{
+    PyObject *pyTuple = NULL;
+    Py_ssize_t i = 0;
+
+    *values = NULL;
+    *valuesCount = 0;
+    if (pyList == Py_None)
+    {
+        return 1;
+    }
+
+    pyTuple = PySequence_Tuple(pyList);
+    if (pyTuple == NULL)
+    {
+        return 0;
+    }
+
+    *values = (unsigned int *) PyMem_Malloc(sizeof(unsigned int) * (PyTuple_GET_SIZE(pyTuple) + 1));
+    if (*values == NULL)
+    {
+        Py_DECREF(pyTuple);
+        PyErr_NoMemory();
+        return 0;
+    }
+
+    for (i = 0; i < PyTuple_GET_SIZE(pyTuple); i++)
+    {
+        unsigned long value = PyLong_AsUnsignedLong(PyTuple_GET_ITEM(pyTuple, i));
+        if (PyErr_Occurred())
+        {
+            break;
+        }
+        if (value > maxValue)
+        {
+            PyErr_Format(PyExc_ValueError, "Value 0x%lx is too large", value);
+            break;
+        }
+        (*values)[i] = (unsigned int) value;
+    }
+    Py_DECREF(pyTuple);
+
+    if (PyErr_Occurred())
+    {
+        PyMem_Free(*values);
+        *values = NULL;
+        return 0;
+    }
+    *valuesCount = i;
+    return 1;
+}
+
+
+static PyObject* server_response_to_tuple(TlsServerResponse *response)
+{
+    PyObject *extensionsPyList = NULL;
+    unsigned int i = 0;
+
+    extensionsPyList = PyList_New(response->extensionsCount);
+    if (extensionsPyList == NULL)
+    {
+        return NULL;
+    }
+    for (i = 0; i < response->extensionsCount; i++)
+    {
+        PyObject *extensionPyInt = PyLong_FromLong(response->extensions[i]);
+        if (extensionPyInt == NULL)
+        {
+            Py_DECREF(extensionsPyList);
+            return NULL;
+        }
+        PyList_SET_ITEM(extensionsPyList, i, extensionPyInt);
+    }
+
+    return Py_BuildValue("(iIIBNIBB)", response->messageType, response->version, response->cipherId,
+                         response->compressionMethod, extensionsPyList, response->selectedGroup,
+                         response->alertLevel, response->alertDescription);
+}
+
+
+static PyObject* nassl_build_client_hello(PyObject *self, PyObject *args)
+{
+    unsigned short recordVersion = 0, clientVersion = 0;
+    PyObject *cipherIdsPyList = NULL, *supportedVersionsPyList = NULL, *groupsPyList = NULL, *sigAlgsPyList = NULL;
+    char *serverName = NULL, *extraExtensions = NULL, *random = NULL;
+    int extraExtensionsSize = 0, randomSize = 0;
+    unsigned int *cipherIds = NULL, *supportedVersions = NULL, *groups = NULL, *sigAlgs = NULL;
+    unsigned char randomBuffer[TLS_RANDOM_SIZE];
+    unsigned char *clientHello = NULL;
+    size_t clientHelloMaxSize = 0, clientHelloSize = 0;
+    TlsClientHelloParams params;
+    PyObject *clientHelloPyBytes = NULL;
+
+    if (!PyArg_ParseTuple(args, "HHOzOOOz#z#", &recordVersion, &clientVersion, &cipherIdsPyList, &serverName,
+                          &supportedVersionsPyList, &groupsPyList, &sigAlgsPyList, &extraExtensions,
+                          &extraExtensionsSize, &random, &randomSize))
+    {
+        return NULL;
+    }
+
+    if (random == NULL)
+    {
+        if (RAND_bytes(randomBuffer, TLS_RANDOM_SIZE) != 1)
+        {
+            return raise_OpenSSL_error();
+        }
+    }
+    else if (randomSize != TLS_RANDOM_SIZE)
+    {
+        PyErr_SetString(PyExc_ValueError, "The random must be 32 bytes long");
+        return NULL;
+    }
+    else
+    {
+        memcpy(randomBuffer, random, TLS_RANDOM_SIZE);
+    }
+
+    memset(&params, 0, sizeof(TlsClientHelloParams));
+    if (!parse_integer_list(cipherIdsPyList, 0xFFFF, &cipherIds, &params.cipherIdsCount)
+            || !parse_integer_list(supportedVersionsPyList, 0xFFFF, &supportedVersions, &params.supportedVersionsCount)
+            || !parse_integer_list(groupsPyList, 0xFFFF, &groups, &params.groupsCount)
+            || !parse_integer_list(sigAlgsPyList, 0xFFFF, &sigAlgs, &params.signatureAlgorithmsCount))
+    {
+        goto cleanup;
+    }
+    params.recordVersion = recordVersion;
+    params.clientVersion = clientVersion;
+    params.random = randomBuffer;
+    params.cipherIds = cipherIds;
+    params.serverName = serverName;
+    params.supportedVersions = supportedVersions;
+    params.groups = groups;
+    params.signatureAlgorithms = sigAlgs;
+    params.extraExtensions = (unsigned char *) extraExtensions;
+    params.extraExtensionsSize = extraExtensionsSize;
+
+    clientHelloMaxSize = tls_get_client_hello_max_size(&params);
+    clientHello = (unsigned char *) PyMem_Malloc(clientHelloMaxSize);
+    if (clientHello == NULL)
+    {
+        PyErr_NoMemory();
+        goto cleanup;
+    }
+
+    clientHelloSize = tls_build_client_hello(&params, clientHello, clientHelloMaxSize);
+    if (clientHelloSize == 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "Too many values to fit in the ClientHello");
+        goto cleanup;
+    }
+    clientHelloPyBytes = PyBytes_FromStringAndSize((char *) clientHello, clientHelloSize);
+
+cleanup:
+    PyMem_Free(clientHello);
+    PyMem_Free(cipherIds);
+    PyMem_Free(supportedVersions);
+    PyMem_Free(groups);
+    PyMem_Free(sigAlgs);
+    return clientHelloPyBytes;
+}
+
+
+static PyObject* nassl_build_ssl2_client_hello(PyObject *self, PyObject *args)
+{
+    PyObject *cipherSpecsPyList = NULL, *clientHelloPyBytes = NULL;
+    char *challenge = NULL;
+    int challengeSize = 0;
+    unsigned int *cipherSpecs = NULL;
+    size_t cipherSpecsCount = 0, clientHelloSize = 0;
+    unsigned char challengeBuffer[SSL2_CHALLENGE_SIZE];
+    unsigned char *clientHello = NULL;
+
+    if (!PyArg_ParseTuple(args, "Oz#", &cipherSpecsPyList, &challenge, &challengeSize))
+    {
+        return NULL;
+    }
+
+    if (challenge == NULL)
+    {
+        if (RAND_bytes(challengeBuffer, SSL2_CHALLENGE_SIZE) != 1)
+        {
+            return raise_OpenSSL_error();
+        }
+    }
+    else if (challengeSize != SSL2_CHALLENGE_SIZE)
+    {
+        PyErr_SetString(PyExc_ValueError, "The challenge must be 16 bytes long");
+        return NULL;
+    }
+    else
+    {
+        memcpy(challengeBuffer, challenge, SSL2_CHALLENGE_SIZE);
+    }
+
+    if (!parse_integer_list(cipherSpecsPyList, 0xFFFFFF, &cipherSpecs, &cipherSpecsCount))
+    {
+        return NULL;
+    }
+
+    clientHello = (unsigned char *) PyMem_Malloc(11 + 3 * cipherSpecsCount + SSL2_CHALLENGE_SIZE);
+    if (clientHello == NULL)
+    {
+        PyMem_Free(cipherSpecs);
+        return PyErr_NoMemory();
+    }
+
+    clientHelloSize = tls_build_ssl2_client_hello(cipherSpecs, cipherSpecsCount, challengeBuffer, clientHello,
+                                                  11 + 3 * cipherSpecsCount + SSL2_CHALLENGE_SIZE);
+    if (clientHelloSize == 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "Too many cipher specs to fit in the ClientHello");
+    }
+    else
+    {
+        clientHelloPyBytes = PyBytes_FromStringAndSize((char *) clientHello, clientHelloSize);
+    }
+    PyMem_Free(clientHello);
+    PyMem_Free(cipherSpecs);
+    return clientHelloPyBytes;
+}
+
+
+static PyObject* nassl_parse_server_records(PyObject *self, PyObject *args)
+{
+    char *data = NULL;
+    int dataSize = 0, result = 0;
+    TlsServerResponse response;
+
+    if (!PyArg_ParseTuple(args, "s#", &data, &dataSize))
+    {
+        return NULL;
+    }
+
+    result = tls_parse_server_records((unsigned char *) data, dataSize, &response);
+    if (result < 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "Received data is not a ServerHello or an alert");
+        return NULL;
+    }
+    else if (result == 0)
+    {
+        // Need more data
+        Py_RETURN_NONE;
+    }
+    return server_response_to_tuple(&response);
+}
+
+
+static PyObject* nassl_probe_server_raw(PyObject *self, PyObject *args)
+{
+    char *hostname = NULL, *clientHello = NULL;
+    unsigned short port = 0;
+    int clientHelloSize = 0, receivedSize = 0, result = 0, isConnected = 1;
+    double timeout = 5.0;
+    char errorBuf[256];
+    unsigned char *responseBuffer = NULL;
+    TlsServerResponse response;
+    nassl_socket_t sock;
+
+    if (!PyArg_ParseTuple(args, "sHs#|d", &hostname, &port, &clientHello, &clientHelloSize, &timeout))
+    {
+        return NULL;
+    }
+
+    responseBuffer = (unsigned char *) PyMem_Malloc(SERVER_RESPONSE_BUFFER_SIZE);
+    if (responseBuffer == NULL)
+    {
+        return PyErr_NoMemory();
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    sock = socket_connect(hostname, port, (int) (timeout * 1000), errorBuf, sizeof(errorBuf));
+    if (sock == NASSL_INVALID_SOCKET)
+    {
+        isConnected = 0;
+    }
+    else
+    {
+        if (socket_send_all(sock, clientHello, clientHelloSize, (int) (timeout * 1000)))
+        {
+            while ((result == 0) && (receivedSize < SERVER_RESPONSE_BUFFER_SIZE))
+            {
+                int recvSize = socket_recv(sock, (char *) responseBuffer + receivedSize,
+                                           SERVER_RESPONSE_BUFFER_SIZE - receivedSize, (int) (timeout * 1000));
+                if (recvSize <= 0)
+                {
+                    break;
+                }
+                receivedSize += recvSize;
+                result = tls_parse_server_records(responseBuffer, receivedSize, &response);
+            }
+        }
+        socket_close(sock);
+    }
+    Py_END_ALLOW_THREADS
+
+    PyMem_Free(responseBuffer);
+    if (!isConnected)
+    {
+        PyErr_SetString(PyExc_IOError, errorBuf);
+        return NULL;
+    }
+    if (result < 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "Received data is not a ServerHello or an alert");
+        return NULL;
+    }
+    else if (result == 0)
+    {
+        // The server closed the connection or timed out without replying
+        Py_RETURN_NONE;
+    }
+    return server_response_to_tuple(&response);
+}
+
+
+static PyMethodDef nassl_tls_codec_methods[] =
+{
+    {"build_client_hello", (PyCFunction)nassl_build_client_hello, METH_VARARGS,
+     "Build the records of a TLS or SSL 3.0 ClientHello from (record_version, client_version, cipher_ids, server_name, supported_versions, groups, signature_algorithms, extra_extensions, random); the arguments after cipher_ids can be None."
+    },
+    {"build_ssl2_client_hello", (PyCFunction)nassl_build_ssl2_client_hello, METH_VARARGS,
+     "Build an SSL 2.0 ClientHello record from (cipher_specs, challenge); challenge can be None."
+    },
+    {"parse_server_records", (PyCFunction)nassl_parse_server_records, METH_VARARGS,
+     "Parse the server's first ServerHello, HelloRetryRequest or alert from the records received so far. Return None if more data is needed, or a tuple of (message_type, version, cipher_id, compression_method, extensions, selected_group, alert_level, alert_description)."
+    },
+    {"probe_server_raw", (PyCFunction)nassl_probe_server_raw, METH_VARARGS,
+     "Connect to (hostname, port), send the supplied ClientHello and return the server's response as parsed by parse_server_records(), or None if the server did not reply. Runs without holding the GIL."
+    },
+    {NULL}  // Sentinel
+};
+
+
+void module_add_tls_codec(PyObject* m)
+{
+    PyMethodDef *methodDef = NULL;
+    for (methodDef = nassl_tls_codec_methods; methodDef->ml_name != NULL; methodDef++)
+    {
+        PyObject *function = PyCFunction_New(methodDef, NULL);
+        if (function == NULL)
+        {
+            return;
+        }
+        PyModule_AddObject(m, methodDef->ml_name, function);
+    }
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// Module-level functions exposing the native TLS codec (ClientHello builder and server response parser)
+void module_add_tls_codec(PyObject* m);
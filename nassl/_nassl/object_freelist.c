@@ -0,0 +1,33 @@
+#include <Python.h>
+
+#include <string.h>
+
+#include "object_freelist.h"
+
+
+PyObject* object_freelist_alloc(ObjectFreeList *freeList)
+{
+    PyObject *object = NULL;
+    PyTypeObject *type = freeList->type;
+
+    if (freeList->count == 0)
+    {
+        return type->tp_alloc(type, 0);
+    }
+
+    object = freeList->objects[--freeList->count];
+    // Same state as a new object returned by PyType_GenericAlloc()
+    memset((char *) object + sizeof(PyObject), 0, type->tp_basicsize - sizeof(PyObject));
+    return PyObject_INIT(object, type);
+}
+
+
+void object_freelist_free(ObjectFreeList *freeList, PyObject *object)
+{
+    if ((Py_TYPE(object) == freeList->type) && (freeList->count < freeList->capacity))
+    {
+        freeList->objects[freeList->count++] = object;
+        return;
+    }
+    Py_TYPE(object)->tp_free(object);
+}
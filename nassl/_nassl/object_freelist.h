@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Python.h>
+
+// Free list of deallocated objects of a given type, so that the short-lived and high-volume wrapper objects
+// (X509, X509_EXTENSION, etc.) get recycled instead of going through the allocator; same idea as CPython's free lists
+// for floats and tuples. Only objects of the exact type are recycled, not instances of subclasses.
+// Must only be used while holding the GIL.
+typedef struct {
+    PyTypeObject *type;
+    PyObject **objects;
+    int count;
+    int capacity;
+} ObjectFreeList;
+
+#define OBJECT_FREELIST_CAPACITY 128
+
+// Declares a static free list for the given type
+#define DEFINE_OBJECT_FREELIST(name, pyType) \
+    static PyObject *name##Objects[OBJECT_FREELIST_CAPACITY]; \
+    static ObjectFreeList name = {&pyType, name##Objects, 0, OBJECT_FREELIST_CAPACITY}
+
+// Returns a new zero-initialized object of the free list's type, or NULL with an exception set
+PyObject* object_freelist_alloc(ObjectFreeList *freeList);
+
+// To be called by the type's tp_dealloc instead of tp_free, once the object's fields have been released
+void object_freelist_free(ObjectFreeList *freeList, PyObject *object);
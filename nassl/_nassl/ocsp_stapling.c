@@ -0,0 +1,222 @@
+#include <Python.h>
+
+// Fix symbol clashing on Windows
+// https://bugs.launchpad.net/pyopenssl/+bug/570101
+#ifdef _WIN32
+#include "winsock.h"
+#endif
+
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/err.h>
+#include <openssl/ocsp.h>
+#include <openssl/x509v3.h>
+
+#include "ocsp_stapling.h"
+
+
+#ifdef LEGACY_OPENSSL
+#define ASN1_STRING_get0_data(asn1String) ASN1_STRING_data((ASN1_STRING *) (asn1String))
+#define OCSP_SINGLERESP_get0_id(singleResp) ((singleResp)->certId)
+#endif
+
+// Allowed clock skew when checking the validity of the leaf's status, in seconds; same as the OCSP command line tool
+#define OCSP_VALIDITY_LEEWAY 300
+
+
+static int get_tls_feature_extension_index(X509 *certificate)
+{
+#ifdef NID_tlsfeature
+    return X509_get_ext_by_NID(certificate, NID_tlsfeature, -1);
+#else
+    // Not known to the legacy OpenSSL
+    int extensionIndex = -1;
+    ASN1_OBJECT *tlsFeatureObject = OBJ_txt2obj("1.3.6.1.5.5.7.1.24", 1);
+    if (tlsFeatureObject == NULL)
+    {
+        ERR_clear_error();
+        return -1;
+    }
+    extensionIndex = X509_get_ext_by_OBJ(certificate, tlsFeatureObject, -1);
+    ASN1_OBJECT_free(tlsFeatureObject);
+    return extensionIndex;
+#endif
+}
+
+
+int ocsp_stapling_is_must_staple(X509 *certificate)
+{
+    ASN1_OCTET_STRING *extensionData = NULL;
+    ASN1_SEQUENCE_ANY *features = NULL;
+    const unsigned char *derFeatures = NULL;
+    int extensionIndex = 0, isMustStaple = 0, i = 0;
+
+    extensionIndex = get_tls_feature_extension_index(certificate);
+    if (extensionIndex < 0)
+    {
+        return 0;
+    }
+
+    // The extension is a SEQUENCE of the INTEGER types of the TLS extensions the server must send
+    extensionData = X509_EXTENSION_get_data(X509_get_ext(certificate, extensionIndex));
+    derFeatures = ASN1_STRING_get0_data(extensionData);
+    features = d2i_ASN1_SEQUENCE_ANY(NULL, &derFeatures, ASN1_STRING_length(extensionData));
+    if (features == NULL)
+    {
+        ERR_clear_error();
+        return 1;
+    }
+    for (i = 0; i < sk_ASN1_TYPE_num(features); i++)
+    {
+        ASN1_TYPE *feature = sk_ASN1_TYPE_value(features, i);
+        // Same as a malformed extension for features that are not INTEGERs
+        if ((feature->type != V_ASN1_INTEGER) || (ASN1_INTEGER_get(feature->value.integer) == TLSEXT_TYPE_status_request))
+        {
+            isMustStaple = 1;
+            break;
+        }
+    }
+    sk_ASN1_TYPE_pop_free(features, ASN1_TYPE_free);
+    return isMustStaple;
+}
+
+
+static X509* find_issuer(X509 *leaf, STACK_OF(X509) *peerChain)
+{
+    int i = 0;
+    for (i = 0; i < sk_X509_num(peerChain); i++)
+    {
+        X509 *candidate = sk_X509_value(peerChain, i);
+        if (X509_check_issued(candidate, leaf) == X509_V_OK)
+        {
+            return candidate;
+        }
+    }
+    return NULL;
+}
+
+
+// Looks for the leaf's single response; each response may use a different digest for the cert ID
+static void find_leaf_status(OCSP_BASICRESP *basicResp, X509 *leaf, X509 *issuer, OcspStaplingVerdict *verdictOut)
+{
+    int i = 0;
+    for (i = 0; i < OCSP_resp_count(basicResp); i++)
+    {
+        OCSP_SINGLERESP *singleResp = OCSP_resp_get0(basicResp, i);
+        OCSP_CERTID *responseCertId = (OCSP_CERTID *) OCSP_SINGLERESP_get0_id(singleResp);
+        OCSP_CERTID *leafCertId = NULL;
+        ASN1_OBJECT *digestObject = NULL;
+        ASN1_GENERALIZEDTIME *thisUpdate = NULL, *nextUpdate = NULL;
+        const EVP_MD *digest = NULL;
+        int isMatch = 0, reason = 0;
+
+        if (!OCSP_id_get0_info(NULL, &digestObject, NULL, NULL, responseCertId))
+        {
+            continue;
+        }
+        digest = EVP_get_digestbyobj(digestObject);
+        if (digest == NULL)
+        {
+            continue;
+        }
+        leafCertId = OCSP_cert_to_id(digest, leaf, issuer);
+        if (leafCertId == NULL)
+        {
+            continue;
+        }
+        isMatch = (OCSP_id_cmp(leafCertId, responseCertId) == 0);
+        OCSP_CERTID_free(leafCertId);
+        if (!isMatch)
+        {
+            continue;
+        }
+
+        verdictOut->certificateStatus = OCSP_single_get0_status(singleResp, &reason, NULL, &thisUpdate, &nextUpdate);
+        verdictOut->isResponseCurrent = (OCSP_check_validity(thisUpdate, nextUpdate, OCSP_VALIDITY_LEEWAY, -1) == 1);
+        return;
+    }
+}
+
+
+void ocsp_stapling_find_certificate_status(OCSP_RESPONSE *ocspResp, X509 *leaf, X509 *issuer,
+                                           OcspStaplingVerdict *verdictOut)
+{
+    OCSP_BASICRESP *basicResp = NULL;
+
+    verdictOut->responseStatus = OCSP_response_status(ocspResp);
+    verdictOut->certificateStatus = -1;
+    verdictOut->isResponseCurrent = 0;
+    verdictOut->isSignatureValid = 0;
+    if ((verdictOut->responseStatus != OCSP_RESPONSE_STATUS_SUCCESSFUL) || (issuer == NULL))
+    {
+        return;
+    }
+
+    basicResp = OCSP_response_get1_basic(ocspResp);
+    if (basicResp != NULL)
+    {
+        find_leaf_status(basicResp, leaf, issuer, verdictOut);
+        OCSP_BASICRESP_free(basicResp);
+    }
+    // The verdict does not depend on OpenSSL's error queue
+    ERR_clear_error();
+}
+
+
+// The signer of the response has to be the leaf's issuer or a responder it delegated to, and to chain to the trust
+// store; the server's chain is used to find the signer if the response does not include it
+static int is_response_signature_valid(OCSP_RESPONSE *ocspResp, STACK_OF(X509) *peerChain, X509_STORE *trustStore)
+{
+    OCSP_BASICRESP *basicResp = NULL;
+    int isValid = 0;
+
+    if ((OCSP_response_status(ocspResp) != OCSP_RESPONSE_STATUS_SUCCESSFUL) || (trustStore == NULL))
+    {
+        return 0;
+    }
+    basicResp = OCSP_response_get1_basic(ocspResp);
+    if (basicResp != NULL)
+    {
+        isValid = (OCSP_basic_verify(basicResp, peerChain, trustStore, 0) == 1);
+        OCSP_BASICRESP_free(basicResp);
+    }
+    return isValid;
+}
+
+
+int ocsp_stapling_get_verdict(SSL *ssl, OcspStaplingVerdict *verdictOut)
+{
+    const unsigned char *derResponse = NULL;
+    long derResponseSize = 0;
+    OCSP_RESPONSE *ocspResp = NULL;
+    X509 *leaf = NULL;
+
+    memset(verdictOut, 0, sizeof(OcspStaplingVerdict));
+    verdictOut->responseStatus = -1;
+    verdictOut->certificateStatus = -1;
+
+    leaf = SSL_get_peer_certificate(ssl);
+    if (leaf == NULL)
+    {
+        return 0;
+    }
+    verdictOut->isMustStaple = ocsp_stapling_is_must_staple(leaf);
+
+    derResponseSize = SSL_get_tlsext_status_ocsp_resp(ssl, &derResponse);
+    if ((derResponse != NULL) && (derResponseSize > 0))
+    {
+        verdictOut->isResponseStapled = 1;
+        ocspResp = d2i_OCSP_RESPONSE(NULL, &derResponse, derResponseSize);
+        if (ocspResp != NULL)
+        {
+            STACK_OF(X509) *peerChain = SSL_get_peer_cert_chain(ssl);
+            ocsp_stapling_find_certificate_status(ocspResp, leaf, find_issuer(leaf, peerChain), verdictOut);
+            verdictOut->isSignatureValid = is_response_signature_valid(
+                    ocspResp, peerChain, SSL_CTX_get_cert_store(SSL_get_SSL_CTX(ssl)));
+            OCSP_RESPONSE_free(ocspResp);
+        }
+        ERR_clear_error();
+    }
+    X509_free(leaf);
+    return 1;
+}
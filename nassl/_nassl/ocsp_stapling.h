@@ -0,0 +1,29 @@
+#pragma once
+
+#include <openssl/ssl.h>
+#include <openssl/ocsp.h>
+
+// Outcome of OCSP stapling for a connection, based on the server's leaf certificate and the stapled response
+typedef struct {
+    int isMustStaple; // The leaf has a TLS feature extension requiring status_request (RFC 7633)
+    int isResponseStapled;
+    int responseStatus; // OCSP_RESPONSE_STATUS_XXX, or -1 if no response was stapled or it could not be parsed
+    int certificateStatus; // V_OCSP_CERTSTATUS_XXX, or -1 if the response has no status for the leaf
+    int isResponseCurrent; // The leaf's status is within its thisUpdate / nextUpdate window
+    int isSignatureValid; // The response was signed by the leaf's issuer or its delegated responder, which is trusted
+} OcspStaplingVerdict;
+
+// Returns 1 if the certificate has a TLS feature extension requiring status_request and 0 otherwise; a malformed
+// extension is treated as requiring it
+int ocsp_stapling_is_must_staple(X509 *certificate);
+
+// Sets the response status, and the certificate status of the leaf if the response is successful and contains a cert ID
+// matching the leaf and its issuer, which may be NULL if it is unknown; the cert ID of the leaf is computed with the
+// same digest as each single response
+void ocsp_stapling_find_certificate_status(OCSP_RESPONSE *ocspResp, X509 *leaf, X509 *issuer,
+                                           OcspStaplingVerdict *verdictOut);
+
+// To be called after the handshake; the leaf's issuer is looked up in the peer's chain. The response's signature is
+// verified with OCSP_basic_verify(), using the peer's chain and the trust store of the SSL's SSL_CTX
+// Returns 0 if the peer did not send a certificate
+int ocsp_stapling_get_verdict(SSL *ssl, OcspStaplingVerdict *verdictOut);
@@ -0,0 +1,322 @@
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "socket_utils.h"
+
+
+#ifdef _WIN32
+#define SOCKET_FD_CAST SOCKET
+#define SOCKET_LAST_ERROR WSAGetLastError()
+#define SOCKET_WOULD_BLOCK(err) ((err) == WSAEWOULDBLOCK)
+#define SOCKET_IN_PROGRESS(err) ((err) == WSAEWOULDBLOCK)
+#define SOCKET_INTERRUPTED(err) ((err) == WSAEINTR)
+#else
+#define SOCKET_FD_CAST int
+#define SOCKET_LAST_ERROR errno
+#define SOCKET_WOULD_BLOCK(err) ((err) == EAGAIN || (err) == EWOULDBLOCK)
+#define SOCKET_IN_PROGRESS(err) ((err) == EINPROGRESS)
+#define SOCKET_INTERRUPTED(err) ((err) == EINTR)
+#endif
+
+
+static int set_non_blocking(nassl_socket_t sock)
+{
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket((SOCKET) sock, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (flags == -1)
+    {
+        return 0;
+    }
+    return fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+
+// Wait until the socket is readable (or writable); returns 1 if it is ready, 0 on timeout and -1 on error
+static int wait_for_socket(nassl_socket_t sock, int forWriting, int timeoutMs)
+{
+    int result;
+#ifdef _WIN32
+    fd_set fdSet;
+    struct timeval timeout;
+
+    FD_ZERO(&fdSet);
+    FD_SET((SOCKET) sock, &fdSet);
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_usec = (timeoutMs % 1000) * 1000;
+    if (forWriting)
+    {
+        result = select(0, NULL, &fdSet, NULL, &timeout);
+    }
+    else
+    {
+        result = select(0, &fdSet, NULL, NULL, &timeout);
+    }
+#else
+    // poll() instead of select() as scanners routinely have more than FD_SETSIZE descriptors open
+    struct pollfd pollFd;
+    pollFd.fd = sock;
+    pollFd.events = forWriting ? POLLOUT : POLLIN;
+    pollFd.revents = 0;
+    do
+    {
+        result = poll(&pollFd, 1, timeoutMs);
+    } while ((result < 0) && SOCKET_INTERRUPTED(SOCKET_LAST_ERROR));
+#endif
+    if (result < 0)
+    {
+        return -1;
+    }
+    return result > 0;
+}
+
+
+nassl_socket_t socket_connect(const char *hostname, unsigned short port, int timeoutMs, char *errorBuf, size_t errorBufSize)
+{
+    struct addrinfo hints, *addrList = NULL, *addr = NULL;
+    char portStr[8];
+    nassl_socket_t sock = NASSL_INVALID_SOCKET;
+    int result;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(portStr, sizeof(portStr), "%u", port);
+
+    result = getaddrinfo(hostname, portStr, &hints, &addrList);
+    if (result != 0)
+    {
+        snprintf(errorBuf, errorBufSize, "Could not resolve %s: %s", hostname, gai_strerror(result));
+        return NASSL_INVALID_SOCKET;
+    }
+
+    snprintf(errorBuf, errorBufSize, "Could not connect to %s:%u", hostname, port);
+    for (addr = addrList; addr != NULL; addr = addr->ai_next)
+    {
+        int connectError = 0;
+        socklen_t connectErrorLen = sizeof(connectError);
+
+        sock = (nassl_socket_t) socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+        if (sock == NASSL_INVALID_SOCKET)
+        {
+            continue;
+        }
+
+        if (!set_non_blocking(sock))
+        {
+            socket_close(sock);
+            sock = NASSL_INVALID_SOCKET;
+            continue;
+        }
+
+        if (connect((SOCKET_FD_CAST) sock, addr->ai_addr, (int) addr->ai_addrlen) == 0)
+        {
+            break;
+        }
+
+        if (SOCKET_IN_PROGRESS(SOCKET_LAST_ERROR)
+                && (wait_for_socket(sock, 1, timeoutMs) > 0)
+                && getsockopt((SOCKET_FD_CAST) sock, SOL_SOCKET, SO_ERROR, (char *) &connectError, &connectErrorLen) == 0
+                && connectError == 0)
+        {
+            break;
+        }
+
+        socket_close(sock);
+        sock = NASSL_INVALID_SOCKET;
+    }
+
+    freeaddrinfo(addrList);
+    return sock;
+}
+
+
+int socket_send_all(nassl_socket_t sock, const char *data, size_t dataSize, int timeoutMs)
+{
+    size_t sentSize = 0;
+    while (sentSize < dataSize)
+    {
+        int result = send((SOCKET_FD_CAST) sock, data + sentSize, (int) (dataSize - sentSize), 0);
+        if (result > 0)
+        {
+            sentSize += result;
+            continue;
+        }
+
+        if ((result < 0) && SOCKET_INTERRUPTED(SOCKET_LAST_ERROR))
+        {
+            continue;
+        }
+
+        if ((result < 0) && SOCKET_WOULD_BLOCK(SOCKET_LAST_ERROR) && (wait_for_socket(sock, 1, timeoutMs) > 0))
+        {
+            continue;
+        }
+        return 0;
+    }
+    return 1;
+}
+
+
+int socket_send_chunks_all(nassl_socket_t sock, const char **chunks, const size_t *chunkSizes, int chunksCount,
+                           int timeoutMs, unsigned long *sendCallsCount, int *socketErrorOut)
+{
+#ifdef _WIN32
+    WSABUF buffers[SOCKET_MAX_CHUNKS];
+#else
+    struct iovec buffers[SOCKET_MAX_CHUNKS];
+#endif
+    int buffersCount = 0, firstBuffer = 0, i;
+
+    for (i = 0; (i < chunksCount) && (buffersCount < SOCKET_MAX_CHUNKS); i++)
+    {
+        if (chunkSizes[i] == 0)
+        {
+            continue;
+        }
+#ifdef _WIN32
+        buffers[buffersCount].buf = (char *) chunks[i];
+        buffers[buffersCount].len = (ULONG) chunkSizes[i];
+#else
+        buffers[buffersCount].iov_base = (void *) chunks[i];
+        buffers[buffersCount].iov_len = chunkSizes[i];
+#endif
+        buffersCount++;
+    }
+
+    while (firstBuffer < buffersCount)
+    {
+        size_t sentSize = 0;
+#ifdef _WIN32
+        DWORD wsaSentSize = 0;
+        int result = WSASend((SOCKET) sock, &buffers[firstBuffer], buffersCount - firstBuffer, &wsaSentSize, 0, NULL,
+                             NULL);
+        if (result == 0)
+        {
+            result = (int) wsaSentSize;
+        }
+        else
+        {
+            result = -1;
+        }
+#else
+        struct msghdr message;
+        ssize_t result;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = &buffers[firstBuffer];
+        message.msg_iovlen = buffersCount - firstBuffer;
+        result = sendmsg(sock, &message, 0);
+#endif
+        if (sendCallsCount != NULL)
+        {
+            (*sendCallsCount)++;
+        }
+
+        if (result > 0)
+        {
+            // Skip what was sent, which may end in the middle of a chunk
+            sentSize = (size_t) result;
+#ifdef _WIN32
+            while ((firstBuffer < buffersCount) && (sentSize >= buffers[firstBuffer].len))
+            {
+                sentSize -= buffers[firstBuffer].len;
+                firstBuffer++;
+            }
+            if (sentSize > 0)
+            {
+                buffers[firstBuffer].buf += sentSize;
+                buffers[firstBuffer].len -= (ULONG) sentSize;
+            }
+#else
+            while ((firstBuffer < buffersCount) && (sentSize >= buffers[firstBuffer].iov_len))
+            {
+                sentSize -= buffers[firstBuffer].iov_len;
+                firstBuffer++;
+            }
+            if (sentSize > 0)
+            {
+                buffers[firstBuffer].iov_base = (char *) buffers[firstBuffer].iov_base + sentSize;
+                buffers[firstBuffer].iov_len -= sentSize;
+            }
+#endif
+            continue;
+        }
+
+        if (result < 0)
+        {
+            int socketError = SOCKET_LAST_ERROR;
+            int waitResult = 0;
+            if (SOCKET_INTERRUPTED(socketError))
+            {
+                continue;
+            }
+            if (SOCKET_WOULD_BLOCK(socketError))
+            {
+                waitResult = wait_for_socket(sock, 1, timeoutMs);
+                if (waitResult > 0)
+                {
+                    continue;
+                }
+                // 0 if the timeout expired
+                socketError = (waitResult == 0) ? 0 : SOCKET_LAST_ERROR;
+            }
+            if (socketErrorOut != NULL)
+            {
+                *socketErrorOut = socketError;
+            }
+        }
+        return 0;
+    }
+    return 1;
+}
+
+
+int socket_recv(nassl_socket_t sock, char *buffer, size_t bufferSize, int timeoutMs)
+{
+    while (1)
+    {
+        int result = recv((SOCKET_FD_CAST) sock, buffer, (int) bufferSize, 0);
+        if (result >= 0)
+        {
+            return result;
+        }
+
+        if (SOCKET_INTERRUPTED(SOCKET_LAST_ERROR))
+        {
+            continue;
+        }
+
+        if (SOCKET_WOULD_BLOCK(SOCKET_LAST_ERROR) && (wait_for_socket(sock, 0, timeoutMs) > 0))
+        {
+            continue;
+        }
+        return -1;
+    }
+}
+
+
+void socket_close(nassl_socket_t sock)
+{
+#ifdef _WIN32
+    closesocket((SOCKET) sock);
+#else
+    close(sock);
+#endif
+}
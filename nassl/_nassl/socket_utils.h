@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Minimal blocking-with-timeout socket helpers so that some operations (cipher suite enumeration, etc.) can run
+// entirely in C with the GIL released. On Windows, Winsock is expected to have been initialized already, which is
+// the case as soon as Python's socket module has been imported.
+#ifdef _WIN32
+typedef uintptr_t nassl_socket_t;
+#define NASSL_INVALID_SOCKET (~(nassl_socket_t)0)
+#else
+typedef int nassl_socket_t;
+#define NASSL_INVALID_SOCKET (-1)
+#endif
+
+// Returns a connected socket or NASSL_INVALID_SOCKET; errorBuf then contains a description of the error
+nassl_socket_t socket_connect(const char *hostname, unsigned short port, int timeoutMs, char *errorBuf, size_t errorBufSize);
+
+// Returns 1 if all the data was sent, 0 otherwise
+int socket_send_all(nassl_socket_t sock, const char *data, size_t dataSize, int timeoutMs);
+
+// Maximum number of chunks socket_send_chunks_all() can send at once
+#define SOCKET_MAX_CHUNKS 4
+
+// Send the chunks with as few system calls as possible (sendmsg() or WSASend()), each of them taking all the chunks
+// that are left; sendCallsCount, if not NULL, gets incremented for every call
+// Returns 1 if all the data was sent, 0 otherwise; socketErrorOut, if not NULL, is then set to the socket's error code
+// (errno or WSAGetLastError()), or to 0 if the timeout expired
+int socket_send_chunks_all(nassl_socket_t sock, const char **chunks, const size_t *chunkSizes, int chunksCount,
+                           int timeoutMs, unsigned long *sendCallsCount, int *socketErrorOut);
+
+// Returns the number of bytes received, 0 if the peer closed the connection and -1 on error or timeout
+int socket_recv(nassl_socket_t sock, char *buffer, size_t bufferSize, int timeoutMs);
+
+void socket_close(nassl_socket_t sock);
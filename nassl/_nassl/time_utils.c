@@ -0,0 +1,45 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "time_utils.h"
+
+
+double get_monotonic_time(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+#endif
+}
+
+
+int asn1_time_to_timestamp(const ASN1_TIME *asn1Time, long long *timestampOut)
+{
+    // ASN1_TIME_to_tm() is not available in OpenSSL 1.0.2 but ASN1_TIME_diff() is
+    static ASN1_TIME *epochTime = NULL;
+    int days = 0, seconds = 0;
+
+    if (epochTime == NULL)
+    {
+        epochTime = ASN1_TIME_set(NULL, 0);
+        if (epochTime == NULL)
+        {
+            return 0;
+        }
+    }
+    if (!ASN1_TIME_diff(&days, &seconds, epochTime, asn1Time))
+    {
+        return 0;
+    }
+    *timestampOut = (long long) days * 86400 + seconds;
+    return 1;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <openssl/asn1.h>
+
+// Returns a monotonic time in seconds, only meaningful when compared to another value returned by this function
+double get_monotonic_time(void);
+
+// Converts an ASN1_TIME to seconds since the epoch without printing it; returns 0 if the time is invalid
+// Has to be called with the GIL held
+int asn1_time_to_timestamp(const ASN1_TIME *asn1Time, long long *timestampOut);
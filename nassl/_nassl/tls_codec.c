@@ -0,0 +1,573 @@
+#include <string.h>
+
+#include "tls_codec.h"
+
+
+// SHA-256 of "HelloRetryRequest"; TLS 1.3 HelloRetryRequests are ServerHellos with this random
+static const unsigned char HELLO_RETRY_REQUEST_RANDOM[32] =
+{
+    0xCF, 0x21, 0xAD, 0x74, 0xE5, 0x9A, 0x61, 0x11, 0xBE, 0x1D, 0x8C, 0x02, 0x1E, 0x65, 0xB8, 0x91,
+    0xC2, 0xA2, 0x11, 0x16, 0x7A, 0xBB, 0x8C, 0x5E, 0x07, 0x9E, 0x09, 0xE2, 0xC8, 0xA8, 0x33, 0x9C
+};
+
+
+// Bounds-checked reader over a received message
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    size_t offset;
+} TlsReader;
+
+
+static int reader_has(TlsReader *reader, size_t size)
+{
+    return (reader->size - reader->offset) >= size;
+}
+
+
+static int read_uint8(TlsReader *reader, unsigned int *out)
+{
+    if (!reader_has(reader, 1))
+    {
+        return 0;
+    }
+    *out = reader->data[reader->offset];
+    reader->offset += 1;
+    return 1;
+}
+
+
+static int read_uint16(TlsReader *reader, unsigned int *out)
+{
+    if (!reader_has(reader, 2))
+    {
+        return 0;
+    }
+    *out = (reader->data[reader->offset] << 8) | reader->data[reader->offset + 1];
+    reader->offset += 2;
+    return 1;
+}
+
+
+static int read_uint24(TlsReader *reader, unsigned int *out)
+{
+    if (!reader_has(reader, 3))
+    {
+        return 0;
+    }
+    *out = (reader->data[reader->offset] << 16) | (reader->data[reader->offset + 1] << 8)
+            | reader->data[reader->offset + 2];
+    reader->offset += 3;
+    return 1;
+}
+
+
+static int skip_bytes(TlsReader *reader, size_t size)
+{
+    if (!reader_has(reader, size))
+    {
+        return 0;
+    }
+    reader->offset += size;
+    return 1;
+}
+
+
+static int parse_server_hello_extensions(TlsReader *reader, TlsServerResponse *response)
+{
+    unsigned int extensionsSize = 0;
+    TlsReader extensionsReader;
+
+    if (!reader_has(reader, 1))
+    {
+        // No extensions at all (SSL 3.0 or old TLS servers)
+        return 1;
+    }
+    if (!read_uint16(reader, &extensionsSize) || !reader_has(reader, extensionsSize))
+    {
+        return 0;
+    }
+
+    extensionsReader.data = reader->data + reader->offset;
+    extensionsReader.size = extensionsSize;
+    extensionsReader.offset = 0;
+    while (reader_has(&extensionsReader, 1))
+    {
+        unsigned int extensionType = 0, extensionSize = 0, value = 0;
+        TlsReader extensionReader;
+        if (!read_uint16(&extensionsReader, &extensionType) || !read_uint16(&extensionsReader, &extensionSize)
+                || !reader_has(&extensionsReader, extensionSize))
+        {
+            return 0;
+        }
+
+        if (response->extensionsCount < TLS_MAX_SERVER_HELLO_EXTENSIONS)
+        {
+            response->extensions[response->extensionsCount] = (unsigned short) extensionType;
+            response->extensionsCount++;
+        }
+
+        extensionReader.data = extensionsReader.data + extensionsReader.offset;
+        extensionReader.size = extensionSize;
+        extensionReader.offset = 0;
+        if ((extensionType == TLS_EXTENSION_SUPPORTED_VERSIONS) && read_uint16(&extensionReader, &value))
+        {
+            response->version = (unsigned short) value;
+        }
+        else if ((extensionType == TLS_EXTENSION_KEY_SHARE) && read_uint16(&extensionReader, &value))
+        {
+            // The group is the first field of both the ServerHello and HelloRetryRequest key_share extensions
+            response->selectedGroup = (unsigned short) value;
+        }
+        extensionsReader.offset += extensionSize;
+    }
+    reader->offset += extensionsSize;
+    return 1;
+}
+
+
+static int parse_server_hello(const unsigned char *message, size_t messageSize, TlsServerResponse *response)
+{
+    TlsReader reader = {message, messageSize, 0};
+    unsigned int handshakeType = 0, bodySize = 0, version = 0, sessionIdSize = 0, cipherId = 0, compression = 0;
+
+    if (!read_uint8(&reader, &handshakeType) || !read_uint24(&reader, &bodySize) || !reader_has(&reader, bodySize))
+    {
+        return 0;
+    }
+    reader.size = reader.offset + bodySize;
+
+    if (handshakeType == TLS_HANDSHAKE_TYPE_HELLO_RETRY_REQUEST_DRAFT)
+    {
+        // Early TLS 1.3 drafts: version, cipher suite (draft-19+) and extensions
+        if (!read_uint16(&reader, &version) || !read_uint16(&reader, &cipherId))
+        {
+            return 0;
+        }
+        response->messageType = TLS_MESSAGE_HELLO_RETRY_REQUEST;
+        response->version = (unsigned short) version;
+        response->cipherId = cipherId;
+        return parse_server_hello_extensions(&reader, response);
+    }
+
+    if (!read_uint16(&reader, &version) || !reader_has(&reader, 32))
+    {
+        return 0;
+    }
+    response->messageType = TLS_MESSAGE_SERVER_HELLO;
+    if (memcmp(reader.data + reader.offset, HELLO_RETRY_REQUEST_RANDOM, 32) == 0)
+    {
+        response->messageType = TLS_MESSAGE_HELLO_RETRY_REQUEST;
+    }
+    reader.offset += 32;
+
+    if (!read_uint8(&reader, &sessionIdSize) || !skip_bytes(&reader, sessionIdSize)
+            || !read_uint16(&reader, &cipherId) || !read_uint8(&reader, &compression))
+    {
+        return 0;
+    }
+    response->version = (unsigned short) version;
+    response->cipherId = cipherId;
+    response->compressionMethod = (unsigned char) compression;
+    return parse_server_hello_extensions(&reader, response);
+}
+
+
+static int parse_ssl2_server_hello(const unsigned char *message, size_t messageSize, TlsServerResponse *response)
+{
+    TlsReader reader = {message, messageSize, 0};
+    unsigned int messageType = 0, sessionIdHit = 0, certificateType = 0, version = 0;
+    unsigned int certificateSize = 0, cipherSpecsSize = 0, connectionIdSize = 0, cipherId = 0;
+
+    if (!read_uint8(&reader, &messageType) || (messageType != SSL2_MESSAGE_TYPE_SERVER_HELLO)
+            || !read_uint8(&reader, &sessionIdHit) || !read_uint8(&reader, &certificateType)
+            || !read_uint16(&reader, &version) || !read_uint16(&reader, &certificateSize)
+            || !read_uint16(&reader, &cipherSpecsSize) || !read_uint16(&reader, &connectionIdSize)
+            || !skip_bytes(&reader, certificateSize))
+    {
+        return 0;
+    }
+
+    // The server sends the list of cipher specs it has in common with the client; we keep the first one
+    if ((cipherSpecsSize >= 3) && !read_uint24(&reader, &cipherId))
+    {
+        return 0;
+    }
+    response->messageType = TLS_MESSAGE_SERVER_HELLO;
+    response->version = (unsigned short) version;
+    response->cipherId = cipherId;
+    return 1;
+}
+
+
+int tls_parse_server_message(int version, int contentType, const unsigned char *message, size_t messageSize,
+                             TlsServerResponse *response)
+{
+    memset(response, 0, sizeof(TlsServerResponse));
+    if (version == SSL2_VERSION_NUMBER)
+    {
+        return parse_ssl2_server_hello(message, messageSize, response);
+    }
+
+    if ((contentType == TLS_CONTENT_TYPE_ALERT) && (messageSize >= 2))
+    {
+        response->messageType = TLS_MESSAGE_ALERT;
+        response->alertLevel = message[0];
+        response->alertDescription = message[1];
+        return 1;
+    }
+
+    if ((contentType == TLS_CONTENT_TYPE_HANDSHAKE) && (messageSize >= 1)
+            && ((message[0] == TLS_HANDSHAKE_TYPE_SERVER_HELLO)
+                || (message[0] == TLS_HANDSHAKE_TYPE_HELLO_RETRY_REQUEST_DRAFT)))
+    {
+        if (parse_server_hello(message, messageSize, response))
+        {
+            return 1;
+        }
+        memset(response, 0, sizeof(TlsServerResponse));
+    }
+    return 0;
+}
+
+
+int tls_parse_server_records(const unsigned char *data, size_t dataSize, TlsServerResponse *response)
+{
+    // Only needed if the server's first handshake message spans several records
+    unsigned char handshakeBuffer[TLS_MAX_RECORD_PAYLOAD_SIZE];
+    size_t handshakeSize = 0, offset = 0;
+
+    memset(response, 0, sizeof(TlsServerResponse));
+    if (dataSize < 2)
+    {
+        return 0;
+    }
+
+    if (data[0] & 0x80)
+    {
+        // SSL 2.0 record with a 2-byte header
+        size_t recordSize = ((data[0] & 0x7F) << 8) | data[1];
+        if (dataSize < 2 + recordSize)
+        {
+            return 0;
+        }
+        return tls_parse_server_message(SSL2_VERSION_NUMBER, 0, data + 2, recordSize, response) ? 1 : -1;
+    }
+
+    while (offset + TLS_RECORD_HEADER_SIZE <= dataSize)
+    {
+        unsigned int contentType = data[offset];
+        unsigned int version = (data[offset + 1] << 8) | data[offset + 2];
+        size_t recordSize = (data[offset + 3] << 8) | data[offset + 4];
+        const unsigned char *payload = data + offset + TLS_RECORD_HEADER_SIZE;
+        const unsigned char *message = NULL;
+        size_t messageSize = 0;
+
+        if (((version >> 8) != 0x03) || (recordSize > TLS_MAX_RECORD_PAYLOAD_SIZE))
+        {
+            return -1;
+        }
+        if (offset + TLS_RECORD_HEADER_SIZE + recordSize > dataSize)
+        {
+            return 0;
+        }
+
+        if (contentType == TLS_CONTENT_TYPE_ALERT)
+        {
+            return tls_parse_server_message(version, contentType, payload, recordSize, response) ? 1 : -1;
+        }
+        if (contentType != TLS_CONTENT_TYPE_HANDSHAKE)
+        {
+            return -1;
+        }
+
+        if ((handshakeSize == 0) && (recordSize >= 4)
+                && (4 + (size_t) ((payload[1] << 16) | (payload[2] << 8) | payload[3]) <= recordSize))
+        {
+            // Usual case: the whole message is in the first record
+            message = payload;
+            messageSize = recordSize;
+        }
+        else
+        {
+            size_t copySize = sizeof(handshakeBuffer) - handshakeSize;
+            if (copySize > recordSize)
+            {
+                copySize = recordSize;
+            }
+            memcpy(handshakeBuffer + handshakeSize, payload, copySize);
+            handshakeSize += copySize;
+
+            if (handshakeSize >= 4)
+            {
+                size_t expectedSize = 4 + ((handshakeBuffer[1] << 16) | (handshakeBuffer[2] << 8) | handshakeBuffer[3]);
+                if (expectedSize > sizeof(handshakeBuffer))
+                {
+                    return -1;
+                }
+                if (expectedSize <= handshakeSize)
+                {
+                    message = handshakeBuffer;
+                    messageSize = handshakeSize;
+                }
+            }
+        }
+
+        if (message != NULL)
+        {
+            return tls_parse_server_message(version, contentType, message, messageSize, response) ? 1 : -1;
+        }
+        offset += TLS_RECORD_HEADER_SIZE + recordSize;
+    }
+    return 0;
+}
+
+
+// Writer over the caller's buffer; once it has overflowed all the writes are ignored
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    size_t offset;
+    int hasOverflowed;
+} TlsWriter;
+
+
+static void write_bytes(TlsWriter *writer, const unsigned char *bytes, size_t size)
+{
+    if (writer->hasOverflowed || ((writer->size - writer->offset) < size))
+    {
+        writer->hasOverflowed = 1;
+        return;
+    }
+    if (size > 0)
+    {
+        memcpy(writer->data + writer->offset, bytes, size);
+    }
+    writer->offset += size;
+}
+
+
+static void write_uint(TlsWriter *writer, unsigned int value, size_t size)
+{
+    unsigned char bytes[4];
+    size_t i = 0;
+    for (i = 0; i < size; i++)
+    {
+        bytes[i] = (unsigned char) (value >> (8 * (size - i - 1)));
+    }
+    write_bytes(writer, bytes, size);
+}
+
+
+// Writes a placeholder for the length of a vector and returns its offset, to be given to end_vector()
+static size_t start_vector(TlsWriter *writer, size_t lengthSize)
+{
+    size_t lengthOffset = writer->offset;
+    write_uint(writer, 0, lengthSize);
+    return lengthOffset;
+}
+
+
+static void end_vector(TlsWriter *writer, size_t lengthOffset, size_t lengthSize)
+{
+    size_t vectorSize = writer->offset - lengthOffset - lengthSize;
+    size_t i = 0;
+    if (writer->hasOverflowed)
+    {
+        return;
+    }
+    if (vectorSize >= ((size_t) 1 << (8 * lengthSize)))
+    {
+        // Too many items for this vector
+        writer->hasOverflowed = 1;
+        return;
+    }
+    for (i = 0; i < lengthSize; i++)
+    {
+        writer->data[lengthOffset + i] = (unsigned char) (vectorSize >> (8 * (lengthSize - i - 1)));
+    }
+}
+
+
+static void write_uint16_vector_extension(TlsWriter *writer, unsigned int extensionType, const unsigned int *values,
+                                          size_t valuesCount, size_t vectorLengthSize)
+{
+    size_t extensionOffset = 0, vectorOffset = 0, i = 0;
+    if (valuesCount == 0)
+    {
+        return;
+    }
+    write_uint(writer, extensionType, 2);
+    extensionOffset = start_vector(writer, 2);
+    vectorOffset = start_vector(writer, vectorLengthSize);
+    for (i = 0; i < valuesCount; i++)
+    {
+        write_uint(writer, values[i], 2);
+    }
+    end_vector(writer, vectorOffset, vectorLengthSize);
+    end_vector(writer, extensionOffset, 2);
+}
+
+
+static int is_tls13_offered(const TlsClientHelloParams *params)
+{
+    size_t i = 0;
+    for (i = 0; i < params->supportedVersionsCount; i++)
+    {
+        // TLS 1.3 or one of its drafts
+        if ((params->supportedVersions[i] == 0x0304) || ((params->supportedVersions[i] >> 8) == 0x7F))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+// Upper bound of the size of the ClientHello handshake message, without the record headers
+static size_t get_client_hello_message_max_size(const TlsClientHelloParams *params)
+{
+    size_t messageSize = 4 + 2 + TLS_RANDOM_SIZE + 1 + 2 + 2 * params->cipherIdsCount + 2 + 2;
+    if (params->serverName != NULL)
+    {
+        messageSize += 9 + strlen(params->serverName);
+    }
+    messageSize += 6 + 2 * params->groupsCount + 6;
+    messageSize += 6 + 2 * params->signatureAlgorithmsCount;
+    messageSize += 5 + 2 * params->supportedVersionsCount + 6;
+    messageSize += params->extraExtensionsSize;
+    return messageSize;
+}
+
+
+static size_t get_client_hello_max_records_count(const TlsClientHelloParams *params)
+{
+    return get_client_hello_message_max_size(params) / TLS_MAX_RECORD_PAYLOAD_SIZE + 1;
+}
+
+
+size_t tls_get_client_hello_max_size(const TlsClientHelloParams *params)
+{
+    return get_client_hello_message_max_size(params)
+            + TLS_RECORD_HEADER_SIZE * get_client_hello_max_records_count(params);
+}
+
+
+size_t tls_build_client_hello(const TlsClientHelloParams *params, unsigned char *buffer, size_t bufferSize)
+{
+    // Leave enough room at the beginning of the buffer for the header of each record
+    size_t messageOffset = TLS_RECORD_HEADER_SIZE * get_client_hello_max_records_count(params);
+    size_t bodyOffset = 0, extensionsOffset = 0, vectorOffset = 0, messageSize = 0, outOffset = 0, i = 0;
+    TlsWriter writer = {buffer, bufferSize, messageOffset, 0};
+
+    if (messageOffset > bufferSize)
+    {
+        return 0;
+    }
+
+    write_uint(&writer, TLS_HANDSHAKE_TYPE_CLIENT_HELLO, 1);
+    bodyOffset = start_vector(&writer, 3);
+    write_uint(&writer, params->clientVersion, 2);
+    write_bytes(&writer, params->random, TLS_RANDOM_SIZE);
+    write_uint(&writer, 0, 1);  // No session ID
+
+    vectorOffset = start_vector(&writer, 2);
+    for (i = 0; i < params->cipherIdsCount; i++)
+    {
+        write_uint(&writer, params->cipherIds[i], 2);
+    }
+    end_vector(&writer, vectorOffset, 2);
+
+    write_uint(&writer, 1, 1);  // Only the null compression method
+    write_uint(&writer, 0, 1);
+
+    extensionsOffset = start_vector(&writer, 2);
+    if (params->serverName != NULL)
+    {
+        size_t extensionOffset = 0, listOffset = 0, nameOffset = 0;
+        write_uint(&writer, TLS_EXTENSION_SERVER_NAME, 2);
+        extensionOffset = start_vector(&writer, 2);
+        listOffset = start_vector(&writer, 2);
+        write_uint(&writer, 0, 1);  // host_name
+        nameOffset = start_vector(&writer, 2);
+        write_bytes(&writer, (const unsigned char *) params->serverName, strlen(params->serverName));
+        end_vector(&writer, nameOffset, 2);
+        end_vector(&writer, listOffset, 2);
+        end_vector(&writer, extensionOffset, 2);
+    }
+    write_uint16_vector_extension(&writer, TLS_EXTENSION_SUPPORTED_GROUPS, params->groups, params->groupsCount, 2);
+    if (params->groupsCount > 0)
+    {
+        // Some TLS 1.2 servers do not negotiate ECDHE without it; only the uncompressed format
+        write_uint(&writer, TLS_EXTENSION_EC_POINT_FORMATS, 2);
+        write_uint(&writer, 2, 2);
+        write_uint(&writer, 1, 1);
+        write_uint(&writer, 0, 1);
+    }
+    write_uint16_vector_extension(&writer, TLS_EXTENSION_SIGNATURE_ALGORITHMS, params->signatureAlgorithms,
+                                  params->signatureAlgorithmsCount, 2);
+    write_uint16_vector_extension(&writer, TLS_EXTENSION_SUPPORTED_VERSIONS, params->supportedVersions,
+                                  params->supportedVersionsCount, 1);
+    if (is_tls13_offered(params) && (params->groupsCount > 0))
+    {
+        // No key shares at all: the server has to pick a group in a HelloRetryRequest
+        write_uint(&writer, TLS_EXTENSION_KEY_SHARE, 2);
+        write_uint(&writer, 2, 2);
+        write_uint(&writer, 0, 2);
+    }
+    write_bytes(&writer, params->extraExtensions, params->extraExtensionsSize);
+    end_vector(&writer, extensionsOffset, 2);
+    end_vector(&writer, bodyOffset, 3);
+    if (writer.hasOverflowed)
+    {
+        return 0;
+    }
+
+    // Split the message into records, moving each fragment right after its record header
+    messageSize = writer.offset - messageOffset;
+    for (i = 0; i * TLS_MAX_RECORD_PAYLOAD_SIZE < messageSize; i++)
+    {
+        size_t fragmentSize = messageSize - i * TLS_MAX_RECORD_PAYLOAD_SIZE;
+        if (fragmentSize > TLS_MAX_RECORD_PAYLOAD_SIZE)
+        {
+            fragmentSize = TLS_MAX_RECORD_PAYLOAD_SIZE;
+        }
+        buffer[outOffset] = TLS_CONTENT_TYPE_HANDSHAKE;
+        buffer[outOffset + 1] = (unsigned char) (params->recordVersion >> 8);
+        buffer[outOffset + 2] = (unsigned char) params->recordVersion;
+        buffer[outOffset + 3] = (unsigned char) (fragmentSize >> 8);
+        buffer[outOffset + 4] = (unsigned char) fragmentSize;
+        memmove(buffer + outOffset + TLS_RECORD_HEADER_SIZE,
+                buffer + messageOffset + i * TLS_MAX_RECORD_PAYLOAD_SIZE, fragmentSize);
+        outOffset += TLS_RECORD_HEADER_SIZE + fragmentSize;
+    }
+    return outOffset;
+}
+
+
+size_t tls_build_ssl2_client_hello(const unsigned int *cipherSpecs, size_t cipherSpecsCount,
+                                   const unsigned char *challenge, unsigned char *buffer, size_t bufferSize)
+{
+    TlsWriter writer = {buffer, bufferSize, 0, 0};
+    size_t messageSize = 9 + 3 * cipherSpecsCount + SSL2_CHALLENGE_SIZE;
+    size_t i = 0;
+
+    if (messageSize > 0x7FFF)
+    {
+        return 0;
+    }
+
+    // 2-byte record header
+    write_uint(&writer, 0x8000 | (unsigned int) messageSize, 2);
+    write_uint(&writer, SSL2_MESSAGE_TYPE_CLIENT_HELLO, 1);
+    write_uint(&writer, SSL2_VERSION_NUMBER, 2);
+    write_uint(&writer, (unsigned int) (3 * cipherSpecsCount), 2);
+    write_uint(&writer, 0, 2);  // No session ID
+    write_uint(&writer, SSL2_CHALLENGE_SIZE, 2);
+    for (i = 0; i < cipherSpecsCount; i++)
+    {
+        write_uint(&writer, cipherSpecs[i], 3);
+    }
+    write_bytes(&writer, challenge, SSL2_CHALLENGE_SIZE);
+    return writer.hasOverflowed ? 0 : writer.offset;
+}
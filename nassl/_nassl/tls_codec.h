@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stddef.h>
+
+// Small TLS handshake codec which does not depend on OpenSSL
+// Used to extract what we need from the server's first flight without letting OpenSSL complete the handshake, and to
+// build ClientHellos that neither of the OpenSSL versions we ship can send (SSL 2.0 with TLS 1.3, arbitrary IDs, etc.)
+
+#define TLS_CONTENT_TYPE_ALERT 21
+#define TLS_CONTENT_TYPE_HANDSHAKE 22
+
+#define TLS_RECORD_HEADER_SIZE 5
+#define TLS_MAX_RECORD_PAYLOAD_SIZE 16384
+
+#define TLS_HANDSHAKE_TYPE_CLIENT_HELLO 1
+#define TLS_HANDSHAKE_TYPE_SERVER_HELLO 2
+#define TLS_HANDSHAKE_TYPE_HELLO_RETRY_REQUEST_DRAFT 6  // Used by TLS 1.3 drafts before draft-22
+
+#define SSL2_VERSION_NUMBER 0x0002
+#define SSL2_MESSAGE_TYPE_CLIENT_HELLO 1
+#define SSL2_MESSAGE_TYPE_SERVER_HELLO 4
+#define SSL2_CHALLENGE_SIZE 16
+
+#define TLS_EXTENSION_SERVER_NAME 0
+#define TLS_EXTENSION_SUPPORTED_GROUPS 10
+#define TLS_EXTENSION_EC_POINT_FORMATS 11
+#define TLS_EXTENSION_SIGNATURE_ALGORITHMS 13
+#define TLS_EXTENSION_SUPPORTED_VERSIONS 43
+#define TLS_EXTENSION_KEY_SHARE 51
+
+#define TLS_MAX_SERVER_HELLO_EXTENSIONS 32
+#define TLS_RANDOM_SIZE 32
+
+typedef enum
+{
+    TLS_MESSAGE_NONE = 0,
+    TLS_MESSAGE_SERVER_HELLO,
+    TLS_MESSAGE_HELLO_RETRY_REQUEST,
+    TLS_MESSAGE_ALERT
+} TlsMessageType;
+
+typedef struct {
+    TlsMessageType messageType;
+    unsigned short version; // Taken from the supported_versions extension if the server sent one (TLS 1.3)
+    unsigned int cipherId; // 2 bytes for SSL 3.0 and TLS; the first 3-byte cipher spec for SSL 2.0
+    unsigned char compressionMethod;
+    unsigned short selectedGroup; // From the key_share extension (TLS 1.3); 0 if the server did not send one
+    unsigned int extensionsCount;
+    unsigned short extensions[TLS_MAX_SERVER_HELLO_EXTENSIONS];
+    unsigned char alertLevel;
+    unsigned char alertDescription;
+} TlsServerResponse;
+
+
+// Parses a message as given to an OpenSSL message callback (ie. handshake messages with their 4-byte header)
+// Returns 1 if a ServerHello, a HelloRetryRequest or an alert was successfully parsed into response
+int tls_parse_server_message(int version, int contentType, const unsigned char *message, size_t messageSize,
+                             TlsServerResponse *response);
+
+
+// Parses the records received from the server so far (TLS, SSL 3.0 or SSL 2.0) until its first ServerHello,
+// HelloRetryRequest or alert
+// Returns 1 if one was parsed into response, 0 if more data is needed and -1 if the data is not a valid response
+int tls_parse_server_records(const unsigned char *data, size_t dataSize, TlsServerResponse *response);
+
+
+// Everything needed to build a TLS or SSL 3.0 ClientHello; the arrays are optional and the corresponding extension is
+// only sent if they are not empty. If supportedVersions contains TLS 1.3 and groups is not empty, an empty key_share
+// extension is sent so that a TLS 1.3 server replies with a HelloRetryRequest containing its selected group.
+typedef struct {
+    unsigned short recordVersion;
+    unsigned short clientVersion;
+    const unsigned char *random; // TLS_RANDOM_SIZE bytes
+    const unsigned int *cipherIds;
+    size_t cipherIdsCount;
+    const char *serverName; // Can be NULL
+    const unsigned int *supportedVersions;
+    size_t supportedVersionsCount;
+    const unsigned int *groups;
+    size_t groupsCount;
+    const unsigned int *signatureAlgorithms;
+    size_t signatureAlgorithmsCount;
+    const unsigned char *extraExtensions; // Already serialized extensions appended as is; can be NULL
+    size_t extraExtensionsSize;
+} TlsClientHelloParams;
+
+// Returns an upper bound of the size of the ClientHello records for the given parameters
+size_t tls_get_client_hello_max_size(const TlsClientHelloParams *params);
+
+// Writes the ClientHello records to buffer; returns the number of bytes written or 0 if buffer was too small
+size_t tls_build_client_hello(const TlsClientHelloParams *params, unsigned char *buffer, size_t bufferSize);
+
+// Writes an SSL 2.0 ClientHello record with the given 3-byte cipher specs and SSL2_CHALLENGE_SIZE bytes of challenge
+// Returns the number of bytes written or 0 if buffer was too small
+size_t tls_build_ssl2_client_hello(const unsigned int *cipherSpecs, size_t cipherSpecsCount,
+                                   const unsigned char *challenge, unsigned char *buffer, size_t bufferSize);
@@ -4,7 +4,7 @@ from __future__ import unicode_literals
 
 import socket
 
-from nassl._nassl import WantReadError, WantX509LookupError  # type: ignore
+from nassl._nassl import WantReadError, WantWriteError, WantX509LookupError  # type: ignore
 
 from nassl.ssl_client import SslClient, ClientCertificateRequested, OpenSslVersionEnum, OpenSslVerifyEnum, \
     OpenSslFileTypeEnum
@@ -36,20 +36,23 @@ class LegacySslClient(SslClient):
             client_key_type=OpenSslFileTypeEnum.PEM,        # type: OpenSslFileTypeEnum
             client_key_password='',                         # type: Text
             ignore_client_authentication_requests=False,    # type: bool
-            signature_algorithms=None                       # type: Optional[Text]
+            signature_algorithms=None,                      # type: Optional[Text]
+            release_buffers_when_idle=False,                # type: bool
+            bio_buffer_size=None,                           # type: Optional[int]
+            use_intermediate_pool=False,                    # type: bool
     ):
         # type: (...) -> None
         self._init_base_objects(ssl_version, underlying_socket)
 
         # Warning: Anything that modifies the SSL_CTX must be done before creating the SSL object
         # Otherwise changes to the SSL_CTX do not get propagated to future SSL objects
-        self._init_server_authentication(ssl_verify, ssl_verify_locations)
+        self._init_server_authentication(ssl_verify, ssl_verify_locations, use_intermediate_pool)
         self._init_client_authentication(client_certchain_file, client_key_file, client_key_type,
                                          client_key_password,ignore_client_authentication_requests)
         if signature_algorithms:
             self._set_tlsext_signature_algorithms(signature_algorithms)
         # Now create the SSL object
-        self._init_ssl_objects()
+        self._init_ssl_objects(release_buffers_when_idle, bio_buffer_size)
 
         # Specific servers do not reply to a client hello that is bigger than 255 bytes
         # See http://rt.openssl.org/Ticket/Display.html?id=2771&user=guest&pass=guest
@@ -201,24 +204,21 @@ class LegacySslClient(SslClient):
                             cmk_packet = handshake_data_out[0:size+2]
                             data_packet = handshake_data_out[size+2::]
                             self._sock.send(cmk_packet)
+                            self._socket_send_calls += 1
 
-                            handshake_data_in = self._sock.recv(self._DEFAULT_BUFFER_SIZE)
-                            # print repr(handshake_data_in)
-                            if len(handshake_data_in) == 0:
-                                raise IOError('Nassl SSL handshake failed: peer did not send data back.')
-                            # Pass the data to the SSL engine
-                            self._network_bio.write(handshake_data_in)
+                            self._receive_encrypted_data('Nassl SSL handshake failed: peer did not send data back.')
                             handshake_data_out = data_packet
 
                     # Send it to the peer
                     self._sock.send(handshake_data_out)
+                    self._socket_send_calls += 1
                     lengh_to_read = self._network_bio.pending()
 
-                handshake_data_in = self._sock.recv(self._DEFAULT_BUFFER_SIZE)
-                if len(handshake_data_in) == 0:
-                    raise IOError('Nassl SSL handshake failed: peer did not send data back.')
-                # Pass the data to the SSL engine
-                self._network_bio.write(handshake_data_in)
+                self._receive_encrypted_data('Nassl SSL handshake failed: peer did not send data back.')
+
+            except WantWriteError:
+                # The BIO pair is full (ie. a small bio_buffer_size); send what is in it and try again
+                self._flush_ssl_engine()
 
             except WantX509LookupError:
                 # Server asked for a client certificate and we didn't provide one
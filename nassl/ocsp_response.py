@@ -2,6 +2,7 @@
 from __future__ import absolute_import
 from __future__ import unicode_literals
 
+from collections import namedtuple
 from enum import IntEnum
 from typing import Tuple, Optional, List, Union
 from typing import Any
@@ -26,6 +27,38 @@ class OcspResponseStatusEnum(IntEnum):
     UNAUTHORIZED = 6
 
 
+class OcspCertificateStatusEnum(IntEnum):
+    GOOD = 0
+    REVOKED = 1
+    UNKNOWN = 2
+
+
+class OcspStaplingVerdict(namedtuple('OcspStaplingVerdict', ['is_must_staple', 'is_response_stapled', 'response_status',
+                                                             'certificate_status', 'is_response_current',
+                                                             'is_signature_valid'])):
+    """The outcome of OCSP stapling for a connection, computed in C from the server's leaf certificate and the stapled
+    response.
+
+    response_status and certificate_status are None if no response was stapled, or if the response does not contain
+    the status of the leaf certificate. is_signature_valid is True if the response was signed by the leaf's issuer or
+    its delegated responder, and the signer chains to the client's trust store (see ssl_verify_locations).
+    """
+
+    @property
+    def is_acceptable(self):
+        # type: () -> bool
+        """False if the leaf is revoked, or if it is must-staple (RFC 7633) without a current "good" status; only
+        responses with a valid signature are taken into account.
+        """
+        if not self.is_signature_valid:
+            return not self.is_must_staple
+        if self.certificate_status == OcspCertificateStatusEnum.REVOKED:
+            return False
+        if self.is_must_staple:
+            return self.certificate_status == OcspCertificateStatusEnum.GOOD and self.is_response_current
+        return True
+
+
 class OcspResponse(object):
     """High level API for parsing an OCSP response.
     """
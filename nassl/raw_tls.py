@@ -0,0 +1,102 @@
+# -*- coding: utf-8 -*-
+from __future__ import absolute_import
+from __future__ import unicode_literals
+
+import struct
+from collections import namedtuple
+from enum import IntEnum
+
+from nassl import _nassl  # type: ignore
+from nassl.ssl_client import ServerHello, _get_ssl_version_from_protocol_version
+from typing import List
+from typing import Optional
+from typing import Text
+from typing import Tuple
+from typing import Union
+
+
+class TlsMessageTypeEnum(IntEnum):
+    """Types of messages returned by the native parser; they map to the TlsMessageType C enum.
+    """
+    SERVER_HELLO = 1
+    HELLO_RETRY_REQUEST = 2
+    ALERT = 3
+
+
+class TlsAlert(namedtuple('TlsAlert', ['level', 'description'])):
+    """An alert sent by the server in response to a ClientHello; description is the alert's code (40 for
+    handshake_failure, 70 for protocol_version, etc.).
+    """
+
+
+def build_client_hello(
+        cipher_ids,                     # type: List[int]
+        client_version=0x0303,          # type: int
+        record_version=0x0301,          # type: int
+        server_name=None,               # type: Optional[Text]
+        supported_versions=None,        # type: Optional[List[int]]
+        groups=None,                    # type: Optional[List[int]]
+        signature_algorithms=None,      # type: Optional[List[int]]
+        extensions=None,                # type: Optional[List[Tuple[int, bytes]]]
+        random=None,                    # type: Optional[bytes]
+):
+    # type: (...) -> bytes
+    """Build a TLS or SSL 3.0 ClientHello without going through OpenSSL, so that any combination of versions, cipher
+    suite IDs, groups and signature algorithms can be sent.
+
+    The supported_groups, signature_algorithms and supported_versions extensions are only sent if the corresponding
+    argument is not empty; additional extensions can be supplied as (type, data) tuples. When TLS 1.3 is part of
+    supported_versions, an empty key_share extension is sent so that the server has to reply with a
+    HelloRetryRequest which contains its selected group.
+    """
+    extra_extensions = None
+    if extensions:
+        extra_extensions = b''.join([struct.pack('>HH', ext_type, len(ext_data)) + ext_data
+                                     for ext_type, ext_data in extensions])
+    return _nassl.build_client_hello(record_version, client_version, cipher_ids, server_name, supported_versions,
+                                     groups, signature_algorithms, extra_extensions, random)
+
+
+def build_ssl2_client_hello(cipher_specs, challenge=None):
+    # type: (List[int], Optional[bytes]) -> bytes
+    """Build an SSL 2.0 ClientHello offering the supplied 3-byte cipher specs.
+    """
+    return _nassl.build_ssl2_client_hello(cipher_specs, challenge)
+
+
+def _server_response_from_tuple(response):
+    # type: (Tuple) -> Union[ServerHello, TlsAlert]
+    message_type, version, cipher_id, compression, extensions, group, alert_level, alert_description = response
+    if message_type == TlsMessageTypeEnum.ALERT:
+        return TlsAlert(alert_level, alert_description)
+
+    cipher_info = _nassl.CIPHERS_BY_ID.get(cipher_id)
+    return ServerHello(_get_ssl_version_from_protocol_version(version), version, cipher_id,
+                       cipher_info.name if cipher_info else None, compression, extensions, group if group else None,
+                       message_type == TlsMessageTypeEnum.HELLO_RETRY_REQUEST)
+
+
+def parse_server_response(data):
+    # type: (bytes) -> Optional[Union[ServerHello, TlsAlert]]
+    """Parse the server's first ServerHello, HelloRetryRequest or alert out of the raw records received so far.
+
+    Returns None if more data is needed and raises ValueError if the data is not a valid response. The cipher_name
+    of the returned ServerHello is None if the cipher suite is not supported by OpenSSL.
+    """
+    response = _nassl.parse_server_records(data)
+    if response is None:
+        return None
+    return _server_response_from_tuple(response)
+
+
+def probe_server(hostname, port, client_hello, timeout=5):
+    # type: (Text, int, bytes, float) -> Optional[Union[ServerHello, TlsAlert]]
+    """Send a raw ClientHello to the server and return its ServerHello, HelloRetryRequest or alert, or None if the
+    server closed the connection without replying.
+
+    The connection is closed as soon as the response has been parsed; everything is done in C without holding the GIL.
+    """
+    response = _nassl.probe_server_raw(hostname, port, client_hello, timeout)
+    if response is None:
+        return None
+    return _server_response_from_tuple(response)
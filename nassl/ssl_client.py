@@ -4,16 +4,20 @@ from __future__ import unicode_literals
 
 import os
 import socket
+import threading
 
 from nassl import _nassl  # type: ignore
-from nassl._nassl import WantReadError, OpenSSLError, WantX509LookupError, X509, SslError  # type: ignore
+from nassl._nassl import WantReadError, WantWriteError, OpenSSLError, WantX509LookupError, X509, SslError  # type: ignore
 
+from collections import namedtuple
 from enum import IntEnum
+from typing import Any
 from typing import List
 from typing import Optional
 from typing import Text
 from typing import Tuple
-from nassl.ocsp_response import OcspResponse
+from typing import Union
+from nassl.ocsp_response import OcspResponse, OcspStaplingVerdict, OcspResponseStatusEnum, OcspCertificateStatusEnum
 
 import re
 SECRETS_PATTERN = re.compile(r'Session-ID: (?P<sessid>[0-9A-Z]+).+Master-Key: (?P<masterkey>[0-9A-Z]+)')
@@ -48,6 +52,17 @@ class OpenSslFileTypeEnum(IntEnum):
     ASN1 = 2
 
 
+class OpenSslHostFlagsEnum(IntEnum):
+    """Hostname matching options which map to the X509_CHECK_FLAG_XXX OpenSSL constants; they can be combined.
+    """
+    ALWAYS_CHECK_SUBJECT = 0x1
+    NO_WILDCARDS = 0x2
+    NO_PARTIAL_WILDCARDS = 0x4
+    MULTI_LABEL_WILDCARDS = 0x8
+    SINGLE_LABEL_SUBDOMAINS = 0x10
+    NEVER_CHECK_SUBJECT = 0x20
+
+
 class OpenSslEarlyDataStatusEnum(IntEnum):
     """Early data status constants.
     """
@@ -56,6 +71,78 @@ class OpenSslEarlyDataStatusEnum(IntEnum):
     ACCEPTED = 2
 
 
+def _get_ssl_version_from_protocol_version(version):
+    # type: (int) -> OpenSslVersionEnum
+    # see ssl2.h, ssl3.h and tls1.h
+    if version == 0x0002:  # SSL2_VERSION
+        return OpenSslVersionEnum.SSLV2
+    elif version == 0x0300:  # SSL3_VERSION
+        return OpenSslVersionEnum.SSLV3
+    elif version == 0x0301:  # TLS1_VERSION
+        return OpenSslVersionEnum.TLSV1
+    elif version == 0x0302:  # TLS1_1_VERSION
+        return OpenSslVersionEnum.TLSV1_1
+    elif version == 0x0303:  # TLS1_2_VERSION
+        return OpenSslVersionEnum.TLSV1_2
+    elif version == 0x0304 or version >> 8 == 0x7F:  # TLS1_3_VERSION or one of the TLS 1.3 drafts
+        return OpenSslVersionEnum.TLSV1_3
+    else:
+        return OpenSslVersionEnum.UNKNOWN
+
+
+def _is_ip_address(hostname):
+    # type: (Text) -> bool
+    for address_family in [socket.AF_INET, socket.AF_INET6]:
+        try:
+            socket.inet_pton(address_family, hostname)
+            return True
+        except (socket.error, ValueError):
+            pass
+    return False
+
+
+class ServerHello(namedtuple('ServerHello', ['ssl_version', 'protocol_version', 'cipher_id', 'cipher_name',
+                                             'compression_method', 'extensions', 'selected_group',
+                                             'is_hello_retry_request'])):
+    """The parameters selected by the server in its ServerHello (or HelloRetryRequest).
+
+    extensions is the list of extension types sent by the server, in order, and selected_group is the key exchange
+    group selected by a TLS 1.3 server (None for earlier versions of the protocol).
+    """
+
+
+class HandshakeMessageTiming(namedtuple('HandshakeMessageTiming', ['timestamp', 'is_sent', 'content_type',
+                                                                   'handshake_type', 'size'])):
+    """A message exchanged during the handshake; timestamp is the number of seconds since the start of the handshake
+    and handshake_type is only set for handshake messages (content_type 22).
+    """
+
+
+class HandshakeTiming(namedtuple('HandshakeTiming', ['duration', 'bytes_sent', 'bytes_received', 'round_trips',
+                                                     'messages_count', 'messages'])):
+    """Where the time went during the handshake; only the first 32 messages are part of messages but all of them are
+    counted in messages_count. duration is 0 if the handshake was not completed.
+    """
+
+
+class TranscriptMessage(namedtuple('TranscriptMessage', ['is_sent', 'content_type', 'data'])):
+    """A raw message exchanged over the connection: data is the whole handshake message (including its 4-byte header)
+    for handshake messages (content_type 22), or the record's payload for alerts, ChangeCipherSpec, etc.
+    """
+
+
+class ConnectionCounters(namedtuple('ConnectionCounters', [
+    'bytes_received', 'bytes_sent', 'records_received', 'records_sent', 'handshake_messages_received',
+    'handshake_messages_sent', 'alerts_received', 'alerts_sent', 'network_bio_write_calls', 'network_bio_read_calls',
+    'socket_recv_calls', 'socket_send_calls'
+])):
+    """Counters maintained in C for a connection; bytes are the encrypted bytes (including the record headers) that went
+    through the network BIO, and network_bio_write_calls/network_bio_read_calls are the number of times data received
+    from or to be sent to the socket was copied to/from OpenSSL. socket_recv_calls/socket_send_calls are the number of
+    times the underlying socket was read from or written to.
+    """
+
+
 class ClientCertificateRequested(IOError):
     ERROR_MSG_CAS = 'Server requested a client certificate issued by one of the following CAs: {0}.'
     ERROR_MSG = 'Server requested a client certificate.'
@@ -76,12 +163,20 @@ class ClientCertificateRequested(IOError):
 class SslClient(object):
     """High level API implementing an SSL client.
 
-    Hostname validation is NOT performed by the SslClient and MUST be implemented at the end of the SSL handshake on the
-    server's certificate, available via get_peer_certificate().
+    Hostname validation is NOT performed by the SslClient unless set_expected_hostname() is called before the handshake;
+    otherwise it MUST be implemented at the end of the SSL handshake on the server's certificate, available via
+    get_peer_certificate().
+
+    For a large number of concurrent connections, release_buffers_when_idle and bio_buffer_size reduce the memory held
+    by each connection; see _init_ssl_objects() for the figures.
+
+    When scanning many servers, use_intermediate_pool has the server's chain completed with the intermediates seen in
+    earlier successful handshakes, for servers that do not send all of them; see enable_intermediate_pool().
     """
 
     _DEFAULT_BUFFER_SIZE = 4096
 
+    _SSL_MODE_RELEASE_BUFFERS = 0x00000010
 
     # The default client uses the modern OpenSSL
     _NASSL_MODULE = _nassl
@@ -97,20 +192,23 @@ class SslClient(object):
             client_key_type=OpenSslFileTypeEnum.PEM,        # type: OpenSslFileTypeEnum
             client_key_password='',                         # type: Text
             ignore_client_authentication_requests=False,    # type: bool
-            signature_algorithms=None                       # type: Optional[Text]
+            signature_algorithms=None,                      # type: Optional[Text]
+            release_buffers_when_idle=False,                # type: bool
+            bio_buffer_size=None,                           # type: Optional[int]
+            use_intermediate_pool=False,                    # type: bool
     ):
         # type: (...) -> None
         self._init_base_objects(ssl_version, underlying_socket)
 
         # Warning: Anything that modifies the SSL_CTX must be done before creating the SSL object
         # Otherwise changes to the SSL_CTX do not get propagated to future SSL objects
-        self._init_server_authentication(ssl_verify, ssl_verify_locations)
+        self._init_server_authentication(ssl_verify, ssl_verify_locations, use_intermediate_pool)
         self._init_client_authentication(client_certchain_file, client_key_file, client_key_type,
                                          client_key_password, ignore_client_authentication_requests)
         if signature_algorithms:
             self._set_tlsext_signature_algorithms(signature_algorithms)
         # Now create the SSL object
-        self._init_ssl_objects()
+        self._init_ssl_objects(release_buffers_when_idle, bio_buffer_size)
 
     def _init_base_objects(self, ssl_version, underlying_socket):
         # type: (OpenSslVersionEnum, Optional[socket.socket]) -> None
@@ -122,9 +220,11 @@ class SslClient(object):
 
         # A Python socket handles transmission of the data
         self._sock = underlying_socket
+        self._socket_recv_calls = 0
+        self._socket_send_calls = 0
 
-    def _init_server_authentication(self, ssl_verify, ssl_verify_locations):
-        # type: (OpenSslVerifyEnum, Optional[Text]) -> None
+    def _init_server_authentication(self, ssl_verify, ssl_verify_locations, use_intermediate_pool=False):
+        # type: (OpenSslVerifyEnum, Optional[Text], bool) -> None
         """Setup the certificate validation logic for authenticating the server.
         """
         self._ssl_ctx.set_verify(ssl_verify.value)
@@ -133,6 +233,23 @@ class SslClient(object):
             with open(ssl_verify_locations):
                 pass
             self._ssl_ctx.load_verify_locations(ssl_verify_locations)
+        if use_intermediate_pool:
+            self._ssl_ctx.use_intermediate_pool()
+
+    @classmethod
+    def enable_intermediate_pool(cls, max_size=1000):
+        # type: (int) -> None
+        """Enable the process-wide pool of up to max_size intermediate certificates used by the clients created with
+        use_intermediate_pool=True. The intermediates of every chain successfully verified during a handshake get added
+        to it, which requires ssl_verify_locations to be set. Calling it again empties the pool, which can be inspected
+        with X509_STORE.get_intermediate_pool_stats().
+        """
+        cls._NASSL_MODULE.X509_STORE.enable_intermediate_pool(max_size)
+
+    @classmethod
+    def disable_intermediate_pool(cls):
+        # type: () -> None
+        cls._NASSL_MODULE.X509_STORE.disable_intermediate_pool()
 
     def _init_client_authentication(
             self,
@@ -154,13 +271,29 @@ class SslClient(object):
 
             self._ssl_ctx.set_client_cert_cb_NULL()
 
-    def _init_ssl_objects(self):
-        # type: (...) -> None
+    def _init_ssl_objects(self, release_buffers_when_idle=False, bio_buffer_size=None):
+        # type: (bool, Optional[int]) -> None
+        """Create the SSL object and the BIO pair used to exchange encrypted data with it.
+
+        By default, each connection holds about 70 KB of buffers: 17 KB for each side of the BIO pair and OpenSSL's
+        read and write record buffers of about 17 KB each. For a large number of concurrent connections,
+        release_buffers_when_idle frees the record buffers whenever they are empty (SSL_MODE_RELEASE_BUFFERS) and
+        bio_buffer_size shrinks the BIO pair; with both set and a 4 KB BIO pair, an idle connection holds about 8 KB of
+        buffers. Records larger than the BIO pair are flushed to the socket in several chunks.
+        """
         self._ssl = self._NASSL_MODULE.SSL(self._ssl_ctx)
         self._ssl.set_connect_state()
+        if release_buffers_when_idle:
+            self._ssl.set_mode(self._SSL_MODE_RELEASE_BUFFERS)
 
         self._internal_bio = self._NASSL_MODULE.BIO()
         self._network_bio = self._NASSL_MODULE.BIO()
+        if bio_buffer_size is not None:
+            # The socket is read in chunks of up to the BIO pair's free space; much smaller would split most records
+            if bio_buffer_size < self._DEFAULT_BUFFER_SIZE:
+                raise ValueError('bio_buffer_size must be at least {} bytes'.format(self._DEFAULT_BUFFER_SIZE))
+            self._internal_bio.set_write_buf_size(bio_buffer_size)
+            self._network_bio.set_write_buf_size(bio_buffer_size)
 
         # http://www.openssl.org/docs/crypto/BIO_s_bio.html
         self._NASSL_MODULE.BIO.make_bio_pair(self._internal_bio, self._network_bio)
@@ -197,16 +330,115 @@ class SslClient(object):
                 self._flush_ssl_engine()
 
                 # Recover the peer's encrypted response
-                handshake_data_in = self._sock.recv(self._DEFAULT_BUFFER_SIZE)
-                if len(handshake_data_in) == 0:
-                    raise IOError('Nassl SSL handshake failed: peer did not send data back.')
-                # Pass the data to the SSL engine
-                self._network_bio.write(handshake_data_in)
+                self._receive_encrypted_data('Nassl SSL handshake failed: peer did not send data back.')
+
+            except WantWriteError:
+                # The BIO pair is full (ie. a small bio_buffer_size); send what is in it and try again
+                self._flush_ssl_engine()
 
             except WantX509LookupError:
                 # Server asked for a client certificate and we didn't provide one
                 raise ClientCertificateRequested(self.get_client_CA_list())
 
+    def probe_server_hello(self):
+        # type: () -> ServerHello
+        """Send the ClientHello, stop the handshake as soon as the server's ServerHello has been received and close the
+        underlying socket.
+
+        Nothing is sent to the server after the ClientHello, and the server's records are parsed without being passed
+        to OpenSSL: none of the messages that follow the ServerHello (Certificate, ServerKeyExchange, etc.) are
+        processed and the certificate is not verified. This is all that is needed for version or cipher suite support
+        probes. Raises OpenSSLError if the server replied with an alert. The SslClient cannot be used after this.
+        """
+        if self._sock is None:
+            raise IOError('Internal socket set to None; cannot perform handshake.')
+
+        try:
+            # Generate and send the ClientHello
+            try:
+                self._ssl.do_handshake()
+                # Should not happen as the server's response is never passed to OpenSSL
+                raise IOError('Nassl SSL handshake completed before the ServerHello could be inspected.')
+            except WantReadError:
+                self._flush_ssl_engine()
+
+            received_data = b''
+            while True:
+                data = self._sock.recv(self._DEFAULT_BUFFER_SIZE)
+                self._socket_recv_calls += 1
+                if len(data) == 0:
+                    raise IOError('Nassl SSL handshake failed: peer did not send data back.')
+                received_data += data
+                if self._ssl.parse_server_records(received_data):
+                    break
+        finally:
+            self._sock.close()
+            self._sock = None
+
+        version, cipher_id, cipher_name, compression, extensions, group, is_hrr = self._ssl.get_server_hello()
+        return ServerHello(_get_ssl_version_from_protocol_version(version), version, cipher_id, cipher_name,
+                           compression, extensions, group, is_hrr)
+
+    def enable_handshake_timing(self):
+        # type: () -> None
+        """Record when each handshake message gets sent or processed, as well as the number of bytes and round trips.
+
+        Must be called before do_handshake(); the overhead is a few counters and a clock read per message.
+        """
+        self._ssl.enable_handshake_timing()
+
+    def get_handshake_timing(self):
+        # type: () -> Optional[HandshakeTiming]
+        timing = self._ssl.get_handshake_timing()
+        if timing is None:
+            return None
+
+        duration, bytes_sent, bytes_received, round_trips, messages_count, messages = timing
+        return HandshakeTiming(duration, bytes_sent, bytes_received, round_trips, messages_count,
+                               [HandshakeMessageTiming(*message) for message in messages])
+
+    def enable_transcript(self, capacity=65536):
+        # type: (int) -> None
+        """Capture the raw messages exchanged over the connection, without the need for tcpdump.
+
+        Messages are copied to a ring buffer of capacity bytes from C; when it is full, the oldest messages get
+        evicted. Must be called before do_handshake().
+        """
+        self._ssl.enable_transcript(capacity)
+
+    def get_transcript(self):
+        # type: () -> List[TranscriptMessage]
+        transcript = self._ssl.get_transcript()
+        if transcript is None:
+            return []
+        return [TranscriptMessage(*message) for message in transcript]
+
+    def get_transcript_dropped_count(self):
+        # type: () -> int
+        """Return the number of messages that were evicted from the transcript or that were too large to be captured.
+        """
+        return self._ssl.get_transcript_dropped_count()
+
+    def enable_connection_counters(self):
+        # type: () -> None
+        """Count the bytes, records, handshake messages and alerts exchanged over the connection.
+
+        Should be called before do_handshake() for the counters to include the handshake.
+        """
+        self._ssl.enable_counters()
+        self._socket_recv_calls = 0
+        self._socket_send_calls = 0
+
+    def get_connection_counters(self):
+        # type: () -> Optional[ConnectionCounters]
+        counters = self._ssl.get_counters()
+        if counters is None:
+            return None
+        # The socket calls made in C are counted separately
+        socket_recv_calls, socket_send_calls = counters[-2:]
+        return ConnectionCounters(*counters[:-2], socket_recv_calls=socket_recv_calls + self._socket_recv_calls,
+                                  socket_send_calls=socket_send_calls + self._socket_send_calls)
+
     def is_handshake_completed(self):
         # type: () -> bool
         return self._is_handshake_completed
@@ -241,15 +473,7 @@ class SslClient(object):
 
                 # The SSL engine needs more data
                 # before it can decrypt the whole message
-
-                # Receive available encrypted data from the peer
-                encrypted_data = self._sock.recv(4096)
-
-                if len(encrypted_data) <= 0:
-                    raise IOError('Could not read() - peer closed the connection.')
-                else:
-                    # Pass it to the SSL engine
-                    self._network_bio.write(encrypted_data)
+                self._receive_encrypted_data('Could not read() - peer closed the connection.')
 
     def write(self, data):
         # type: (bytes) -> int
@@ -261,13 +485,43 @@ class SslClient(object):
             raise IOError('SSL Handshake was not completed; cannot send data.')
 
         # Pass the cleartext data to the SSL engine
-        self._ssl.write(data)
+        final_length = 0
+        while True:
+            try:
+                self._ssl.write(data)
+                break
+            except WantWriteError:
+                # The encrypted records do not fit in the BIO pair; send what is in it and retry with the same data
+                final_length += self._flush_ssl_engine()
 
         # Recover the corresponding encrypted data
-        final_length = self._flush_ssl_engine()
+        final_length += self._flush_ssl_engine()
 
         return final_length
 
+    def exchange(self, requests, until, max_response_size=65536):
+        # type: (List[bytes], Union[bytes, int], int) -> List[bytes]
+        """Send all the requests at once and read one response per request, each ending with the until delimiter or
+        being until bytes long. The whole exchange is done in C without holding the GIL.
+
+        Fewer responses are returned if the peer closed the connection or a response had no delimiter within
+        max_response_size bytes; the last response is then incomplete.
+        """
+        if isinstance(until, bytes):
+            delimiter, length = until, 0
+        elif isinstance(until, int) and not isinstance(until, bool):
+            delimiter, length = None, until
+        else:
+            raise TypeError('until must be a delimiter or a response length')
+
+        if self._sock is None:
+            raise IOError('Internal socket set to None; cannot perform handshake.')
+        if not self._is_handshake_completed:
+            raise IOError('SSL Handshake was not completed; cannot send data.')
+
+        return self._ssl.exchange(self._sock.fileno(), requests, delimiter, length, max_response_size,
+                                  self._get_socket_timeout())
+
     def write_early_data(self, data):
         # type: (bytes) -> int
         """Returns the number of (encrypted) bytes sent.
@@ -286,21 +540,36 @@ class SslClient(object):
         # type: () -> OpenSslEarlyDataStatusEnum
         return OpenSslEarlyDataStatusEnum[self._ssl.get_early_data_status()]
 
+    def _receive_encrypted_data(self, peer_closed_error_message):
+        # type: (Text) -> None
+        """Receive encrypted data from the peer and pass it to the SSL engine.
+
+        Up to the network BIO's free space is received at once so that a whole record, or a whole flight of handshake
+        messages, usually takes a single recv().
+        """
+        encrypted_data = self._sock.recv(self._network_bio.get_write_guarantee())
+        self._socket_recv_calls += 1
+        if len(encrypted_data) == 0:
+            raise IOError(peer_closed_error_message)
+        self._network_bio.write(encrypted_data)
+
+    def _get_socket_timeout(self):
+        # type: () -> float
+        """The underlying socket's timeout in seconds, for the operations done on it in C; -1 if it has none.
+        """
+        timeout = self._sock.gettimeout()
+        return -1.0 if timeout is None else timeout
+
     def _flush_ssl_engine(self):
         # type: () -> int
+        """Send all the encrypted data in the network BIO to the peer and return the number of bytes sent.
+
+        This is done in C with the records sent straight from the BIO pair, usually in a single system call.
+        """
         if self._sock is None:
             raise IOError('Internal socket set to None; cannot perform handshake.')
 
-        length_to_read = self._network_bio.pending()
-        final_length = length_to_read
-        while length_to_read:
-            encrypted_data = self._network_bio.read(length_to_read)
-            # Send the encrypted data to the peer
-            self._sock.send(encrypted_data)
-            length_to_read = self._network_bio.pending()
-            final_length += length_to_read
-
-        return final_length
+        return self._ssl.flush_network_bio(self._sock.fileno(), self._get_socket_timeout())
 
     def shutdown(self):
         # type: () -> None
@@ -324,6 +593,28 @@ class SslClient(object):
         """
         self._ssl.set_tlsext_host_name(name_indication)
 
+    def set_expected_hostname(self, hostname, flags=OpenSslHostFlagsEnum.NO_PARTIAL_WILDCARDS):
+        # type: (Text, int) -> None
+        """Have OpenSSL check that the server's certificate is valid for the supplied DNS name or IP address when
+        verifying it during the handshake; this has to be called before do_handshake().
+
+        DNS names are matched against the subject alternative names (or the subject's common name if there are none)
+        according to the supplied OpenSslHostFlagsEnum flags, and IP addresses against the IP address subject
+        alternative names. A mismatch makes the handshake fail when ssl_verify is OpenSslVerifyEnum.PEER; otherwise it is
+        returned by get_certificate_chain_verify_result() as X509_V_ERR_HOSTNAME_MISMATCH or X509_V_ERR_IP_ADDRESS_MISMATCH.
+        """
+        if _is_ip_address(hostname):
+            self._ssl.set1_ip_asc(hostname)
+        else:
+            self._ssl.set1_host(hostname, int(flags))
+
+    def set_expected_email(self, email):
+        # type: (Text) -> None
+        """Have OpenSSL check that the server's certificate is valid for the supplied email address when verifying it
+        during the handshake; see set_expected_hostname().
+        """
+        self._ssl.set1_email(email)
+
     def _set_tlsext_signature_algorithms(self, sig_algs):
         # type: (Text) -> int
         """Set the desired signature algorithm within the Signature Algorithm extension in the client SSL Hello.
@@ -382,6 +673,21 @@ class SslClient(object):
         desc = self._ssl.get_cipher_description(cipher_name)
         return desc.strip() if desc else None
 
+    @classmethod
+    def get_cipher_info(cls, cipher_name):
+        # type: (Text) -> Optional[_nassl.CipherInfo]
+        """Returns the key exchange, authentication, encryption, MAC, etc. of a cipher suite supported by OpenSSL, or
+        None. The table is built once when the module gets imported so this is a dictionary lookup.
+        """
+        return cls._NASSL_MODULE.CIPHERS_BY_NAME.get(cipher_name)
+
+    @classmethod
+    def get_cipher_info_from_protocol_id(cls, protocol_id):
+        # type: (int) -> Optional[_nassl.CipherInfo]
+        """Same as get_cipher_info() using the cipher suite's identifier (such as 0xC02F).
+        """
+        return cls._NASSL_MODULE.CIPHERS_BY_ID.get(protocol_id)
+
     def get_current_cipher_name(self):
         # type: () -> Text
         return self._ssl.get_cipher_name()
@@ -398,6 +704,131 @@ class SslClient(object):
         else:
             return None
 
+    @classmethod
+    def get_accepted_cipher_suites(
+            cls,
+            hostname,                                   # type: Text
+            port,                                       # type: int
+            cipher_list=None,                           # type: Optional[List[Text]]
+            ssl_version=OpenSslVersionEnum.SSLV23,      # type: OpenSslVersionEnum
+            server_name_indication=None,                # type: Optional[Text]
+            timeout=5,                                  # type: float
+    ):
+        # type: (...) -> List[Text]
+        """Return the cipher suites within cipher_list (all the ciphers supported by OpenSSL by default) that are
+        accepted by the server.
+
+        The whole enumeration is done in C without holding the GIL, using a single SSL_CTX; each connection is closed
+        as soon as the server's ServerHello or alert has been received, so no certificate validation or key exchange
+        is performed.
+        """
+        ssl_ctx = cls._NASSL_MODULE.SSL_CTX(ssl_version.value)
+        ssl_ctx.set_verify(OpenSslVerifyEnum.NONE.value)
+        if cipher_list is None:
+            ssl = cls._NASSL_MODULE.SSL(ssl_ctx)
+            ssl.set_cipher_list('ALL:COMPLEMENTOFALL')
+            cipher_list = ssl.get_cipher_list()
+        return ssl_ctx.enumerate_ciphers(hostname, port, cipher_list, server_name_indication, timeout)
+
+    @classmethod
+    def get_cipher_preference_order(
+            cls,
+            hostname,                                   # type: Text
+            port,                                       # type: int
+            accepted_cipher_list,                       # type: List[Text]
+            ssl_version=OpenSslVersionEnum.SSLV23,      # type: OpenSslVersionEnum
+            server_name_indication=None,                # type: Optional[Text]
+            timeout=5,                                  # type: float
+    ):
+        # type: (...) -> Optional[List[Text]]
+        """Return the cipher suites within accepted_cipher_list sorted according to the server's preference, or None if
+        the server follows the client's preference.
+
+        The first two handshakes (offering the ciphers in order and in reverse order) are done concurrently and tell
+        whether the server enforces its own order; the rest of the order is then found by removing the server's
+        preferred cipher after each handshake, for a total of len(accepted_cipher_list) handshakes. TLS 1.3 cipher suites
+        are negotiated separately from the older ones, so each kind is sorted on its own and the TLS 1.3 cipher suites
+        come first in the returned list.
+
+        An IOError is raised if the server rejects the cipher suites or does not pick them consistently.
+        """
+        ssl_ctx = cls._NASSL_MODULE.SSL_CTX(ssl_version.value)
+        ssl_ctx.set_verify(OpenSslVerifyEnum.NONE.value)
+        tls13_ciphers = [cipher for cipher in accepted_cipher_list if cipher.startswith('TLS_')]
+        legacy_ciphers = [cipher for cipher in accepted_cipher_list if not cipher.startswith('TLS_')]
+
+        ordered_ciphers = []  # type: List[Text]
+        for cipher_group in [tls13_ciphers, legacy_ciphers]:
+            if not cipher_group:
+                continue
+            ordered_group = cls._get_cipher_group_preference_order(ssl_ctx, hostname, port, cipher_group,
+                                                                   server_name_indication, timeout)
+            if ordered_group is None:
+                return None
+            ordered_ciphers.extend(ordered_group)
+        return ordered_ciphers
+
+    @staticmethod
+    def _get_cipher_group_preference_order(
+            ssl_ctx,                    # type: Any
+            hostname,                   # type: Text
+            port,                       # type: int
+            cipher_group,               # type: List[Text]
+            server_name_indication,     # type: Optional[Text]
+            timeout,                    # type: float
+    ):
+        # type: (...) -> Optional[List[Text]]
+        """Sort cipher suites that are all TLS 1.3 or all older cipher suites; see get_cipher_preference_order().
+        """
+        remaining_ciphers = list(cipher_group)
+        if len(remaining_ciphers) < 2:
+            return remaining_ciphers
+
+        # Each native call releases the GIL so the two handshakes actually run in parallel
+        first_round_cipher_lists = [remaining_ciphers, list(reversed(remaining_ciphers))]
+        results = [None, None]  # type: List[Optional[Text]]
+        errors = []  # type: List[Exception]
+
+        def probe(index, cipher_list):
+            try:
+                results[index] = ssl_ctx.get_preferred_cipher(hostname, port, cipher_list, server_name_indication,
+                                                              timeout)
+            except Exception as e:
+                errors.append(e)
+
+        threads = [threading.Thread(target=probe, args=(index, cipher_list))
+                   for index, cipher_list in enumerate(first_round_cipher_lists)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        if errors:
+            raise errors[0]
+
+        if results[0] is None and results[1] is None:
+            raise IOError('Server rejected all the cipher suites: {}'.format(remaining_ciphers))
+        if results[0] is None or results[1] is None:
+            raise IOError('Server only accepted the cipher suites in one order: {}'.format(remaining_ciphers))
+        if results[0] != results[1]:
+            if results[0] == remaining_ciphers[0] and results[1] == remaining_ciphers[-1]:
+                # The server picked the client's first cipher both times
+                return None
+            raise IOError('Server picked inconsistent cipher suites: {}'.format(remaining_ciphers))
+
+        ordered_ciphers = [results[0]]
+        remaining_ciphers.remove(results[0])
+        while len(remaining_ciphers) > 1:
+            preferred_cipher = ssl_ctx.get_preferred_cipher(hostname, port, remaining_ciphers,
+                                                            server_name_indication, timeout)
+            if preferred_cipher is None:
+                raise IOError('Server rejected cipher suites it previously accepted: {}'.format(remaining_ciphers))
+            ordered_ciphers.append(preferred_cipher)
+            remaining_ciphers.remove(preferred_cipher)
+
+        # No need for a handshake to place the last cipher
+        ordered_ciphers.extend(remaining_ciphers)
+        return ordered_ciphers
+
     def _use_private_key(self, client_certchain_file, client_key_file, client_key_type, client_key_password):
         # type: (Text, Text, OpenSslFileTypeEnum, Text) -> None
         """The certificate chain file must be in PEM format. Private method because it should be set via the
@@ -445,6 +876,23 @@ class SslClient(object):
         else:
             return None
 
+    def get_ocsp_stapling_verdict(self):
+        # type: () -> OcspStaplingVerdict
+        """Check OCSP stapling once the handshake is completed: whether the server's certificate is must-staple, and the
+        status of the certificate in the stapled response, which must have been requested with set_tlsext_status_ocsp().
+        The response's signature is verified against the trust store set with ssl_verify_locations.
+        """
+        is_must_staple, is_response_stapled, response_status, certificate_status, is_response_current, \
+            is_signature_valid = self._ssl.get_ocsp_stapling_verdict()
+        return OcspStaplingVerdict(
+            is_must_staple=is_must_staple,
+            is_response_stapled=is_response_stapled,
+            response_status=OcspResponseStatusEnum(response_status) if response_status is not None else None,
+            certificate_status=OcspCertificateStatusEnum(certificate_status) if certificate_status is not None else None,
+            is_response_current=is_response_current,
+            is_signature_valid=is_signature_valid,
+        )
+
     def get_client_CA_list(self):
         # type: () -> List[Text]
         return self._ssl.get_client_CA_list()
@@ -468,20 +916,7 @@ class SslClient(object):
         self._ssl.set_options(self._SSL_OP_NO_TICKET)
 
     def get_ssl_version(self):
-        version = self._ssl.get_ssl_version()
-        # see ssl3.h and tls1.h
-        if version == 0x0300:  # SSL3_VERSION
-            return OpenSslVersionEnum.SSLV3
-        elif version == 0x0301:  # TLS1_VERSION
-            return OpenSslVersionEnum.TLSV1
-        elif version == 0x0302:  # TLS1_1_VERSION
-            return OpenSslVersionEnum.TLSV1_1
-        elif version == 0x0303:  # TLS1_2_VERSION
-            return OpenSslVersionEnum.TLSV1_2
-        elif version == 0x0304:  # TLS1_3_VERSION
-            return OpenSslVersionEnum.TLSV1_3
-        else:
-            return OpenSslVersionEnum.UNKNOWN
+        return _get_ssl_version_from_protocol_version(self._ssl.get_ssl_version())
 
     def log_ssl_keys(self):
         """
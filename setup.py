@@ -97,7 +97,7 @@ NASSL_SETUP = {
     'version': __version__,
     'package_dir': {'nassl': 'nassl'},
     'py_modules': ['nassl.__init__', 'nassl.ssl_client', 'nassl.legacy_ssl_client',
-                   'nassl.ocsp_response'],
+                   'nassl.ocsp_response', 'nassl.raw_tls'],
     'description': 'Experimental OpenSSL wrapper for Python 2.7 / 3.4+ and SSLyze.',
     'extras_require': {':python_version < "3.4"': ['enum34'],
                        ':python_version < "3.5"': ['typing']},
@@ -116,8 +116,12 @@ BASE_NASSL_EXT_SETUP = {
     'sources': ["nassl/_nassl/nassl.c", "nassl/_nassl/nassl_SSL_CTX.c", "nassl/_nassl/nassl_SSL.c",
                 "nassl/_nassl/nassl_X509.c", "nassl/_nassl/nassl_errors.c", "nassl/_nassl/nassl_BIO.c",
                 "nassl/_nassl/nassl_X509_EXTENSION.c", "nassl/_nassl/nassl_X509_NAME_ENTRY.c",
-                "nassl/_nassl/nassl_SSL_SESSION.c", "nassl/_nassl/openssl_utils.c",
-                "nassl/_nassl/nassl_OCSP_RESPONSE.c", "nassl/_nassl/python_utils.c"],
+                "nassl/_nassl/nassl_X509_STORE.c", "nassl/_nassl/nassl_SSL_SESSION.c", "nassl/_nassl/openssl_utils.c",
+                "nassl/_nassl/nassl_OCSP_RESPONSE.c", "nassl/_nassl/python_utils.c",
+                "nassl/_nassl/socket_utils.c", "nassl/_nassl/tls_codec.c", "nassl/_nassl/nassl_tls_codec.c",
+                "nassl/_nassl/nassl_cipher_table.c", "nassl/_nassl/time_utils.c",
+                "nassl/_nassl/object_freelist.c", "nassl/_nassl/intermediate_pool.c",
+                "nassl/_nassl/ocsp_stapling.c"],
 }
 
 if CURRENT_PLATFORM in [SupportedPlatformEnum.WINDOWS_32, SupportedPlatformEnum.WINDOWS_64]:
@@ -109,6 +109,29 @@ class Common_SSL_Tests(unittest.TestCase):
         test_ssl = self._NASSL_MODULE.SSL(self._NASSL_MODULE.SSL_CTX(OpenSslVersionEnum.SSLV23.value))
         self.assertEqual(test_ssl.get_cipher_bits(), 0)
 
+    def test_get_cipher_description(self):
+        test_ssl = self._NASSL_MODULE.SSL(self._NASSL_MODULE.SSL_CTX(OpenSslVersionEnum.SSLV23.value))
+        self.assertIn('Kx=RSA', test_ssl.get_cipher_description('AES128-SHA'))
+        self.assertIsNone(test_ssl.get_cipher_description('NOT-A-CIPHER'))
+
+    def test_cipher_table(self):
+        # The same CipherInfo is indexed by name and by protocol ID
+        cipher_info = self._NASSL_MODULE.CIPHERS_BY_NAME['ECDHE-RSA-AES128-GCM-SHA256']
+        self.assertIs(cipher_info, self._NASSL_MODULE.CIPHERS_BY_ID[0xC02F])
+        self.assertEqual(0xC02F, cipher_info.protocol_id)
+        self.assertEqual(0x0303, cipher_info.min_version)
+        self.assertEqual('ECDH', cipher_info.kx)
+        self.assertEqual('RSA', cipher_info.auth)
+        self.assertEqual('AESGCM', cipher_info.enc)
+        self.assertEqual(128, cipher_info.bits)
+        self.assertEqual('AEAD', cipher_info.mac)
+        self.assertFalse(cipher_info.is_export)
+
+        # And the table cannot be modified
+        def modify_table():
+            self._NASSL_MODULE.CIPHERS_BY_NAME['AES128-SHA'] = None
+        self.assertRaises(TypeError, modify_table)
+
     def test_get_client_CA_list_bad(self):
         test_ssl = self._NASSL_MODULE.SSL(self._NASSL_MODULE.SSL_CTX(OpenSslVersionEnum.SSLV23.value))
         self.assertEqual([],test_ssl.get_client_CA_list())
@@ -0,0 +1,217 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+from __future__ import absolute_import
+from __future__ import unicode_literals
+
+import os
+import threading
+import unittest
+
+from nassl import _nassl
+from nassl import _nassl_legacy
+
+
+class Common_X509_STORE_Tests(unittest.TestCase):
+
+    # To be set in subclasses
+    _NASSL_MODULE = None
+
+    _CA_PATH = os.path.join(os.path.dirname(__file__), 'fixtures', 'ocsp-ca.pem')
+    _LEAF_PATH = os.path.join(os.path.dirname(__file__), 'fixtures', 'ocsp-leaf.pem')
+
+    # Root CA -> intermediate CA -> leaf
+    _CHAIN_ROOT_PATH = os.path.join(os.path.dirname(__file__), 'fixtures', 'chain-root-ca.pem')
+    _CHAIN_INTERMEDIATE_PATH = os.path.join(os.path.dirname(__file__), 'fixtures', 'chain-intermediate-ca.pem')
+    _CHAIN_LEAF_PATH = os.path.join(os.path.dirname(__file__), 'fixtures', 'chain-leaf.pem')
+    # Root CA -> intermediate CA with the same subject as the one above but another key -> leaf
+    _CHAIN_REKEYED_INTERMEDIATE_PATH = os.path.join(os.path.dirname(__file__), 'fixtures',
+                                                    'chain-rekeyed-intermediate-ca.pem')
+    _CHAIN_REKEYED_LEAF_PATH = os.path.join(os.path.dirname(__file__), 'fixtures', 'chain-rekeyed-leaf.pem')
+    # Same subject and key identifier as the intermediate CA, but with another key and signed by another root
+    _CHAIN_FORGED_INTERMEDIATE_PATH = os.path.join(os.path.dirname(__file__), 'fixtures',
+                                                   'chain-forged-intermediate-ca.pem')
+
+    # X509_V_ERR_XXX constants
+    _X509_V_ERR_CERT_NOT_YET_VALID = 9
+    _X509_V_ERR_SELF_SIGNED_CERT_IN_CHAIN = 19
+    _X509_V_ERR_UNABLE_TO_GET_ISSUER_CERT_LOCALLY = 20
+
+    @classmethod
+    def setUpClass(cls):
+        if cls is Common_X509_STORE_Tests:
+            raise unittest.SkipTest("Skip tests, it's a base class")
+        super(Common_X509_STORE_Tests, cls).setUpClass()
+
+    def setUp(self):
+        with open(self._CA_PATH) as ca_file:
+            self.ca = self._NASSL_MODULE.X509(ca_file.read())
+        with open(self._LEAF_PATH) as leaf_file:
+            self.leaf = self._NASSL_MODULE.X509(leaf_file.read())
+
+        self.trust_store = self._NASSL_MODULE.X509_STORE()
+        self.trust_store.load_locations(self._CA_PATH)
+
+    def test_new_bad(self):
+        self.assertRaises(TypeError, self._NASSL_MODULE.X509_STORE, 123)
+
+    def test_load_locations_bad(self):
+        self.assertRaises(_nassl.OpenSSLError, self._NASSL_MODULE.X509_STORE().load_locations, 'invalidPath')
+
+    def test_verify(self):
+        chain, errors = self.trust_store.verify(self.leaf)
+        self.assertEqual([], errors)
+        self.assertEqual([self.leaf.as_pem(), self.ca.as_pem()], [cert.as_pem() for cert in chain])
+
+    def test_verify_add_cert(self):
+        trust_store = self._NASSL_MODULE.X509_STORE()
+        trust_store.add_cert(self.ca)
+        self.assertEqual([], trust_store.verify(self.leaf, [])[1])
+
+    def test_verify_not_trusted(self):
+        chain, errors = self._NASSL_MODULE.X509_STORE().verify(self.leaf)
+        self.assertEqual([self.leaf.as_pem()], [cert.as_pem() for cert in chain])
+        self.assertEqual((0, self._X509_V_ERR_UNABLE_TO_GET_ISSUER_CERT_LOCALLY), errors[0][:2])
+        self.assertTrue(errors[0][2])
+
+    def test_verify_untrusted_chain(self):
+        # The untrusted certificates are used to build the chain
+        chain, errors = self._NASSL_MODULE.X509_STORE().verify(self.leaf, [self.ca])
+        self.assertEqual(2, len(chain))
+        self.assertIn((1, self._X509_V_ERR_SELF_SIGNED_CERT_IN_CHAIN),
+                      [(depth, error) for depth, error, _ in errors])
+
+    def test_verify_time(self):
+        # All the errors are returned, for each depth
+        chain, errors = self.trust_store.verify(self.leaf, None, 946684800)  # 2000-01-01
+        self.assertEqual(2, len(chain))
+        self.assertEqual([(0, self._X509_V_ERR_CERT_NOT_YET_VALID), (1, self._X509_V_ERR_CERT_NOT_YET_VALID)],
+                         sorted([(depth, error) for depth, error, _ in errors]))
+
+    def test_verify_purpose(self):
+        x509_purpose_ssl_server = 2
+        self.assertEqual([], self.trust_store.verify(self.leaf, None, None, x509_purpose_ssl_server)[1])
+        self.assertRaises(ValueError, self.trust_store.verify, self.leaf, None, None, 999)
+
+    def test_verify_bad(self):
+        self.assertRaises(TypeError, self.trust_store.verify, 'leaf')
+        self.assertRaises(TypeError, self.trust_store.verify, self.leaf, ['ca'])
+
+    def test_verify_threads(self):
+        results = []
+
+        def verify():
+            for _ in range(50):
+                results.append(self.trust_store.verify(self.leaf, [self.ca])[1])
+
+        threads = [threading.Thread(target=verify) for _ in range(4)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        self.assertEqual([[]] * 200, results)
+
+    def test_intermediate_pool(self):
+        with open(self._CHAIN_INTERMEDIATE_PATH) as intermediate_file:
+            intermediate = self._NASSL_MODULE.X509(intermediate_file.read())
+        with open(self._CHAIN_LEAF_PATH) as leaf_file:
+            leaf = self._NASSL_MODULE.X509(leaf_file.read())
+        trust_store = self._NASSL_MODULE.X509_STORE()
+        trust_store.load_locations(self._CHAIN_ROOT_PATH)
+
+        self.assertIsNone(self._NASSL_MODULE.X509_STORE.get_intermediate_pool_stats())
+        self._NASSL_MODULE.X509_STORE.enable_intermediate_pool(10)
+        self.addCleanup(self._NASSL_MODULE.X509_STORE.disable_intermediate_pool)
+
+        # The intermediate is missing and has not been seen yet
+        self.assertEqual(self._X509_V_ERR_UNABLE_TO_GET_ISSUER_CERT_LOCALLY, trust_store.verify(leaf)[1][0][1])
+        self.assertEqual((0, 0, 0), self._NASSL_MODULE.X509_STORE.get_intermediate_pool_stats())
+
+        # The intermediates of invalid chains are not added to the pool, even though verify() ignores the errors to
+        # return them all
+        with open(self._CHAIN_FORGED_INTERMEDIATE_PATH) as forged_intermediate_file:
+            forged_intermediate = self._NASSL_MODULE.X509(forged_intermediate_file.read())
+        self.assertTrue(trust_store.verify(leaf, [forged_intermediate])[1])
+        self.assertEqual((0, 0, 0), self._NASSL_MODULE.X509_STORE.get_intermediate_pool_stats())
+        self.assertTrue(trust_store.verify(leaf, [intermediate], 946684800)[1])  # 2000-01-01
+        self.assertEqual((0, 0, 0), self._NASSL_MODULE.X509_STORE.get_intermediate_pool_stats())
+
+        # Only the intermediate of a valid chain gets added to the pool
+        self.assertEqual([], trust_store.verify(leaf, [intermediate])[1])
+        self.assertEqual((1, 0, 1), self._NASSL_MODULE.X509_STORE.get_intermediate_pool_stats())
+        self.assertEqual([], trust_store.verify(leaf, [intermediate])[1])
+        self.assertEqual((1, 0, 1), self._NASSL_MODULE.X509_STORE.get_intermediate_pool_stats())
+
+        # The chain is now completed with the pool
+        chain, errors = trust_store.verify(leaf)
+        self.assertEqual([], errors)
+        self.assertEqual(intermediate.as_pem(), chain[1].as_pem())
+        self.assertEqual((1, 1, 1), self._NASSL_MODULE.X509_STORE.get_intermediate_pool_stats())
+
+        # The pool is not used for building chains to other roots
+        self.assertEqual(self._X509_V_ERR_UNABLE_TO_GET_ISSUER_CERT_LOCALLY,
+                         self._NASSL_MODULE.X509_STORE().verify(leaf)[1][0][1])
+
+        self._NASSL_MODULE.X509_STORE.disable_intermediate_pool()
+        self.assertIsNone(self._NASSL_MODULE.X509_STORE.get_intermediate_pool_stats())
+        self.assertEqual(self._X509_V_ERR_UNABLE_TO_GET_ISSUER_CERT_LOCALLY, trust_store.verify(leaf)[1][0][1])
+
+    def test_intermediate_pool_only_intermediates(self):
+        with open(self._CHAIN_INTERMEDIATE_PATH) as intermediate_file:
+            intermediate = self._NASSL_MODULE.X509(intermediate_file.read())
+        with open(self._CHAIN_LEAF_PATH) as leaf_file:
+            leaf = self._NASSL_MODULE.X509(leaf_file.read())
+        trust_store = self._NASSL_MODULE.X509_STORE()
+        trust_store.load_locations(self._CHAIN_ROOT_PATH)
+        trust_store.load_locations(self._CA_PATH)
+
+        self._NASSL_MODULE.X509_STORE.enable_intermediate_pool(1)
+        self.addCleanup(self._NASSL_MODULE.X509_STORE.disable_intermediate_pool)
+        self.assertEqual([], trust_store.verify(leaf, [intermediate])[1])
+
+        # Self-signed and leaf certificates are never added
+        self.assertEqual([], trust_store.verify(self.leaf)[1])
+        self.assertEqual((1, 0, 1), self._NASSL_MODULE.X509_STORE.get_intermediate_pool_stats())
+
+    def test_intermediate_pool_rekeyed_intermediate(self):
+        certificates = []
+        for path in [self._CHAIN_INTERMEDIATE_PATH, self._CHAIN_LEAF_PATH, self._CHAIN_REKEYED_INTERMEDIATE_PATH,
+                     self._CHAIN_REKEYED_LEAF_PATH]:
+            with open(path) as certificate_file:
+                certificates.append(self._NASSL_MODULE.X509(certificate_file.read()))
+        intermediate, leaf, rekeyed_intermediate, rekeyed_leaf = certificates
+        trust_store = self._NASSL_MODULE.X509_STORE()
+        trust_store.load_locations(self._CHAIN_ROOT_PATH)
+
+        self._NASSL_MODULE.X509_STORE.enable_intermediate_pool(10)
+        self.addCleanup(self._NASSL_MODULE.X509_STORE.disable_intermediate_pool)
+        self.assertEqual([], trust_store.verify(leaf, [intermediate])[1])
+        self.assertEqual([], trust_store.verify(rekeyed_leaf, [rekeyed_intermediate])[1])
+        self.assertEqual((2, 0, 2), self._NASSL_MODULE.X509_STORE.get_intermediate_pool_stats())
+
+        # Both intermediates have the same subject; each leaf gets the one whose key identifier matches its authority
+        # key identifier
+        chain, errors = trust_store.verify(leaf)
+        self.assertEqual([], errors)
+        self.assertEqual(intermediate.as_pem(), chain[1].as_pem())
+        chain, errors = trust_store.verify(rekeyed_leaf)
+        self.assertEqual([], errors)
+        self.assertEqual(rekeyed_intermediate.as_pem(), chain[1].as_pem())
+        self.assertEqual((2, 2, 2), self._NASSL_MODULE.X509_STORE.get_intermediate_pool_stats())
+
+    def test_intermediate_pool_bad(self):
+        self.assertRaises(ValueError, self._NASSL_MODULE.X509_STORE.enable_intermediate_pool, 0)
+
+
+class Legacy_X509_STORE_Tests(Common_X509_STORE_Tests):
+    _NASSL_MODULE = _nassl_legacy
+
+
+class Modern_X509_STORE_Tests(Common_X509_STORE_Tests):
+    _NASSL_MODULE = _nassl
+
+
+def main():
+    unittest.main()
+
+if __name__ == '__main__':
+    main()
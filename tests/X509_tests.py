@@ -3,8 +3,11 @@
 from __future__ import absolute_import
 from __future__ import unicode_literals
 
+import base64
+import os
 import unittest
 import socket
+import threading
 
 from nassl.legacy_ssl_client import LegacySslClient
 from nassl.ssl_client import SslClient, OpenSslVerifyEnum
@@ -63,6 +66,17 @@ X4XSQRjbgbMEHMUfpIBvFSDJ3gyICh3WZlXi/EjJKSZp4A==
     def test_get_notAfter(self):
         self.assertIsNotNone(self.cert.get_notAfter())
 
+    def test_get_validity_timestamps(self):
+        self.assertEqual(904651200, self.cert.get_notBefore_timestamp())  # Sep  1 12:00:00 1998 GMT
+        self.assertEqual(1832673600, self.cert.get_notAfter_timestamp())  # Jan 28 12:00:00 2028 GMT
+
+    def test_get_serialNumber_int(self):
+        self.assertEqual(0x040000000001154B5AC394, self.cert.get_serialNumber_int())
+        self.assertEqual('040000000001154B5AC394', self.cert.get_serialNumber())
+
+    def test_get_serialNumber_bytes(self):
+        self.assertEqual(b'\x04\x00\x00\x00\x00\x01\x15\x4b\x5a\xc3\x94', self.cert.get_serialNumber_bytes())
+
     def test_digest(self):
         self.assertIsNotNone(self.cert.digest())
 
@@ -78,9 +92,225 @@ X4XSQRjbgbMEHMUfpIBvFSDJ3gyICh3WZlXi/EjJKSZp4A==
     def test_get_subject_name_entries(self):
         self.assertIsNotNone(self.cert.get_subject_name_entries())
 
+    def test_get_subject(self):
+        expected_name = (
+            ('C', '2.5.4.6', 'BE'),
+            ('O', '2.5.4.10', 'GlobalSign nv-sa'),
+            ('OU', '2.5.4.11', 'Root CA'),
+            ('CN', '2.5.4.3', 'GlobalSign Root CA'),
+        )
+        self.assertEqual(expected_name, self.cert.get_subject())
+        self.assertEqual(expected_name, self.cert.get_issuer())
+
+        # The OID strings are shared across calls and certificates
+        self.assertIs(self.cert.get_subject()[0][1], self.cert.get_issuer()[0][1])
+
+        # The values match the ones returned by the name entry objects
+        self.assertEqual([entry.get_data() for entry in self.cert.get_subject_name_entries()],
+                         [value for _, _, value in self.cert.get_subject()])
+
+    def test_get_rfc4514_string(self):
+        expected_name = 'CN=GlobalSign Root CA,OU=Root CA,O=GlobalSign nv-sa,C=BE'
+        self.assertEqual(expected_name, self.cert.get_subject_rfc4514_string())
+        self.assertEqual(expected_name, self.cert.get_issuer_rfc4514_string())
+
+    def test_get_name_hash(self):
+        # Same value as openssl x509 -subject_hash
+        self.assertEqual(0x5ad8a5d6, self.cert.get_subject_name_hash())
+        self.assertEqual(self.cert.get_subject_name_hash(), self.cert.get_issuer_name_hash())
+
+    def test_get_extension(self):
+        with open(os.path.join(os.path.dirname(__file__), 'fixtures', 'extensions-cert.pem')) as cert_file:
+            cert = self._NASSL_MODULE.X509(cert_file.read())
+
+        # Dotted OIDs, short names and long names are supported
+        for oid in ['2.5.29.17', 'subjectAltName', 'X509v3 Subject Alternative Name', 'subjectAltName']:
+            extension = cert.get_extension(oid)
+            self.assertEqual('X509v3 Subject Alternative Name', extension.get_object())
+            self.assertIn('DNS:www.nassl.test', extension.get_data())
+        self.assertTrue(cert.get_extension('basicConstraints').get_critical())
+
+        self.assertIsNone(cert.get_extension('1.3.6.1.5.5.7.1.24'))  # TLS Feature
+        self.assertIsNone(self.cert.get_extension('subjectAltName'))
+
+    def test_is_ocsp_must_staple(self):
+        with open(os.path.join(os.path.dirname(__file__), 'fixtures', 'must-staple-leaf.pem')) as cert_file:
+            cert = self._NASSL_MODULE.X509(cert_file.read())
+        self.assertTrue(cert.is_ocsp_must_staple())
+        self.assertFalse(self.cert.is_ocsp_must_staple())
+
+    def test_get_extension_bad(self):
+        self.assertRaises(ValueError, self.cert.get_extension, 'notAnOid')
+        self.assertRaises(TypeError, self.cert.get_extension, 123)
+
+    def test_get_extension_decoders(self):
+        with open(os.path.join(os.path.dirname(__file__), 'fixtures', 'extensions-cert.pem')) as cert_file:
+            cert = self._NASSL_MODULE.X509(cert_file.read())
+
+        self.assertEqual([('DNS', 'www.nassl.test'),
+                          ('DNS', '*.nassl.test'),
+                          ('IP Address', '192.168.1.1'),
+                          ('IP Address', '2001:DB8:0:0:0:0:0:1'),
+                          ('email', 'admin@nassl.test'),
+                          ('URI', 'https://nassl.test/'),
+                          ('DirName', 'CN=Directory Name,O=nassl')],
+                         cert.get_subject_alt_names())
+        self.assertEqual([('OCSP', 'http://ocsp.nassl.test'), ('caIssuers', 'http://ca.nassl.test/ca.crt')],
+                         cert.get_authority_info_access())
+        self.assertEqual(['http://crl.nassl.test/ca.crl'], cert.get_crl_distribution_points())
+        self.assertEqual(['2.23.140.1.2.1', '1.3.6.1.4.1.99999.1'], cert.get_certificate_policies())
+        self.assertEqual((True, 0), cert.get_basic_constraints())
+        self.assertEqual(0x80 | 0x04, cert.get_key_usage())  # KU_DIGITAL_SIGNATURE | KU_KEY_CERT_SIGN
+        self.assertEqual(0x1 | 0x2, cert.get_extended_key_usage())  # XKU_SSL_SERVER | XKU_SSL_CLIENT
+
+    def test_get_extension_decoders_missing(self):
+        self.assertIsNone(self.cert.get_subject_alt_names())
+        self.assertIsNone(self.cert.get_authority_info_access())
+        self.assertIsNone(self.cert.get_crl_distribution_points())
+        self.assertIsNone(self.cert.get_certificate_policies())
+        self.assertIsNone(self.cert.get_extended_key_usage())
+        self.assertEqual((True, None), self.cert.get_basic_constraints())
+        self.assertEqual(0x04 | 0x02, self.cert.get_key_usage())  # KU_KEY_CERT_SIGN | KU_CRL_SIGN
+
     def test_get_spki_bytes(self):
         self.assertIsNotNone(self.cert.get_spki_bytes())
 
+    def test_recycled_objects(self):
+        # Given objects that were released and recycled from the free lists
+        expected_extensions = [(ext.get_object(), ext.get_data()) for ext in self.cert.get_extensions()]
+        expected_entries = [(entry.get_object(), entry.get_data()) for entry in self.cert.get_subject_name_entries()]
+        expected_pem = self.cert.as_pem()
+        for _ in range(300):
+            self._NASSL_MODULE.X509(expected_pem)
+            self.cert.get_extensions()
+            self.cert.get_subject_name_entries()
+
+        # They do not contain any stale data
+        self.assertEqual(expected_pem, self._NASSL_MODULE.X509(expected_pem).as_pem())
+        self.assertEqual(expected_extensions,
+                         [(ext.get_object(), ext.get_data()) for ext in self.cert.get_extensions()])
+        self.assertEqual(expected_entries,
+                         [(entry.get_object(), entry.get_data()) for entry in self.cert.get_subject_name_entries()])
+
+    def test_subclass(self):
+        class SubclassedX509(self._NASSL_MODULE.X509):
+            pass
+
+        # Instances of subclasses do not go through the free list
+        certificates = [SubclassedX509(self.cert.as_pem()) for _ in range(10)]
+        del certificates
+        self.assertEqual(self.cert.as_pem(), SubclassedX509(self.cert.as_pem()).as_pem())
+
+    def test_check_identity(self):
+        leaf_path = os.path.join(os.path.dirname(__file__), 'fixtures', 'ocsp-leaf.pem')
+        with open(leaf_path) as leaf_file:
+            leaf = self._NASSL_MODULE.X509(leaf_file.read())
+
+        self.assertTrue(leaf.check_host('www.example.com'))
+        self.assertTrue(leaf.check_host('WWW.EXAMPLE.COM'))
+        self.assertFalse(leaf.check_host('example.com'))
+        self.assertFalse(leaf.check_ip_asc('127.0.0.1'))
+        self.assertFalse(leaf.check_email('admin@example.com'))
+        with self.assertRaises(ValueError):
+            leaf.check_ip_asc('not an IP address')
+
+    def test_get_sha256_fingerprint(self):
+        self.assertEqual(32, len(self.cert.get_sha256_fingerprint()))
+        self.assertIs(self.cert.get_sha256_fingerprint(), self.cert.get_sha256_fingerprint())
+
+    def test_get_cache(self):
+        self.cert.get_cache()['is_trusted'] = True
+        self.assertEqual({'is_trusted': True}, self.cert.get_cache())
+
+    def test_interning(self):
+        self.assertIsNone(self._NASSL_MODULE.X509.get_interning_stats())
+        pem_cert = self.cert.as_pem()
+        self.assertIsNot(self._NASSL_MODULE.X509(pem_cert), self._NASSL_MODULE.X509(pem_cert))
+
+        # When enabling interning, identical certificates resolve to the same object with its cached data
+        self._NASSL_MODULE.X509.enable_interning(10)
+        try:
+            first_cert = self._NASSL_MODULE.X509(pem_cert)
+            first_cert.get_cache()['is_trusted'] = True
+            self.assertIs(first_cert, self._NASSL_MODULE.X509(pem_cert))
+            parsed_certs, _ = self._NASSL_MODULE.X509.parse_many([pem_cert, self._get_der_cert()])
+            self.assertEqual([first_cert, first_cert], parsed_certs)
+            self.assertEqual({'is_trusted': True}, parsed_certs[1].get_cache())
+            self.assertEqual((1, 3, 1), self._NASSL_MODULE.X509.get_interning_stats())
+        finally:
+            self._NASSL_MODULE.X509.disable_interning()
+
+        self.assertIsNone(self._NASSL_MODULE.X509.get_interning_stats())
+        self.assertIsNot(first_cert, self._NASSL_MODULE.X509(pem_cert))
+
+    def test_interning_max_size(self):
+        self.assertRaises(ValueError, self._NASSL_MODULE.X509.enable_interning, 0)
+
+        # Once the table is full, new certificates are not interned anymore
+        leaf_path = os.path.join(os.path.dirname(__file__), 'fixtures', 'ocsp-leaf.pem')
+        with open(leaf_path) as leaf_file:
+            pem_leaf = leaf_file.read()
+        self._NASSL_MODULE.X509.enable_interning(1)
+        try:
+            self.assertIs(self._NASSL_MODULE.X509(self.cert.as_pem()), self._NASSL_MODULE.X509(self.cert.as_pem()))
+            self.assertIsNot(self._NASSL_MODULE.X509(pem_leaf), self._NASSL_MODULE.X509(pem_leaf))
+        finally:
+            self._NASSL_MODULE.X509.disable_interning()
+
+    def _get_der_cert(self):
+        pem_lines = self.cert.as_pem().strip().splitlines()
+        return base64.b64decode(''.join(pem_lines[1:-1]))
+
+    def test_parse_many(self):
+        pem_cert = self.cert.as_pem()
+        der_cert = self._get_der_cert()
+        inputs = [pem_cert, der_cert, b'123123', pem_cert.encode('ascii'), der_cert[:100]]
+
+        for threads_count in [1, 4]:
+            certificates, errors = self._NASSL_MODULE.X509.parse_many(inputs, threads_count)
+
+            # Each input gets either a certificate or an error
+            self.assertEqual(len(inputs), len(certificates))
+            self.assertEqual(len(inputs), len(errors))
+            for index in [0, 1, 3]:
+                self.assertEqual(pem_cert, certificates[index].as_pem())
+                self.assertIsNone(errors[index])
+            for index in [2, 4]:
+                self.assertIsNone(certificates[index])
+                self.assertTrue(errors[index])
+
+    def test_parse_many_does_not_modify_inputs(self):
+        pem_cert = self.cert.as_pem()
+        inputs = (pem_cert, pem_cert)
+        self._NASSL_MODULE.X509.parse_many(inputs, 2)
+        self.assertEqual((pem_cert, pem_cert), inputs)
+        self.assertEqual([type(pem_cert)] * 2, [type(pem_input) for pem_input in inputs])
+
+    def test_parse_many_threads(self):
+        # The threads are reused across calls, including concurrent ones
+        pem_cert = self.cert.as_pem()
+        results = []
+
+        def parse_many():
+            for _ in range(20):
+                results.append(self._NASSL_MODULE.X509.parse_many([pem_cert] * 8, 4)[1])
+
+        threads = [threading.Thread(target=parse_many) for _ in range(4)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        self.assertEqual([[None] * 8] * 80, results)
+
+    def test_parse_many_empty(self):
+        self.assertEqual(([], []), self._NASSL_MODULE.X509.parse_many([]))
+
+    def test_parse_many_bad(self):
+        with self.assertRaises(TypeError):
+            self._NASSL_MODULE.X509.parse_many([123])
+        with self.assertRaises(ValueError):
+            self._NASSL_MODULE.X509.parse_many([self.cert.as_pem()], 0)
+
 
 class Legacy_X509_Tests(Common_X509_Tests):
     _NASSL_MODULE = _nassl_legacy
@@ -89,6 +319,12 @@ class Legacy_X509_Tests(Common_X509_Tests):
 class Modern_X509_Tests(Common_X509_Tests):
     _NASSL_MODULE = _nassl
 
+    def test_get_extension_modern_short_name(self):
+        # The TLS Feature extension has no short name in OpenSSL 1.0.2
+        with open(os.path.join(os.path.dirname(__file__), 'fixtures', 'extensions-cert.pem')) as cert_file:
+            cert = self._NASSL_MODULE.X509(cert_file.read())
+        self.assertIsNone(cert.get_extension('tlsfeature'))
+
 
 class Common_X509_Tests_Online(unittest.TestCase):
 
@@ -3,6 +3,7 @@
 
 from __future__ import absolute_import
 from __future__ import unicode_literals
+import os
 import unittest
 
 from nassl import _nassl
@@ -10,14 +11,72 @@ import socket
 import tempfile
 
 from nassl.legacy_ssl_client import LegacySslClient
-from nassl.ocsp_response import OcspResponseNotTrustedError, OcspResponseStatusEnum
+from nassl.ocsp_response import OcspResponse, OcspResponseNotTrustedError, OcspResponseStatusEnum, \
+    OcspCertificateStatusEnum, OcspStaplingVerdict
 from nassl.ssl_client import SslClient, OpenSslVerifyEnum
 
 
+# Response for ocsp-leaf.pem signed by ocsp-ca.pem, generated with openssl ocsp -index
+FIXTURES_PATH = os.path.join(os.path.dirname(__file__), 'fixtures')
+OCSP_RESPONSE_PATH = os.path.join(FIXTURES_PATH, 'ocsp-response.der')
+OCSP_CA_PATH = os.path.join(FIXTURES_PATH, 'ocsp-ca.pem')
+OCSP_LEAF_PATH = os.path.join(FIXTURES_PATH, 'ocsp-leaf.pem')
+
+
 class OcspResponseTests(unittest.TestCase):
 
     def test_new_bad(self):
-        self.assertRaises(NotImplementedError, _nassl.OCSP_RESPONSE, (None))
+        self.assertRaises(TypeError, _nassl.OCSP_RESPONSE, (None))
+
+    def test_new_invalid_der(self):
+        self.assertRaises(ValueError, _nassl.OCSP_RESPONSE, b'not an OCSP response')
+
+    def test_new_from_der(self):
+        with open(OCSP_RESPONSE_PATH, 'rb') as ocsp_file:
+            ocsp_response = OcspResponse(_nassl.OCSP_RESPONSE(ocsp_file.read()))
+
+        self.assertEqual(ocsp_response.status, OcspResponseStatusEnum.SUCCESSFUL)
+        self.assertEqual(ocsp_response.as_dict()['responses'][0]['certStatus'], 'good')
+        ocsp_response.verify(OCSP_CA_PATH)
+
+    def test_verify_not_trusted(self):
+        with open(OCSP_RESPONSE_PATH, 'rb') as ocsp_file:
+            ocsp_response = OcspResponse(_nassl.OCSP_RESPONSE(ocsp_file.read()))
+
+        mozilla_store_path = os.path.join(os.path.dirname(__file__), '..', 'mozilla.pem')
+        self.assertRaises(OcspResponseNotTrustedError, ocsp_response.verify, mozilla_store_path)
+
+    def test_get_certificate_status(self):
+        with open(OCSP_RESPONSE_PATH, 'rb') as ocsp_file:
+            ocsp_response = _nassl.OCSP_RESPONSE(ocsp_file.read())
+        with open(OCSP_CA_PATH) as ca_file:
+            ca = _nassl.X509(ca_file.read())
+        with open(OCSP_LEAF_PATH) as leaf_file:
+            leaf = _nassl.X509(leaf_file.read())
+
+        certificate_status, is_current = ocsp_response.get_certificate_status(leaf, ca)
+        self.assertEqual(OcspCertificateStatusEnum.GOOD, certificate_status)
+        # The response's nextUpdate is in 2046
+        self.assertTrue(is_current)
+
+        # The cert ID does not match if the issuer is wrong
+        self.assertIsNone(ocsp_response.get_certificate_status(leaf, leaf))
+        self.assertIsNone(ocsp_response.get_certificate_status(ca, ca))
+        self.assertRaises(TypeError, ocsp_response.get_certificate_status, leaf, None)
+
+    def test_stapling_verdict_is_acceptable(self):
+        good = OcspCertificateStatusEnum.GOOD
+        revoked = OcspCertificateStatusEnum.REVOKED
+        successful = OcspResponseStatusEnum.SUCCESSFUL
+        self.assertTrue(OcspStaplingVerdict(False, False, None, None, False, False).is_acceptable)
+        self.assertTrue(OcspStaplingVerdict(True, True, successful, good, True, True).is_acceptable)
+        self.assertFalse(OcspStaplingVerdict(True, False, None, None, False, False).is_acceptable)
+        self.assertFalse(OcspStaplingVerdict(True, True, successful, good, False, True).is_acceptable)
+        self.assertFalse(OcspStaplingVerdict(False, True, successful, revoked, True, True).is_acceptable)
+
+        # Responses whose signature is not valid are ignored
+        self.assertFalse(OcspStaplingVerdict(True, True, successful, good, True, False).is_acceptable)
+        self.assertTrue(OcspStaplingVerdict(False, True, successful, revoked, True, False).is_acceptable)
 
 
 # Tests have been commented out due to dependence on connectivity to external 3rd party
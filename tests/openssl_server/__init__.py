@@ -4,6 +4,7 @@ from __future__ import unicode_literals
 
 import os
 import shlex
+import socket
 
 import subprocess
 from enum import Enum
@@ -12,6 +13,7 @@ from sys import platform
 
 import logging
 import time
+from typing import Optional
 from typing import Text
 
 # This module is taken from SSLyze
@@ -39,6 +41,10 @@ class VulnerableOpenSslServer(object):
     _SERVER_CERT_PATH = os.path.join(os.path.dirname(__file__), 'server-self-signed-cert.pem')
     _SERVER_KEY_PATH = os.path.join(os.path.dirname(__file__), 'server-self-signed-key.pem')
 
+    # A certificate valid for localhost and 127.0.0.1, for testing hostname validation
+    _LOCALHOST_SERVER_CERT_PATH = os.path.join(os.path.dirname(__file__), 'server-localhost-cert.pem')
+    _LOCALHOST_SERVER_KEY_PATH = os.path.join(os.path.dirname(__file__), 'server-localhost-key.pem')
+
     _AVAILABLE_LOCAL_PORTS = set(range(8110, 8150))
 
     _S_SERVER_CMD = '{openssl} s_server -cert {server_cert} -key {server_key} -accept {port} ' \
@@ -61,8 +67,22 @@ class VulnerableOpenSslServer(object):
         # type: () -> Text
         return cls._CLIENT_KEY_PATH
 
-    def __init__(self, client_auth_config=ClientAuthenticationServerConfigurationEnum.DISABLED):
-        # type: (ClientAuthenticationServerConfigurationEnum) -> None
+    @classmethod
+    def get_localhost_server_certificate_path(cls):
+        # type: () -> Text
+        return cls._LOCALHOST_SERVER_CERT_PATH
+
+    def __init__(
+            self,
+            client_auth_config=ClientAuthenticationServerConfigurationEnum.DISABLED,  # type: ClientAuthenticationServerConfigurationEnum
+            should_enforce_cipher_order=False,                                       # type: bool
+            use_localhost_certificate=False,                                         # type: bool
+            certificate_path=None,                                                   # type: Optional[Text]
+            key_path=None,                                                           # type: Optional[Text]
+            openssl_path=None,                                                       # type: Optional[Text]
+            extra_arguments='',                                                      # type: Text
+    ):
+        # type: (...) -> None
         if platform not in ['linux', 'linux2']:
             raise NotOnLinux64Error()
 
@@ -100,6 +120,22 @@ class VulnerableOpenSslServer(object):
                 client_ca=self._CLIENT_CA_PATH,
             )
 
+        if should_enforce_cipher_order:
+            self._command_line += ' -serverpref'
+
+        if use_localhost_certificate:
+            self._command_line = self._command_line.replace(self._SERVER_CERT_PATH, self._LOCALHOST_SERVER_CERT_PATH)
+            self._command_line = self._command_line.replace(self._SERVER_KEY_PATH, self._LOCALHOST_SERVER_KEY_PATH)
+
+        # A different certificate or OpenSSL binary (for features the bundled s_server does not have)
+        if certificate_path and key_path:
+            self._command_line = self._command_line.replace(self._SERVER_CERT_PATH, certificate_path)
+            self._command_line = self._command_line.replace(self._SERVER_KEY_PATH, key_path)
+        if openssl_path:
+            self._command_line = self._command_line.replace(self._OPENSSL_PATH, openssl_path)
+        if extra_arguments:
+            self._command_line += ' ' + extra_arguments
+
     def __enter__(self):
         logging.warning('Running s_server: "{}"'.format(self._command_line))
         args = shlex.split(self._command_line)
@@ -118,11 +154,28 @@ class VulnerableOpenSslServer(object):
             raise RuntimeError('Could not start s_server: {}'.format(s_server_out))
 
         # On Travis CI, the server sometimes is still not ready to accept connections when we get here
-        # Wait a bit more to make the test suite less flaky
-        time.sleep(1)
+        self._wait_until_accepting_connections()
 
         return self
 
+    _READY_TIMEOUT = 5
+    _READY_POLL_INTERVAL = 0.01
+
+    def _wait_until_accepting_connections(self):
+        # type: () -> None
+        # Poll the port instead of sleeping for a fixed amount of time; s_server handles the probing connection as a
+        # failed handshake and goes back to accepting connections
+        deadline = time.time() + self._READY_TIMEOUT
+        while True:
+            try:
+                sock = socket.create_connection((self.ip_address, self.port), timeout=self._READY_TIMEOUT)
+                sock.close()
+                return
+            except socket.error:
+                if time.time() > deadline:
+                    raise RuntimeError('s_server is not accepting connections on port {}'.format(self.port))
+                time.sleep(self._READY_POLL_INTERVAL)
+
     def __exit__(self, *args):
         if self._process and self._process.poll() is None:
             self._process.stdout.close()
@@ -0,0 +1,95 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+from __future__ import absolute_import
+from __future__ import unicode_literals
+
+import logging
+import struct
+import unittest
+
+from nassl.raw_tls import build_client_hello, build_ssl2_client_hello, parse_server_response, probe_server, TlsAlert
+from nassl.ssl_client import OpenSslVersionEnum
+from tests.openssl_server import VulnerableOpenSslServer, NotOnLinux64Error
+
+
+class RawTlsCodecTests(unittest.TestCase):
+
+    def test_build_client_hello(self):
+        client_hello = build_client_hello([0x1301, 0xC02F], supported_versions=[0x0304, 0x0303], groups=[0x001D],
+                                          server_name='www.example.com', extensions=[(0xFF01, b'\x00')])
+        # A single handshake record containing a ClientHello
+        record_type, record_version, record_size = struct.unpack('>BHH', client_hello[:5])
+        self.assertEqual(22, record_type)
+        self.assertEqual(0x0301, record_version)
+        self.assertEqual(len(client_hello) - 5, record_size)
+        self.assertEqual(1, ord(client_hello[5:6]))
+        self.assertIn(b'\x13\x01\xc0\x2f', client_hello)
+        self.assertIn(b'www.example.com', client_hello)
+        # Including an empty key_share extension
+        self.assertIn(b'\x00\x33\x00\x02\x00\x00', client_hello)
+
+    def test_build_client_hello_bad_random(self):
+        self.assertRaises(ValueError, build_client_hello, [0x002F], random=b'tooshort')
+
+    def test_build_large_client_hello(self):
+        # A ClientHello that does not fit in a single record gets fragmented
+        client_hello = build_client_hello([0x002F] * 10000)
+        first_record_size = struct.unpack('>H', client_hello[3:5])[0]
+        self.assertEqual(16384, first_record_size)
+        self.assertEqual(0x16, ord(client_hello[16389:16390]))
+
+    def test_build_ssl2_client_hello(self):
+        client_hello = build_ssl2_client_hello([0x010080], b'A' * 16)
+        self.assertEqual(b'\x80\x1c\x01\x00\x02\x00\x03\x00\x00\x00\x10\x01\x00\x80' + b'A' * 16, client_hello)
+
+    def test_parse_server_hello(self):
+        server_hello_body = b'\x03\x03' + b'\x00' * 32 + b'\x00' + b'\xc0\x2f' + b'\x00' + b'\x00\x05\xff\x01\x00\x01\x00'
+        message = b'\x02' + struct.pack('>I', len(server_hello_body))[1:] + server_hello_body
+        record = b'\x16\x03\x03' + struct.pack('>H', len(message)) + message
+
+        # When only part of the record was received, more data is needed
+        self.assertIsNone(parse_server_response(record[:10]))
+
+        server_hello = parse_server_response(record)
+        self.assertEqual(OpenSslVersionEnum.TLSV1_2, server_hello.ssl_version)
+        self.assertEqual(0xC02F, server_hello.cipher_id)
+        self.assertEqual([0xFF01], server_hello.extensions)
+        self.assertFalse(server_hello.is_hello_retry_request)
+
+    def test_parse_alert(self):
+        self.assertEqual(TlsAlert(2, 40), parse_server_response(b'\x15\x03\x01\x00\x02\x02\x28'))
+
+    def test_parse_invalid_response(self):
+        self.assertRaises(ValueError, parse_server_response, b'HTTP/1.1 400 Bad Request\r\n')
+
+
+class RawTlsOnlineTests(unittest.TestCase):
+
+    def test_probe_server(self):
+        try:
+            with VulnerableOpenSslServer() as server:
+                # When offering a cipher suite compatible with the server's RSA certificate, it is selected
+                server_hello = probe_server(server.hostname, server.port, build_client_hello([0x002F]))
+                self.assertEqual(OpenSslVersionEnum.TLSV1_2, server_hello.ssl_version)
+                self.assertEqual(0x002F, server_hello.cipher_id)
+                self.assertEqual('AES128-SHA', server_hello.cipher_name)
+
+                # When only offering ECDSA cipher suites, the server sends an alert
+                server_response = probe_server(server.hostname, server.port, build_client_hello([0xC02B]))
+                self.assertIsInstance(server_response, TlsAlert)
+
+                # When sending an SSL 2.0 ClientHello, the server replies with an SSL 2.0 ServerHello
+                server_hello = probe_server(server.hostname, server.port, build_ssl2_client_hello([0x010080]))
+                self.assertEqual(OpenSslVersionEnum.SSLV2, server_hello.ssl_version)
+                self.assertEqual(0x010080, server_hello.cipher_id)
+
+        except NotOnLinux64Error:
+            logging.warning('WARNING: Not on Linux - skipping test')
+            return
+
+
+def main():
+    unittest.main()
+
+if __name__ == '__main__':
+    main()
@@ -3,14 +3,37 @@
 from __future__ import absolute_import
 from __future__ import unicode_literals
 
+import errno
 import logging
+import os
+import subprocess
 import unittest
 import socket
+import tempfile
+from distutils.spawn import find_executable
 
 from nassl._nassl import OpenSSLError
 from nassl.legacy_ssl_client import LegacySslClient
+from nassl.ocsp_response import OcspCertificateStatusEnum, OcspResponseStatusEnum, OcspStaplingVerdict
 from nassl.ssl_client import ClientCertificateRequested, OpenSslVersionEnum, OpenSslVerifyEnum, SslClient
 from tests.openssl_server import VulnerableOpenSslServer, NotOnLinux64Error, ClientAuthenticationServerConfigurationEnum
+from typing import Optional
+from typing import Text
+
+
+FIXTURES_PATH = os.path.join(os.path.dirname(__file__), 'fixtures')
+
+
+def _find_openssl_supporting(s_server_option):
+    """Return the path to an openssl binary in the PATH whose s_server supports the option, for features the bundled
+    s_server does not have.
+    """
+    openssl_path = find_executable('openssl')
+    if not openssl_path:
+        return None
+    s_server_help = subprocess.Popen([openssl_path, 's_server', '-help'], stdout=subprocess.PIPE,
+                                     stderr=subprocess.STDOUT).communicate()[0]
+    return openssl_path if s_server_option.encode('ascii') in s_server_help else None
 
 
 class CommonSslClientOnlineClientAuthenticationTests(unittest.TestCase):
@@ -172,6 +195,650 @@ class LegacySslClientOnlineTests(CommonSslClientOnlineTests):
     _SSL_CLIENT_CLS = LegacySslClient
 
 
+class CommonSslClientLocalServerTests(unittest.TestCase):
+
+    # To be defined in subclasses
+    _SSL_CLIENT_CLS = None
+
+    @classmethod
+    def setUpClass(cls):
+        if cls is CommonSslClientLocalServerTests:
+            raise unittest.SkipTest("Skip tests, it's a base class")
+        super(CommonSslClientLocalServerTests, cls).setUpClass()
+
+    def test_get_accepted_cipher_suites(self):
+        # Given a server with an RSA certificate
+        try:
+            with VulnerableOpenSslServer() as server:
+                # When enumerating cipher suites, only the ones compatible with the certificate are accepted
+                accepted_ciphers = self._SSL_CLIENT_CLS.get_accepted_cipher_suites(
+                    server.hostname,
+                    server.port,
+                    ['AES128-SHA', 'ECDHE-ECDSA-AES128-SHA', 'NOT-A-CIPHER'],
+                    ssl_version=OpenSslVersionEnum.TLSV1_2,
+                )
+                self.assertEqual(['AES128-SHA'], accepted_ciphers)
+
+        except NotOnLinux64Error:
+            logging.warning('WARNING: Not on Linux - skipping test')
+            return
+
+    def test_get_accepted_cipher_suites_connection_refused(self):
+        # Given a port nothing listens on, enumerating cipher suites fails
+        self.assertRaises(IOError, self._SSL_CLIENT_CLS.get_accepted_cipher_suites, 'localhost', 1, ['AES128-SHA'])
+
+    def test_handshake_timing(self):
+        # Given a server that supports TLS 1.2
+        try:
+            with VulnerableOpenSslServer() as server:
+                sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+                sock.settimeout(5)
+                sock.connect((server.hostname, server.port))
+
+                ssl_client = self._SSL_CLIENT_CLS(
+                    ssl_version=OpenSslVersionEnum.TLSV1_2,
+                    underlying_socket=sock,
+                    ssl_verify=OpenSslVerifyEnum.NONE,
+                )
+                # When timing the handshake
+                ssl_client.enable_handshake_timing()
+                try:
+                    ssl_client.do_handshake()
+                finally:
+                    ssl_client.shutdown()
+                    sock.close()
+
+                # Every message was recorded
+                timing = ssl_client.get_handshake_timing()
+                self.assertGreater(timing.duration, 0)
+                self.assertGreater(timing.bytes_sent, 0)
+                self.assertGreater(timing.bytes_received, 0)
+                self.assertEqual(2, timing.round_trips)
+                self.assertTrue(timing.messages[0].is_sent)
+                self.assertEqual(1, timing.messages[0].handshake_type)  # ClientHello
+                self.assertFalse(timing.messages[1].is_sent)
+                self.assertEqual(2, timing.messages[1].handshake_type)  # ServerHello
+                self.assertEqual(len(timing.messages), timing.messages_count)
+
+        except NotOnLinux64Error:
+            logging.warning('WARNING: Not on Linux - skipping test')
+            return
+
+    def test_transcript(self):
+        # Given a server that supports TLS 1.2
+        try:
+            with VulnerableOpenSslServer() as server:
+                sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+                sock.settimeout(5)
+                sock.connect((server.hostname, server.port))
+
+                ssl_client = self._SSL_CLIENT_CLS(
+                    ssl_version=OpenSslVersionEnum.TLSV1_2,
+                    underlying_socket=sock,
+                    ssl_verify=OpenSslVerifyEnum.NONE,
+                )
+                # When capturing the transcript in a buffer too small for the whole handshake
+                ssl_client.enable_transcript(1024)
+                try:
+                    ssl_client.do_handshake()
+                finally:
+                    ssl_client.shutdown()
+                    sock.close()
+
+                # The oldest messages (ClientHello, Certificate, etc.) were evicted
+                transcript = ssl_client.get_transcript()
+                self.assertGreater(ssl_client.get_transcript_dropped_count(), 0)
+                self.assertLessEqual(sum([len(message.data) for message in transcript]), 1024)
+                # And the most recent ones are available, up to the close_notify alert sent by shutdown()
+                self.assertEqual((True, 21), (transcript[-1].is_sent, transcript[-1].content_type))
+                received_messages = [message for message in transcript if not message.is_sent]
+                self.assertEqual(22, received_messages[-1].content_type)
+                self.assertEqual(b'\x14', received_messages[-1].data[0:1])  # Server Finished
+
+        except NotOnLinux64Error:
+            logging.warning('WARNING: Not on Linux - skipping test')
+            return
+
+    def test_connection_counters(self):
+        # Given a server that supports TLS 1.2
+        try:
+            with VulnerableOpenSslServer() as server:
+                sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+                sock.settimeout(5)
+                sock.connect((server.hostname, server.port))
+
+                ssl_client = self._SSL_CLIENT_CLS(
+                    ssl_version=OpenSslVersionEnum.TLSV1_2,
+                    underlying_socket=sock,
+                    ssl_verify=OpenSslVerifyEnum.NONE,
+                )
+                self.assertIsNone(ssl_client.get_connection_counters())
+
+                # When enabling the counters and doing a handshake
+                ssl_client.enable_connection_counters()
+                try:
+                    ssl_client.do_handshake()
+                finally:
+                    ssl_client.shutdown()
+                    sock.close()
+
+                # The traffic was counted
+                counters = ssl_client.get_connection_counters()
+                self.assertGreater(counters.bytes_sent, 0)
+                self.assertGreater(counters.bytes_received, counters.bytes_sent)  # Because of the server's certificate
+                # ClientHello, ClientKeyExchange, ChangeCipherSpec, Finished and close_notify
+                self.assertGreaterEqual(counters.records_sent, 5)
+                self.assertGreaterEqual(counters.records_received, 3)
+                self.assertEqual(counters.handshake_messages_sent, 3)
+                self.assertGreaterEqual(counters.handshake_messages_received, 4)
+                self.assertEqual(counters.alerts_sent, 1)
+                self.assertEqual(counters.alerts_received, 0)
+                self.assertGreaterEqual(counters.network_bio_write_calls, 1)
+                self.assertGreaterEqual(counters.network_bio_read_calls, 2)
+                # Each recv() takes as much as the network BIO can hold, ie. a whole flight
+                self.assertGreaterEqual(counters.socket_recv_calls, 1)
+                self.assertLessEqual(counters.socket_recv_calls, counters.records_received)
+                self.assertGreaterEqual(counters.socket_send_calls, 2)
+
+        except NotOnLinux64Error:
+            logging.warning('WARNING: Not on Linux - skipping test')
+            return
+
+    def test_write_flushes_in_one_call(self):
+        # Given a server that supports TLS 1.2
+        try:
+            with VulnerableOpenSslServer() as server:
+                sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+                sock.settimeout(5)
+                sock.connect((server.hostname, server.port))
+
+                # With a BIO pair large enough for several records
+                ssl_client = self._SSL_CLIENT_CLS(
+                    ssl_version=OpenSslVersionEnum.TLSV1_2,
+                    underlying_socket=sock,
+                    ssl_verify=OpenSslVerifyEnum.NONE,
+                    bio_buffer_size=65536,
+                )
+                ssl_client.enable_connection_counters()
+                try:
+                    ssl_client.do_handshake()
+                    counters_before = ssl_client.get_connection_counters()
+
+                    # When sending data spanning several records
+                    request = b'GET / HTTP/1.0\r\nX-Padding: ' + b'A' * 40000 + b'\r\n\r\n'
+                    sent_size = ssl_client.write(request)
+
+                    # The encrypted bytes sent are returned and all the records went out in a single call
+                    counters_after = ssl_client.get_connection_counters()
+                    self.assertGreater(sent_size, len(request))
+                    self.assertEqual(sent_size, counters_after.bytes_sent - counters_before.bytes_sent)
+                    self.assertEqual(1, counters_after.socket_send_calls - counters_before.socket_send_calls)
+                    self.assertEqual(b'HTTP/1.0', ssl_client.read(8))
+                finally:
+                    sock.close()
+
+        except NotOnLinux64Error:
+            logging.warning('WARNING: Not on Linux - skipping test')
+            return
+
+    def test_flush_socket_errors(self):
+        # Given a peer that does not read anything and whose receive buffer is full
+        sock, peer_sock = socket.socketpair()
+        self.addCleanup(sock.close)
+        self.addCleanup(peer_sock.close)
+        sock.setblocking(False)
+        try:
+            while True:
+                sock.send(b'A' * 65536)
+        except socket.error:
+            pass
+        sock.settimeout(0.1)
+
+        # When the ClientHello cannot be sent in time, the same exception as socket.send() is raised
+        ssl_client = self._SSL_CLIENT_CLS(underlying_socket=sock, ssl_verify=OpenSslVerifyEnum.NONE)
+        self.assertRaises(socket.timeout, ssl_client.do_handshake)
+
+        # Given a peer that closed the connection
+        sock, peer_sock = socket.socketpair()
+        self.addCleanup(sock.close)
+        peer_sock.close()
+        sock.settimeout(5)
+
+        # When sending the ClientHello, the socket error is raised with its errno
+        ssl_client = self._SSL_CLIENT_CLS(underlying_socket=sock, ssl_verify=OpenSslVerifyEnum.NONE)
+        with self.assertRaises(socket.error) as context:
+            ssl_client.do_handshake()
+        self.assertIn(context.exception.errno, [errno.EPIPE, errno.ECONNRESET])
+
+    def test_memory_lean_mode(self):
+        # Given a server that supports TLS 1.2
+        try:
+            with VulnerableOpenSslServer() as server:
+                sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+                sock.settimeout(5)
+                sock.connect((server.hostname, server.port))
+
+                # When releasing the record buffers and using a BIO pair smaller than a record
+                ssl_client = self._SSL_CLIENT_CLS(
+                    ssl_version=OpenSslVersionEnum.TLSV1_2,
+                    underlying_socket=sock,
+                    ssl_verify=OpenSslVerifyEnum.NONE,
+                    release_buffers_when_idle=True,
+                    bio_buffer_size=4096,
+                )
+                try:
+                    ssl_client.do_handshake()
+                    # Data larger than the BIO pair can still be sent
+                    request = b'GET / HTTP/1.0\r\nX-Padding: ' + b'A' * 10000 + b'\r\n\r\n'
+                    self.assertGreater(ssl_client.write(request), len(request))
+                    self.assertEqual(ssl_client.read(8), b'HTTP/1.0')
+                finally:
+                    ssl_client.shutdown()
+                    sock.close()
+
+        except NotOnLinux64Error:
+            logging.warning('WARNING: Not on Linux - skipping test')
+            return
+
+    def test_exchange(self):
+        # Given a server that supports TLS 1.2
+        try:
+            with VulnerableOpenSslServer() as server:
+                sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+                sock.settimeout(5)
+                sock.connect((server.hostname, server.port))
+
+                ssl_client = self._SSL_CLIENT_CLS(
+                    ssl_version=OpenSslVersionEnum.TLSV1_2,
+                    underlying_socket=sock,
+                    ssl_verify=OpenSslVerifyEnum.NONE,
+                )
+                try:
+                    ssl_client.do_handshake()
+
+                    # When pipelining requests and reading the responses until a delimiter
+                    request = b'GET / HTTP/1.0\r\n\r\n'
+                    responses = ssl_client.exchange([request, request], until=b'\r\n')
+
+                    # Each response ends with the delimiter and nothing past it was consumed
+                    self.assertEqual([b'HTTP/1.0 200 ok\r\n', b'Content-type: text/plain\r\n'], responses)
+                    self.assertEqual(b'\r\n', ssl_client.read(2))
+
+                    # Responses can also have a fixed length
+                    self.assertEqual([b'Error'], ssl_client.exchange([b''], until=5))
+
+                    # The responses stop when the peer closes the connection
+                    responses = ssl_client.exchange([b''], until=b'\r\n\r\n')
+                    self.assertEqual(1, len(responses))
+                    self.assertTrue(responses[0].startswith(b' opening'))
+                finally:
+                    sock.close()
+
+        except NotOnLinux64Error:
+            logging.warning('WARNING: Not on Linux - skipping test')
+            return
+
+    def test_exchange_bad(self):
+        ssl_client = self._SSL_CLIENT_CLS()
+        self.assertRaises(TypeError, ssl_client.exchange, [b'GET / HTTP/1.0\r\n\r\n'], until=1.5)
+        self.assertRaises(IOError, ssl_client.exchange, [b'GET / HTTP/1.0\r\n\r\n'], until=b'\r\n')
+
+    def test_expected_hostname(self):
+        # Given a server with a trusted certificate valid for localhost and 127.0.0.1
+        try:
+            with VulnerableOpenSslServer(use_localhost_certificate=True) as server:
+                for hostname, expected_verify_result in [
+                    (server.hostname, 0),
+                    (server.ip_address, 0),
+                    ('www.example.com', 62),  # X509_V_ERR_HOSTNAME_MISMATCH
+                    ('10.0.0.1', 64),  # X509_V_ERR_IP_ADDRESS_MISMATCH
+                ]:
+                    sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+                    sock.settimeout(5)
+                    sock.connect((server.hostname, server.port))
+
+                    # When OpenSSL validates the hostname during the handshake
+                    ssl_client = self._SSL_CLIENT_CLS(
+                        ssl_version=OpenSslVersionEnum.TLSV1_2,
+                        underlying_socket=sock,
+                        ssl_verify=OpenSslVerifyEnum.NONE,
+                        ssl_verify_locations=server.get_localhost_server_certificate_path(),
+                    )
+                    ssl_client.set_expected_hostname(hostname)
+                    try:
+                        ssl_client.do_handshake()
+                    finally:
+                        ssl_client.shutdown()
+                        sock.close()
+
+                    # The result of the validation is returned with the result of the certificate verification
+                    self.assertEqual(expected_verify_result, ssl_client.get_certificate_chain_verify_result()[0])
+
+                # When the server's certificate must be valid for another hostname
+                sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+                sock.settimeout(5)
+                sock.connect((server.hostname, server.port))
+                ssl_client = self._SSL_CLIENT_CLS(
+                    ssl_version=OpenSslVersionEnum.TLSV1_2,
+                    underlying_socket=sock,
+                    ssl_verify=OpenSslVerifyEnum.PEER,
+                    ssl_verify_locations=server.get_localhost_server_certificate_path(),
+                )
+                ssl_client.set_expected_hostname('www.example.com')
+
+                # The handshake fails
+                try:
+                    self.assertRaisesRegexp(OpenSSLError, 'certificate verify failed', ssl_client.do_handshake)
+                finally:
+                    sock.close()
+
+        except NotOnLinux64Error:
+            logging.warning('WARNING: Not on Linux - skipping test')
+            return
+
+    def _verify_chain_with_intermediate_pool(self, server_ca_file):
+        # type: (Optional[Text]) -> int
+        """Handshake with a server using the chain-leaf.pem fixture and return the result of verifying its chain; the
+        server sends the certificates from server_ca_file after its leaf.
+        """
+        with VulnerableOpenSslServer(
+            certificate_path=os.path.join(FIXTURES_PATH, 'chain-leaf.pem'),
+            key_path=os.path.join(FIXTURES_PATH, 'chain-leaf-key.pem'),
+            extra_arguments='-CAfile {}'.format(server_ca_file) if server_ca_file else '',
+        ) as server:
+            sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+            sock.settimeout(5)
+            sock.connect((server.hostname, server.port))
+
+            ssl_client = self._SSL_CLIENT_CLS(
+                ssl_version=OpenSslVersionEnum.TLSV1_2,
+                underlying_socket=sock,
+                ssl_verify=OpenSslVerifyEnum.NONE,
+                ssl_verify_locations=os.path.join(FIXTURES_PATH, 'chain-root-ca.pem'),
+                use_intermediate_pool=True,
+            )
+            try:
+                ssl_client.do_handshake()
+            finally:
+                ssl_client.shutdown()
+                sock.close()
+            return ssl_client.get_certificate_chain_verify_result()[0]
+
+    def test_intermediate_pool(self):
+        # Given the intermediate pool enabled
+        self._SSL_CLIENT_CLS.enable_intermediate_pool(10)
+        self.addCleanup(self._SSL_CLIENT_CLS.disable_intermediate_pool)
+        get_pool_stats = self._SSL_CLIENT_CLS._NASSL_MODULE.X509_STORE.get_intermediate_pool_stats
+        try:
+            # And a server that sends its leaf certificate only, which cannot be verified at first
+            self.assertNotEqual(0, self._verify_chain_with_intermediate_pool(None))
+            self.assertEqual((0, 0, 0), get_pool_stats())
+
+            # When connecting to a server sending its whole chain, its intermediate gets added to the pool
+            server_ca_file = tempfile.NamedTemporaryFile(delete=False, mode='wt')
+            self.addCleanup(os.remove, server_ca_file.name)
+            for fixture_name in ['chain-intermediate-ca.pem', 'chain-root-ca.pem']:
+                with open(os.path.join(FIXTURES_PATH, fixture_name)) as fixture_file:
+                    server_ca_file.write(fixture_file.read())
+            server_ca_file.close()
+            self.assertEqual(0, self._verify_chain_with_intermediate_pool(server_ca_file.name))
+            self.assertEqual((1, 0, 1), get_pool_stats())
+
+            # Then the chain of the server sending its leaf only is completed from the pool
+            self.assertEqual(0, self._verify_chain_with_intermediate_pool(None))
+            self.assertEqual((1, 1, 1), get_pool_stats())
+
+        except NotOnLinux64Error:
+            logging.warning('WARNING: Not on Linux - skipping test')
+            return
+
+    def test_get_ocsp_stapling_verdict(self):
+        # Given a server that does not staple OCSP responses
+        try:
+            with VulnerableOpenSslServer(use_localhost_certificate=True) as server:
+                sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+                sock.settimeout(5)
+                sock.connect((server.hostname, server.port))
+
+                ssl_client = self._SSL_CLIENT_CLS(
+                    ssl_version=OpenSslVersionEnum.TLSV1_2,
+                    underlying_socket=sock,
+                    ssl_verify=OpenSslVerifyEnum.NONE,
+                )
+                ssl_client.set_tlsext_status_ocsp()
+                try:
+                    ssl_client.do_handshake()
+
+                    # When checking OCSP stapling, nothing was stapled and it is fine as the certificate is not
+                    # must-staple
+                    verdict = ssl_client.get_ocsp_stapling_verdict()
+                    self.assertEqual((False, False, None, None, False, False), verdict)
+                    self.assertTrue(verdict.is_acceptable)
+                finally:
+                    ssl_client.shutdown()
+                    sock.close()
+
+        except NotOnLinux64Error:
+            logging.warning('WARNING: Not on Linux - skipping test')
+            return
+
+    def _get_stapled_ocsp_stapling_verdict(self, ssl_verify_locations):
+        # type: (Text) -> Optional[OcspStaplingVerdict]
+        # Given a server that staples a good OCSP response for its certificate
+        openssl_path = _find_openssl_supporting('-status_file')
+        if not openssl_path:
+            self.skipTest('No openssl binary with s_server -status_file')
+
+        try:
+            with VulnerableOpenSslServer(
+                certificate_path=os.path.join(FIXTURES_PATH, 'ocsp-leaf.pem'),
+                key_path=os.path.join(FIXTURES_PATH, 'ocsp-leaf-key.pem'),
+                openssl_path=openssl_path,
+                extra_arguments='-cert_chain {} -status_file {}'.format(os.path.join(FIXTURES_PATH, 'ocsp-ca.pem'),
+                                                                       os.path.join(FIXTURES_PATH, 'ocsp-response.der')),
+            ) as server:
+                sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+                sock.settimeout(5)
+                sock.connect((server.hostname, server.port))
+
+                ssl_client = self._SSL_CLIENT_CLS(
+                    ssl_version=OpenSslVersionEnum.TLSV1_2,
+                    underlying_socket=sock,
+                    ssl_verify=OpenSslVerifyEnum.NONE,
+                    ssl_verify_locations=ssl_verify_locations,
+                )
+                ssl_client.set_tlsext_status_ocsp()
+                try:
+                    ssl_client.do_handshake()
+                    return ssl_client.get_ocsp_stapling_verdict()
+                finally:
+                    ssl_client.shutdown()
+                    sock.close()
+
+        except NotOnLinux64Error:
+            logging.warning('WARNING: Not on Linux - skipping test')
+            return None
+
+    def test_get_ocsp_stapling_verdict_stapled(self):
+        verdict = self._get_stapled_ocsp_stapling_verdict(os.path.join(FIXTURES_PATH, 'ocsp-ca.pem'))
+        if verdict is None:
+            return
+
+        # When checking OCSP stapling, the response was matched to the leaf using the issuer from the server's chain,
+        # and its signature was verified with the client's trust store
+        self.assertEqual((False, True, OcspResponseStatusEnum.SUCCESSFUL, OcspCertificateStatusEnum.GOOD, True, True),
+                         verdict)
+        self.assertTrue(verdict.is_acceptable)
+
+    def test_get_ocsp_stapling_verdict_stapled_not_trusted(self):
+        mozilla_store_path = os.path.join(os.path.dirname(__file__), '..', 'mozilla.pem')
+        verdict = self._get_stapled_ocsp_stapling_verdict(mozilla_store_path)
+        if verdict is None:
+            return
+
+        # When checking OCSP stapling with a trust store that does not contain the response's signer, the response is
+        # parsed but its signature is not valid
+        self.assertEqual((False, True, OcspResponseStatusEnum.SUCCESSFUL, OcspCertificateStatusEnum.GOOD, True, False),
+                         verdict)
+
+    def test_get_ocsp_stapling_verdict_before_handshake(self):
+        self.assertRaises(ValueError, self._SSL_CLIENT_CLS().get_ocsp_stapling_verdict)
+
+    def test_expected_hostname_invalid(self):
+        ssl_client = self._SSL_CLIENT_CLS()
+        self.assertRaises(ValueError, ssl_client.set_expected_hostname, 'local\x00host')
+
+    def test_bio_buffer_size_too_small(self):
+        self.assertRaises(ValueError, self._SSL_CLIENT_CLS, bio_buffer_size=1024)
+
+    def test_get_cipher_preference_order(self):
+        # Given a server that enforces its own cipher suite preference
+        try:
+            with VulnerableOpenSslServer(should_enforce_cipher_order=True) as server:
+                # When detecting its preference, the accepted cipher suites are returned in the server's order
+                ordered_ciphers = self._SSL_CLIENT_CLS.get_cipher_preference_order(
+                    server.hostname,
+                    server.port,
+                    ['AES128-SHA', 'AES256-SHA', 'ECDHE-RSA-AES256-SHA'],
+                    ssl_version=OpenSslVersionEnum.TLSV1_2,
+                )
+                self.assertEqual(['ECDHE-RSA-AES256-SHA', 'AES256-SHA', 'AES128-SHA'], ordered_ciphers)
+
+        except NotOnLinux64Error:
+            logging.warning('WARNING: Not on Linux - skipping test')
+            return
+
+    def test_get_cipher_preference_order_client_preference(self):
+        # Given a server that follows the client's cipher suite preference
+        try:
+            with VulnerableOpenSslServer() as server:
+                # When detecting its preference, None is returned
+                ordered_ciphers = self._SSL_CLIENT_CLS.get_cipher_preference_order(
+                    server.hostname,
+                    server.port,
+                    ['AES128-SHA', 'AES256-SHA'],
+                    ssl_version=OpenSslVersionEnum.TLSV1_2,
+                )
+                self.assertIsNone(ordered_ciphers)
+
+        except NotOnLinux64Error:
+            logging.warning('WARNING: Not on Linux - skipping test')
+            return
+
+    def test_get_cipher_preference_order_rejected(self):
+        # Given a server that does not support any of the cipher suites (it has an RSA certificate)
+        try:
+            with VulnerableOpenSslServer(should_enforce_cipher_order=True) as server:
+                # When detecting its preference, an error is returned instead of the client preference result
+                self.assertRaises(
+                    IOError,
+                    self._SSL_CLIENT_CLS.get_cipher_preference_order,
+                    server.hostname,
+                    server.port,
+                    ['ECDHE-ECDSA-AES128-SHA', 'ECDHE-ECDSA-AES256-SHA'],
+                    ssl_version=OpenSslVersionEnum.TLSV1_2,
+                )
+
+        except NotOnLinux64Error:
+            logging.warning('WARNING: Not on Linux - skipping test')
+            return
+
+    def test_probe_server_hello(self):
+        # Given a server that supports TLS 1.2
+        try:
+            with VulnerableOpenSslServer() as server:
+                sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+                sock.settimeout(5)
+                sock.connect((server.hostname, server.port))
+
+                ssl_client = self._SSL_CLIENT_CLS(
+                    ssl_version=OpenSslVersionEnum.TLSV1_2,
+                    underlying_socket=sock,
+                    ssl_verify=OpenSslVerifyEnum.NONE,
+                )
+                ssl_client.set_cipher_list('AES128-SHA')
+
+                # When only probing for the ServerHello, the negotiated parameters are returned
+                server_hello = ssl_client.probe_server_hello()
+
+                self.assertEqual(OpenSslVersionEnum.TLSV1_2, server_hello.ssl_version)
+                self.assertEqual(0x002F, server_hello.cipher_id)
+                self.assertEqual('AES128-SHA', server_hello.cipher_name)
+                self.assertIsNone(server_hello.selected_group)
+                self.assertFalse(server_hello.is_hello_retry_request)
+                # And the handshake was not completed
+                self.assertFalse(ssl_client.is_handshake_completed())
+                # And OpenSSL did not process anything the server sent
+                self.assertIsNone(ssl_client.get_peer_certificate())
+                # And the connection was closed
+                self.assertIsNone(ssl_client.get_underlying_socket())
+                self.assertRaises(socket.error, sock.send, b'data')
+
+        except NotOnLinux64Error:
+            logging.warning('WARNING: Not on Linux - skipping test')
+            return
+
+    def test_probe_server_hello_alert(self):
+        # Given a server that only has an RSA certificate
+        try:
+            with VulnerableOpenSslServer() as server:
+                sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+                sock.settimeout(5)
+                sock.connect((server.hostname, server.port))
+
+                ssl_client = self._SSL_CLIENT_CLS(
+                    ssl_version=OpenSslVersionEnum.TLSV1_2,
+                    underlying_socket=sock,
+                    ssl_verify=OpenSslVerifyEnum.NONE,
+                )
+                ssl_client.set_cipher_list('ECDHE-ECDSA-AES128-SHA')
+
+                # When probing with a cipher suite it cannot use, the server's alert is raised
+                with self.assertRaises(OpenSSLError) as context:
+                    ssl_client.probe_server_hello()
+                self.assertIn('handshake failure', str(context.exception))
+                self.assertIsNone(ssl_client.get_underlying_socket())
+
+        except NotOnLinux64Error:
+            logging.warning('WARNING: Not on Linux - skipping test')
+            return
+
+
+class ModernSslClientLocalServerTests(CommonSslClientLocalServerTests):
+
+    _SSL_CLIENT_CLS = SslClient
+
+    def test_get_cipher_preference_order_tls13_and_older(self):
+        # Given a TLS 1.3 server that enforces its own cipher suite preference
+        openssl_path = _find_openssl_supporting('-ciphersuites')
+        if not openssl_path:
+            self.skipTest('No openssl binary with s_server -ciphersuites')
+
+        try:
+            with VulnerableOpenSslServer(
+                should_enforce_cipher_order=True,
+                openssl_path=openssl_path,
+                extra_arguments='-ciphersuites TLS_AES_256_GCM_SHA384:TLS_AES_128_GCM_SHA256',
+            ) as server:
+                # When detecting its preference with both TLS 1.3 and older cipher suites, each kind is sorted
+                ordered_ciphers = self._SSL_CLIENT_CLS.get_cipher_preference_order(
+                    server.hostname,
+                    server.port,
+                    ['AES128-SHA', 'TLS_AES_128_GCM_SHA256', 'AES256-SHA', 'TLS_AES_256_GCM_SHA384'],
+                )
+                self.assertEqual(['TLS_AES_256_GCM_SHA384', 'TLS_AES_128_GCM_SHA256', 'AES256-SHA', 'AES128-SHA'],
+                                 ordered_ciphers)
+
+        except NotOnLinux64Error:
+            logging.warning('WARNING: Not on Linux - skipping test')
+            return
+
+
+class LegacySslClientLocalServerTests(CommonSslClientLocalServerTests):
+
+    _SSL_CLIENT_CLS = LegacySslClient
+
+
 class LegacySslClientOnlineSsl2Tests(unittest.TestCase):
 
     def test_ssl_2(self):